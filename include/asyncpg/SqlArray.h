@@ -0,0 +1 @@
+#include "../../src/SqlArray.h"
\ No newline at end of file
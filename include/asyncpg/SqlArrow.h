@@ -0,0 +1 @@
+#include "../../src/SqlArrow.h"
\ No newline at end of file
@@ -0,0 +1 @@
+#include "../../src/SqlBalancer.h"
\ No newline at end of file
@@ -0,0 +1 @@
+#include "../../src/SqlCache.h"
\ No newline at end of file
@@ -0,0 +1 @@
+#include "../../src/SqlCell.h"
\ No newline at end of file
@@ -0,0 +1 @@
+#include "../../src/SqlCoalescer.h"
\ No newline at end of file
@@ -0,0 +1 @@
+#include "../../src/SqlCodec.h"
\ No newline at end of file
@@ -0,0 +1 @@
+#include "../../src/SqlDecimal.h"
\ No newline at end of file
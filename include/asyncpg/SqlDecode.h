@@ -0,0 +1 @@
+#include "../../src/SqlDecode.h"
\ No newline at end of file
@@ -0,0 +1 @@
+#include "../../src/SqlHedge.h"
\ No newline at end of file
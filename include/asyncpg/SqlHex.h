@@ -0,0 +1 @@
+#include "../../src/SqlHex.h"
\ No newline at end of file
@@ -0,0 +1 @@
+#include "../../src/SqlLoader.h"
\ No newline at end of file
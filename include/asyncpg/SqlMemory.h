@@ -0,0 +1 @@
+#include "../../src/SqlMemory.h"
\ No newline at end of file
@@ -0,0 +1 @@
+#include "../../src/SqlRouter.h"
\ No newline at end of file
@@ -0,0 +1 @@
+#include "../../src/SqlStream.h"
\ No newline at end of file
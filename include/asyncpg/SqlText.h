@@ -0,0 +1 @@
+#include "../../src/SqlText.h"
\ No newline at end of file
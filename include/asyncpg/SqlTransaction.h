@@ -0,0 +1 @@
+#include "../../src/SqlTransaction.h"
\ No newline at end of file
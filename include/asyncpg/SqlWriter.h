@@ -0,0 +1 @@
+#include "../../src/SqlWriter.h"
\ No newline at end of file
@@ -0,0 +1,430 @@
+﻿#include "SqlArray.h"
+#include "SqlOid.h"
+
+#include <cstring>
+#include <type_traits>
+
+namespace AsyncPg {
+
+/// Размер заголовка одномерного массива: ndim, флаг NULL, тип элемента,
+/// размер и нижняя граница измерения
+static constexpr std::size_t HeaderSize = 20;
+
+/// Кодек элемента массива
+template<class T>
+struct ArrayElement;
+
+template<>
+struct ArrayElement<bool>
+{
+    static constexpr unsigned int oid = BOOLOID;
+    static bool accepts(unsigned int type) { return type == BOOLOID; }
+    static std::size_t size(bool /*value*/) { return 1; }
+    static void write(char *out, bool value) { *out = value ? 1 : 0; }
+    static bool read(unsigned int /*type*/, const char *data, int /*length*/) { return *data != 0; }
+};
+
+/// Кодек целочисленного элемента массива с расширением меньших типов
+template<class T, unsigned int Oid>
+struct IntegerElement
+{
+    static constexpr unsigned int oid = Oid;
+
+    static bool accepts(unsigned int type)
+    {
+        switch (type) {
+        case INT2OID:
+            return true;
+        case INT4OID:
+            return sizeof(T) >= sizeof(int32_t);
+        case INT8OID:
+            return sizeof(T) >= sizeof(int64_t);
+        default:
+            return false;
+        }
+    }
+
+    static std::size_t size(T /*value*/) { return sizeof(T); }
+    static void write(char *out, T value) { writeBigEndian(out, value); }
+
+    static T read(unsigned int /*type*/, const char *data, int length)
+    {
+        switch (length) {
+        case 2:
+            return static_cast<T>(readBigEndian<int16_t>(data));
+        case 4:
+            return static_cast<T>(readBigEndian<int32_t>(data));
+        default:
+            return static_cast<T>(readBigEndian<int64_t>(data));
+        }
+    }
+};
+
+template<>
+struct ArrayElement<int16_t> : IntegerElement<int16_t, INT2OID> {};
+
+template<>
+struct ArrayElement<int32_t> : IntegerElement<int32_t, INT4OID> {};
+
+template<>
+struct ArrayElement<int64_t> : IntegerElement<int64_t, INT8OID> {};
+
+template<>
+struct ArrayElement<float>
+{
+    static constexpr unsigned int oid = FLOAT4OID;
+    static bool accepts(unsigned int type) { return type == FLOAT4OID; }
+    static std::size_t size(float /*value*/) { return sizeof(float); }
+
+    static void write(char *out, float value)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        writeBigEndian(out, bits);
+    }
+
+    static float read(unsigned int /*type*/, const char *data, int /*length*/)
+    {
+        float value;
+        auto bits = readBigEndian<uint32_t>(data);
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+};
+
+template<>
+struct ArrayElement<double>
+{
+    static constexpr unsigned int oid = FLOAT8OID;
+    static bool accepts(unsigned int type) { return type == FLOAT4OID || type == FLOAT8OID; }
+    static std::size_t size(double /*value*/) { return sizeof(double); }
+
+    static void write(char *out, double value)
+    {
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        writeBigEndian(out, bits);
+    }
+
+    static double read(unsigned int type, const char *data, int length)
+    {
+        if (type == FLOAT4OID)
+            return ArrayElement<float>::read(type, data, length);
+
+        double value;
+        auto bits = readBigEndian<uint64_t>(data);
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+};
+
+/// Кодек строкового элемента массива
+template<class T>
+struct StringElement
+{
+    static constexpr unsigned int oid = TEXTOID;
+
+    static bool accepts(unsigned int type)
+    {
+        switch (type) {
+        case TEXTOID:
+        case VARCHAROID:
+        case NAMEOID:
+        case CHAROID:
+        case JSONOID:
+        case JSONBOID:
+        case XMLOID:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    static std::size_t size(const T &value) { return value.size(); }
+    static void write(char *out, const T &value) { std::memcpy(out, value.data(), value.size()); }
+
+    static T read(unsigned int type, const char *data, int length)
+    {
+        // Значение jsonb начинается с байта версии формата
+        if (type == JSONBOID && length > 0)
+            return T(data + 1, static_cast<std::size_t>(length - 1));
+        return T(data, static_cast<std::size_t>(length));
+    }
+};
+
+template<>
+struct ArrayElement<std::string> : StringElement<std::string> {};
+
+template<>
+struct ArrayElement<std::string_view> : StringElement<std::string_view> {};
+
+template<>
+struct ArrayElement<std::array<char, 16>>
+{
+    using Uuid = std::array<char, 16>;
+
+    static constexpr unsigned int oid = UUIDOID;
+    static bool accepts(unsigned int type) { return type == UUIDOID; }
+    static std::size_t size(const Uuid &value) { return value.size(); }
+    static void write(char *out, const Uuid &value) { std::memcpy(out, value.data(), value.size()); }
+
+    static Uuid read(unsigned int /*type*/, const char *data, int /*length*/)
+    {
+        Uuid value;
+        std::memcpy(value.data(), data, value.size());
+        return value;
+    }
+};
+
+template<>
+struct ArrayElement<SqlDecimal>
+{
+    static constexpr unsigned int oid = NUMERICOID;
+    static bool accepts(unsigned int type) { return type == NUMERICOID; }
+    static std::size_t size(const SqlDecimal &value) { return value.pgSize(); }
+    static void write(char *out, const SqlDecimal &value) { value.toPg(out); }
+
+    static SqlDecimal read(unsigned int /*type*/, const char *data, int length)
+    {
+        return SqlDecimal::fromPg(data, length);
+    }
+};
+
+SqlArray SqlArray::fromPg(const char *data, int length)
+{
+    SqlArray result;
+    if (data && length >= 12)
+        result._data.assign(data, data + length);
+    return result;
+}
+
+template<class T>
+SqlArray SqlArray::from(const T *values, std::size_t count)
+{
+    using Element = ArrayElement<T>;
+
+    SqlArray result;
+    if (count == 0) {
+        result._data.resize(12);
+        writeBigEndian<int32_t>(result._data.data() + 8, Element::oid);
+        return result;
+    }
+
+    std::size_t size = HeaderSize + count * sizeof(int32_t);
+    for (std::size_t i = 0; i < count; ++i)
+        size += Element::size(values[i]);
+
+    result._data.resize(size);
+    auto *out = result._data.data();
+    writeBigEndian<int32_t>(out, 1);
+    writeBigEndian<int32_t>(out + 4, 0);
+    writeBigEndian<int32_t>(out + 8, Element::oid);
+    writeBigEndian<int32_t>(out + 12, static_cast<int32_t>(count));
+    writeBigEndian<int32_t>(out + 16, 1);
+    out += HeaderSize;
+
+    for (std::size_t i = 0; i < count; ++i) {
+        const auto length = Element::size(values[i]);
+        writeBigEndian<int32_t>(out, static_cast<int32_t>(length));
+        Element::write(out + sizeof(int32_t), values[i]);
+        out += sizeof(int32_t) + length;
+    }
+
+    return result;
+}
+
+template<class T>
+std::vector<T> SqlArray::values() const
+{
+    using Element = ArrayElement<T>;
+
+    std::vector<T> result;
+    const auto type = elementType();
+    if (!Element::accepts(type))
+        return result;
+
+    const auto ndim = readBigEndian<int32_t>(_data.data());
+    if (ndim <= 0 || _data.size() < 12 + static_cast<std::size_t>(ndim) * 8)
+        return result;
+
+    const auto count = size();
+    result.reserve(static_cast<std::size_t>(count));
+
+    const auto *pos = _data.data() + 12 + static_cast<std::size_t>(ndim) * 8;
+    const auto *end = _data.data() + _data.size();
+    for (int i = 0; i < count && pos + sizeof(int32_t) <= end; ++i) {
+        const auto length = readBigEndian<int32_t>(pos);
+        pos += sizeof(int32_t);
+        if (length < 0) {
+            result.emplace_back();
+            continue;
+        }
+        if (length > end - pos)
+            break;
+        result.push_back(Element::read(type, pos, length));
+        pos += length;
+    }
+
+    return result;
+}
+
+unsigned int SqlArray::elementType() const
+{
+    return (_data.size() >= 12) ? readBigEndian<uint32_t>(_data.data() + 8) : 0;
+}
+
+unsigned int SqlArray::arrayType() const
+{
+    return toPgArrayType(elementType());
+}
+
+int SqlArray::size() const
+{
+    if (_data.size() < 12)
+        return 0;
+
+    const auto ndim = readBigEndian<int32_t>(_data.data());
+    if (ndim <= 0 || _data.size() < 12 + static_cast<std::size_t>(ndim) * 8)
+        return 0;
+
+    int count = 1;
+    for (int dim = 0; dim < ndim; ++dim)
+        count *= readBigEndian<int32_t>(_data.data() + 12 + dim * 8);
+    return count;
+}
+
+bool SqlArray::hasNulls() const
+{
+    return _data.size() >= 12 && readBigEndian<int32_t>(_data.data() + 4) != 0;
+}
+
+std::string_view SqlArray::bytes() const
+{
+    return std::string_view(_data.data(), _data.size());
+}
+
+unsigned int toPgElementType(unsigned int oid)
+{
+    switch (oid) {
+    case BOOLARRAYOID:
+        return BOOLOID;
+    case BYTEAARRAYOID:
+        return BYTEAOID;
+    case CHARARRAYOID:
+        return CHAROID;
+    case NAMEARRAYOID:
+        return NAMEOID;
+    case INT2ARRAYOID:
+        return INT2OID;
+    case INT4ARRAYOID:
+        return INT4OID;
+    case TEXTARRAYOID:
+        return TEXTOID;
+    case VARCHARARRAYOID:
+        return VARCHAROID;
+    case INT8ARRAYOID:
+        return INT8OID;
+    case FLOAT4ARRAYOID:
+        return FLOAT4OID;
+    case FLOAT8ARRAYOID:
+        return FLOAT8OID;
+    case TIMESTAMPARRAYOID:
+        return TIMESTAMPOID;
+    case DATEARRAYOID:
+        return DATEOID;
+    case TIMEARRAYOID:
+        return TIMEOID;
+    case TIMESTAMPTZARRAYOID:
+        return TIMESTAMPTZOID;
+    case NUMERICARRAYOID:
+        return NUMERICOID;
+    case TIMETZARRAYOID:
+        return TIMETZOID;
+    case UUIDARRAYOID:
+        return UUIDOID;
+    case JSONARRAYOID:
+        return JSONOID;
+    case XMLARRAYOID:
+        return XMLOID;
+    case JSONBARRAYOID:
+        return JSONBOID;
+    default:
+        break;
+    }
+    return 0;
+}
+
+unsigned int toPgArrayType(unsigned int oid)
+{
+    switch (oid) {
+    case BOOLOID:
+        return BOOLARRAYOID;
+    case BYTEAOID:
+        return BYTEAARRAYOID;
+    case CHAROID:
+        return CHARARRAYOID;
+    case NAMEOID:
+        return NAMEARRAYOID;
+    case INT2OID:
+        return INT2ARRAYOID;
+    case INT4OID:
+        return INT4ARRAYOID;
+    case TEXTOID:
+        return TEXTARRAYOID;
+    case VARCHAROID:
+        return VARCHARARRAYOID;
+    case INT8OID:
+        return INT8ARRAYOID;
+    case FLOAT4OID:
+        return FLOAT4ARRAYOID;
+    case FLOAT8OID:
+        return FLOAT8ARRAYOID;
+    case TIMESTAMPOID:
+        return TIMESTAMPARRAYOID;
+    case DATEOID:
+        return DATEARRAYOID;
+    case TIMEOID:
+        return TIMEARRAYOID;
+    case TIMESTAMPTZOID:
+        return TIMESTAMPTZARRAYOID;
+    case NUMERICOID:
+        return NUMERICARRAYOID;
+    case TIMETZOID:
+        return TIMETZARRAYOID;
+    case UUIDOID:
+        return UUIDARRAYOID;
+    case JSONOID:
+        return JSONARRAYOID;
+    case XMLOID:
+        return XMLARRAYOID;
+    case JSONBOID:
+        return JSONBARRAYOID;
+    default:
+        break;
+    }
+    return 0;
+}
+
+template ASYNCPGLIB SqlArray SqlArray::from(const bool *, std::size_t);
+template ASYNCPGLIB SqlArray SqlArray::from(const int16_t *, std::size_t);
+template ASYNCPGLIB SqlArray SqlArray::from(const int32_t *, std::size_t);
+template ASYNCPGLIB SqlArray SqlArray::from(const int64_t *, std::size_t);
+template ASYNCPGLIB SqlArray SqlArray::from(const float *, std::size_t);
+template ASYNCPGLIB SqlArray SqlArray::from(const double *, std::size_t);
+template ASYNCPGLIB SqlArray SqlArray::from(const std::string *, std::size_t);
+template ASYNCPGLIB SqlArray SqlArray::from(const std::string_view *, std::size_t);
+template ASYNCPGLIB SqlArray SqlArray::from(const std::array<char, 16> *, std::size_t);
+template ASYNCPGLIB SqlArray SqlArray::from(const SqlDecimal *, std::size_t);
+
+template ASYNCPGLIB std::vector<bool> SqlArray::values<bool>() const;
+template ASYNCPGLIB std::vector<int16_t> SqlArray::values<int16_t>() const;
+template ASYNCPGLIB std::vector<int32_t> SqlArray::values<int32_t>() const;
+template ASYNCPGLIB std::vector<int64_t> SqlArray::values<int64_t>() const;
+template ASYNCPGLIB std::vector<float> SqlArray::values<float>() const;
+template ASYNCPGLIB std::vector<double> SqlArray::values<double>() const;
+template ASYNCPGLIB std::vector<std::string> SqlArray::values<std::string>() const;
+template ASYNCPGLIB std::vector<std::string_view> SqlArray::values<std::string_view>() const;
+template ASYNCPGLIB std::vector<std::array<char, 16>> SqlArray::values<std::array<char, 16>>() const;
+template ASYNCPGLIB std::vector<SqlDecimal> SqlArray::values<SqlDecimal>() const;
+
+}
@@ -0,0 +1,129 @@
+﻿#pragma once
+
+#include "global.h"
+
+#include "SqlDecimal.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace AsyncPg {
+
+/// Одномерный массив PostgreSql
+///
+/// Хранит массив в двоичном формате PostgreSql, что позволяет передать
+/// тысячи значений одним параметром Sql запроса (= ANY($1), UNNEST($1)).
+/// Поддерживаемые типы элементов: bool, int16_t, int32_t, int64_t, float,
+/// double, std::string, std::string_view, std::array<char, 16> (UUID) и SqlDecimal.
+class ASYNCPGLIB SqlArray
+{
+public:
+    /// Конструктор класса по умолчанию
+    SqlArray() = default;
+
+    /// Создаёт массив из двоичного значения PostgreSql
+    /// @param data Двоичное значение массива
+    /// @param length Длина двоичного значения массива
+    /// @return Массив PostgreSql
+    static SqlArray fromPg(const char *data, int length);
+
+    /// Создаёт массив из непрерывной последовательности значений
+    /// @param T Тип элемента массива
+    /// @param values Значения элементов массива
+    /// @param count Количество элементов массива
+    /// @return Массив PostgreSql
+    template<class T>
+    static SqlArray from(const T *values, std::size_t count);
+
+    /// Создаёт массив из вектора значений
+    /// @param T Тип элемента массива
+    /// @param values Значения элементов массива
+    /// @return Массив PostgreSql
+    template<class T>
+    static SqlArray from(const std::vector<T> &values)
+    {
+        return from(values.data(), values.size());
+    }
+
+    /// Создаёт массив из вектора логических значений
+    /// @param values Значения элементов массива
+    /// @return Массив PostgreSql
+    static SqlArray from(const std::vector<bool> &values)
+    {
+        const std::unique_ptr<bool[]> data(new bool[values.size()]);
+        std::copy(values.begin(), values.end(), data.get());
+        return from(data.get(), values.size());
+    }
+
+    /// Возвращает значения элементов массива
+    ///
+    /// Значения std::string_view ссылаются на данные массива. Значения NULL
+    /// заменяются значениями по умолчанию. Если тип элементов массива
+    /// не соответствует T, возвращается пустой вектор.
+    /// @param T Тип элемента массива
+    /// @return Значения элементов массива
+    template<class T>
+    std::vector<T> values() const;
+
+    /// Возвращает тип PostgreSql элемента массива
+    /// @return Тип PostgreSql элемента массива
+    unsigned int elementType() const;
+
+    /// Возвращает тип PostgreSql массива
+    /// @return Тип PostgreSql массива (0 - тип элемента не поддерживается)
+    unsigned int arrayType() const;
+
+    /// Возвращает количество элементов массива
+    /// @return Количество элементов массива
+    int size() const;
+
+    /// Проверяет содержит ли массив значения NULL
+    /// @return Результат проверки
+    bool hasNulls() const;
+
+    /// Возвращает массив в двоичном формате PostgreSql
+    /// @return Массив в двоичном формате PostgreSql
+    std::string_view bytes() const;
+
+private:
+    std::vector<char> _data;
+};
+
+/// Конвертирует тип PostgreSql массива в тип PostgreSql элемента массива
+/// @param oid Тип PostgreSql массива
+/// @return Тип PostgreSql элемента массива (0 - тип не является массивом)
+ASYNCPGLIB unsigned int toPgElementType(unsigned int oid);
+
+/// Конвертирует тип PostgreSql элемента массива в тип PostgreSql массива
+/// @param oid Тип PostgreSql элемента массива
+/// @return Тип PostgreSql массива (0 - тип не поддерживается)
+ASYNCPGLIB unsigned int toPgArrayType(unsigned int oid);
+
+extern template ASYNCPGLIB SqlArray SqlArray::from(const bool *, std::size_t);
+extern template ASYNCPGLIB SqlArray SqlArray::from(const int16_t *, std::size_t);
+extern template ASYNCPGLIB SqlArray SqlArray::from(const int32_t *, std::size_t);
+extern template ASYNCPGLIB SqlArray SqlArray::from(const int64_t *, std::size_t);
+extern template ASYNCPGLIB SqlArray SqlArray::from(const float *, std::size_t);
+extern template ASYNCPGLIB SqlArray SqlArray::from(const double *, std::size_t);
+extern template ASYNCPGLIB SqlArray SqlArray::from(const std::string *, std::size_t);
+extern template ASYNCPGLIB SqlArray SqlArray::from(const std::string_view *, std::size_t);
+extern template ASYNCPGLIB SqlArray SqlArray::from(const std::array<char, 16> *, std::size_t);
+extern template ASYNCPGLIB SqlArray SqlArray::from(const SqlDecimal *, std::size_t);
+
+extern template ASYNCPGLIB std::vector<bool> SqlArray::values<bool>() const;
+extern template ASYNCPGLIB std::vector<int16_t> SqlArray::values<int16_t>() const;
+extern template ASYNCPGLIB std::vector<int32_t> SqlArray::values<int32_t>() const;
+extern template ASYNCPGLIB std::vector<int64_t> SqlArray::values<int64_t>() const;
+extern template ASYNCPGLIB std::vector<float> SqlArray::values<float>() const;
+extern template ASYNCPGLIB std::vector<double> SqlArray::values<double>() const;
+extern template ASYNCPGLIB std::vector<std::string> SqlArray::values<std::string>() const;
+extern template ASYNCPGLIB std::vector<std::string_view> SqlArray::values<std::string_view>() const;
+extern template ASYNCPGLIB std::vector<std::array<char, 16>> SqlArray::values<std::array<char, 16>>() const;
+extern template ASYNCPGLIB std::vector<SqlDecimal> SqlArray::values<SqlDecimal>() const;
+
+}
@@ -0,0 +1,333 @@
+﻿#include "SqlArrow.h"
+#include "SqlOid.h"
+
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace AsyncPg {
+
+/// Данные схемы Arrow
+struct ArrowSchemaData
+{
+    std::string               format;
+    std::string               name;
+    std::vector<ArrowSchema>  children;
+    std::vector<ArrowSchema*> pointers;
+};
+
+/// Данные массива Arrow
+struct ArrowArrayData
+{
+    std::vector<std::vector<uint8_t>> storage;
+    std::vector<const void *>         buffers;
+    std::vector<ArrowArray>           children;
+    std::vector<ArrowArray *>         pointers;
+};
+
+static void releaseSchema(ArrowSchema *schema)
+{
+    auto *data = static_cast<ArrowSchemaData *>(schema->private_data);
+    for (auto &child : data->children) {
+        if (child.release)
+            child.release(&child);
+    }
+    delete data;
+    schema->release = nullptr;
+}
+
+static void releaseArray(ArrowArray *array)
+{
+    auto *data = static_cast<ArrowArrayData *>(array->private_data);
+    for (auto &child : data->children) {
+        if (child.release)
+            child.release(&child);
+    }
+    delete data;
+    array->release = nullptr;
+}
+
+template <typename T>
+static void appendValue(std::vector<uint8_t> &buffer, T value)
+{
+    auto size = buffer.size();
+    buffer.resize(size + sizeof(T));
+    std::memcpy(buffer.data() + size, &value, sizeof(T));
+}
+
+/// Переводит дату PostgreSql в дни от эпохи Unix, сохраняя infinity и -infinity
+static int32_t arrowDate(const char *data)
+{
+    const auto days = readBigEndian<int32_t>(data);
+    if (days == std::numeric_limits<int32_t>::max() || days == std::numeric_limits<int32_t>::min())
+        return days;
+    return days + POSTGRES_EPOCH_DAYS;
+}
+
+/// Переводит метку времени PostgreSql в микросекунды от эпохи Unix, сохраняя infinity и -infinity
+static int64_t arrowTimeStamp(const char *data)
+{
+    const auto usec = readBigEndian<int64_t>(data);
+    if (usec == std::numeric_limits<int64_t>::max() || usec == std::numeric_limits<int64_t>::min())
+        return usec;
+    return usec + POSTGRES_EPOCH_USEC;
+}
+
+/// Переводит время с часовым поясом в время UTC в микросекундах
+static int64_t arrowTimeTz(const char *data)
+{
+    // Смещение часового пояса хранится в секундах к западу от UTC
+    auto usec = readBigEndian<int64_t>(data)
+              + static_cast<int64_t>(readBigEndian<int32_t>(data + 8)) * 1000000;
+    usec %= POSTGRES_DAY_USEC;
+    return usec < 0 ? usec + POSTGRES_DAY_USEC : usec;
+}
+
+static std::string arrowFormat(unsigned int oid, bool large)
+{
+    switch (oid) {
+    case BOOLOID:
+        return "b";
+    case INT2OID:
+        return "s";
+    case INT4OID:
+        return "i";
+    case INT8OID:
+        return "l";
+    case FLOAT4OID:
+        return "f";
+    case FLOAT8OID:
+        return "g";
+    case DATEOID:
+        return "tdD";
+    case TIMEOID:
+    case TIMETZOID:
+        return "ttu";
+    case TIMESTAMPOID:
+        return "tsu:";
+    case TIMESTAMPTZOID:
+        return "tsu:UTC";
+    case UUIDOID:
+        return "w:16";
+    case NUMERICOID:
+    case CHAROID:
+    case NAMEOID:
+    case JSONOID:
+    case JSONBOID:
+    case XMLOID:
+    case VARCHAROID:
+    case TEXTOID:
+        return large ? "U" : "u";
+    default:
+        return large ? "Z" : "z";
+    }
+}
+
+/// Записывает значение фиксированной длины в буфер значений колонки
+static void appendFixed(std::vector<uint8_t> &values, unsigned int oid, const char *data)
+{
+    switch (oid) {
+    case INT2OID:
+        appendValue(values, data ? readBigEndian<int16_t>(data) : int16_t(0));
+        break;
+    case INT4OID:
+    case FLOAT4OID:
+        appendValue(values, data ? readBigEndian<int32_t>(data) : int32_t(0));
+        break;
+    case DATEOID:
+        appendValue(values, data ? arrowDate(data) : int32_t(0));
+        break;
+    case INT8OID:
+    case FLOAT8OID:
+    case TIMEOID:
+        appendValue(values, data ? readBigEndian<int64_t>(data) : int64_t(0));
+        break;
+    case TIMETZOID:
+        appendValue(values, data ? arrowTimeTz(data) : int64_t(0));
+        break;
+    case TIMESTAMPOID:
+    case TIMESTAMPTZOID:
+        appendValue(values, data ? arrowTimeStamp(data) : int64_t(0));
+        break;
+    case UUIDOID:
+        if (data)
+            values.insert(values.end(), data, data + 16);
+        else
+            values.resize(values.size() + 16);
+        break;
+    default:
+        break;
+    }
+}
+
+static bool isFixed(unsigned int oid)
+{
+    switch (oid) {
+    case INT2OID:
+    case INT4OID:
+    case INT8OID:
+    case FLOAT4OID:
+    case FLOAT8OID:
+    case DATEOID:
+    case TIMEOID:
+    case TIMETZOID:
+    case TIMESTAMPOID:
+    case TIMESTAMPTZOID:
+    case UUIDOID:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/// Записывает значения переменной длины, возвращает признак 64-битных смещений
+static bool exportVariable(
+    const SqlResult &result, unsigned int oid, int col, int row, int count, ArrowArrayData &data)
+{
+    auto &offsets = data.storage[1];
+    auto &values = data.storage[2];
+
+    std::vector<int64_t> positions;
+    positions.reserve(count + 1);
+    positions.push_back(0);
+
+    for (auto i = row, e = row + count; i < e; ++i) {
+        if (!result.isNull(i, col)) {
+            if (oid == NUMERICOID) {
+                const auto *value = result.data(i, col);
+                const auto length = result.length(i, col);
+                const auto pos = values.size();
+                values.resize(pos + numericTextSize(value, length));
+                auto *first = reinterpret_cast<char *>(values.data());
+                auto *end = numericToChars(value, length, first + pos);
+                values.resize(static_cast<std::size_t>(end - first));
+            } else if (oid == JSONBOID) {
+                auto value = result.jsonb(i, col);
+                values.insert(values.end(), value.begin(), value.end());
+            } else {
+                const auto *value = result.data(i, col);
+                values.insert(values.end(), value, value + result.length(i, col));
+            }
+        }
+        positions.push_back(static_cast<int64_t>(values.size()));
+    }
+
+    const bool large = values.size() > static_cast<std::size_t>(std::numeric_limits<int32_t>::max());
+    offsets.reserve(positions.size() * (large ? sizeof(int64_t) : sizeof(int32_t)));
+    for (auto position : positions) {
+        if (large)
+            appendValue(offsets, position);
+        else
+            appendValue(offsets, static_cast<int32_t>(position));
+    }
+
+    return large;
+}
+
+static void exportColumn(
+    const SqlResult &result, int col, int row, int count, ArrowSchema &schema, ArrowArray &array)
+{
+    // Значения в текстовом формате передаются строками
+    const auto oid = (result.format(col) == 0) ? TEXTOID : result.type(col);
+
+    auto *data = new ArrowArrayData;
+    const auto nBuffers = (isFixed(oid) || oid == BOOLOID) ? 2 : 3;
+    data->storage.resize(nBuffers);
+
+    auto &validity = data->storage[0];
+    validity.assign((count + 7) / 8, 0);
+    int64_t nullCount = 0;
+    for (auto i = 0; i < count; ++i) {
+        if (result.isNull(row + i, col))
+            ++nullCount;
+        else
+            validity[i / 8] |= static_cast<uint8_t>(1 << (i % 8));
+    }
+
+    bool large = false;
+    if (oid == BOOLOID) {
+        auto &values = data->storage[1];
+        values.assign((count + 7) / 8, 0);
+        for (auto i = 0; i < count; ++i) {
+            if (!result.isNull(row + i, col) && *result.data(row + i, col) != 0)
+                values[i / 8] |= static_cast<uint8_t>(1 << (i % 8));
+        }
+    } else if (isFixed(oid)) {
+        auto &values = data->storage[1];
+        for (auto i = row, e = row + count; i < e; ++i)
+            appendFixed(values, oid, result.isNull(i, col) ? nullptr : result.data(i, col));
+    } else {
+        large = exportVariable(result, oid, col, row, count, *data);
+    }
+
+    for (auto &buffer : data->storage)
+        data->buffers.push_back(buffer.data());
+    if (nullCount == 0)
+        data->buffers[0] = nullptr;
+
+    array = ArrowArray{};
+    array.length = count;
+    array.null_count = nullCount;
+    array.n_buffers = nBuffers;
+    array.buffers = data->buffers.data();
+    array.release = releaseArray;
+    array.private_data = data;
+
+    auto *schemaData = new ArrowSchemaData;
+    schemaData->format = arrowFormat(oid, large);
+    schemaData->name = result.fieldName(col);
+
+    schema = ArrowSchema{};
+    schema.format = schemaData->format.c_str();
+    schema.name = schemaData->name.c_str();
+    schema.flags = ARROW_FLAG_NULLABLE;
+    schema.release = releaseSchema;
+    schema.private_data = schemaData;
+}
+
+bool exportArrow(const SqlResult &result, ArrowSchema *schema, ArrowArray *array, int row, int count)
+{
+    if (!result || row < 0 || row > result.rows())
+        return false;
+
+    if (count < 0 || row + count > result.rows())
+        count = result.rows() - row;
+
+    const auto columns = result.columns();
+
+    auto *schemaData = new ArrowSchemaData;
+    schemaData->format = "+s";
+    schemaData->children.resize(columns);
+
+    auto *arrayData = new ArrowArrayData;
+    arrayData->buffers.push_back(nullptr);
+    arrayData->children.resize(columns);
+
+    for (int col = 0; col < columns; ++col) {
+        exportColumn(result, col, row, count, schemaData->children[col], arrayData->children[col]);
+        schemaData->pointers.push_back(&schemaData->children[col]);
+        arrayData->pointers.push_back(&arrayData->children[col]);
+    }
+
+    *schema = ArrowSchema{};
+    schema->format = schemaData->format.c_str();
+    schema->name = schemaData->name.c_str();
+    schema->n_children = columns;
+    schema->children = schemaData->pointers.data();
+    schema->release = releaseSchema;
+    schema->private_data = schemaData;
+
+    *array = ArrowArray{};
+    array->length = count;
+    array->n_buffers = 1;
+    array->n_children = columns;
+    array->buffers = arrayData->buffers.data();
+    array->children = arrayData->pointers.data();
+    array->release = releaseArray;
+    array->private_data = arrayData;
+
+    return true;
+}
+
+}
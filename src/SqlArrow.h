@@ -0,0 +1,66 @@
+﻿#pragma once
+
+#include "global.h"
+
+#include "SqlResult.h"
+
+#include <cstdint>
+
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+extern "C" {
+
+/// Схема Arrow C Data Interface
+struct ArrowSchema
+{
+    const char *format;
+    const char *name;
+    const char *metadata;
+    int64_t flags;
+    int64_t n_children;
+    struct ArrowSchema **children;
+    struct ArrowSchema *dictionary;
+    void (*release)(struct ArrowSchema *);
+    void *private_data;
+};
+
+/// Массив Arrow C Data Interface
+struct ArrowArray
+{
+    int64_t length;
+    int64_t null_count;
+    int64_t offset;
+    int64_t n_buffers;
+    int64_t n_children;
+    const void **buffers;
+    struct ArrowArray **children;
+    struct ArrowArray *dictionary;
+    void (*release)(struct ArrowArray *);
+    void *private_data;
+};
+
+}
+
+#endif
+
+namespace AsyncPg {
+
+/// Экспортирует строки результата Sql запроса в пакет записей Arrow C Data Interface
+///
+/// Время с часовым поясом приводится к UTC. Даты и метки времени infinity и -infinity
+/// экспортируются граничными значениями типа.
+/// @param result Результат Sql запроса
+/// @param schema Схема пакета записей (структура с колонками результата)
+/// @param array Пакет записей
+/// @param row Номер первой экспортируемой строки
+/// @param count Количество экспортируемых строк (-1 - до конца результата)
+/// @return Результат операции
+ASYNCPGLIB bool exportArrow(
+    const SqlResult &result, ArrowSchema *schema, ArrowArray *array, int row = 0, int count = -1);
+
+}
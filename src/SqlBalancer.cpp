@@ -0,0 +1,133 @@
+﻿#include "SqlBalancer.h"
+#include "SqlConnect.h"
+
+#include <algorithm>
+
+namespace AsyncPg {
+
+SqlBalancer::SqlBalancer(SqlBalancerOptions options)
+    : _options(options)
+    , _random(std::random_device()())
+{
+}
+
+std::size_t SqlBalancer::add(SqlConnect *connect)
+{
+    Host host;
+    host.connect = connect;
+    _hosts.push_back(host);
+    return _hosts.size() - 1;
+}
+
+std::size_t SqlBalancer::select(const Filter &filter)
+{
+    updateEjection(Clock::now());
+
+    std::vector<std::size_t> candidates;
+    candidates.reserve(_hosts.size());
+    for (std::size_t i = 0; i < _hosts.size(); ++i) {
+        const auto &host = _hosts[i];
+        if (host.isEjected || host.connect->error() == ErrorCode::ConnectionFailed)
+            continue;
+        if (!filter || filter(i))
+            candidates.push_back(i);
+    }
+
+    if (candidates.empty())
+        return _hosts.size();
+    if (candidates.size() == 1)
+        return candidates.front();
+
+    // Два различных случайных соединения
+    std::uniform_int_distribution<std::size_t> distribution(0, candidates.size() - 1);
+    auto first = distribution(_random);
+    auto second = distribution(_random);
+    if (second == first)
+        second = (first + 1) % candidates.size();
+
+    // Новые и возвращённые после исключения соединения оцениваются по медиане,
+    // чтобы глубина их очереди учитывалась при выборе
+    std::vector<std::chrono::microseconds> latencies;
+    latencies.reserve(candidates.size());
+    for (auto index : candidates) {
+        if (_hosts[index].connect->latency().count() != 0)
+            latencies.push_back(_hosts[index].connect->latency());
+    }
+    std::chrono::microseconds estimate{1};
+    if (!latencies.empty()) {
+        auto middle = latencies.begin() + static_cast<std::ptrdiff_t>((latencies.size() - 1) / 2);
+        std::nth_element(latencies.begin(), middle, latencies.end());
+        estimate = *middle;
+    }
+
+    const auto firstIndex = candidates[first];
+    const auto secondIndex = candidates[second];
+    return cost(_hosts[secondIndex], estimate) < cost(_hosts[firstIndex], estimate)
+        ? secondIndex : firstIndex;
+}
+
+void SqlBalancer::updateEjection(Clock::time_point now)
+{
+    std::size_t ejected = 0;
+    std::vector<std::chrono::microseconds> latencies;
+    latencies.reserve(_hosts.size());
+
+    for (auto &host : _hosts) {
+        if (host.isEjected && now >= host.ejectedUntil) {
+            // Время выполнения запросов до исключения не учитывается
+            host.isEjected = false;
+            host.connect->resetLatency();
+        }
+
+        if (host.isEjected)
+            ++ejected;
+        else if (host.connect->latency().count() != 0)
+            latencies.push_back(host.connect->latency());
+    }
+
+    if (latencies.size() < 2)
+        return;
+
+    auto middle = latencies.begin() + static_cast<std::ptrdiff_t>((latencies.size() - 1) / 2);
+    std::nth_element(latencies.begin(), middle, latencies.end());
+    const auto threshold = std::max(
+        std::chrono::duration_cast<std::chrono::microseconds>(*middle * _options.ejectFactor),
+        _options.minEjectLatency);
+
+    const auto maxEjected = static_cast<std::size_t>(
+        static_cast<double>(_hosts.size()) * _options.maxEjected);
+    for (auto &host : _hosts) {
+        if (ejected >= maxEjected)
+            break;
+        if (!host.isEjected && host.connect->latency() > threshold) {
+            host.isEjected = true;
+            host.ejectedUntil = now + _options.ejectTime;
+            ++ejected;
+        }
+    }
+}
+
+double SqlBalancer::cost(const Host &host, std::chrono::microseconds estimate) const
+{
+    auto latency = host.connect->latency();
+    if (latency.count() == 0)
+        latency = estimate;
+    return static_cast<double>(latency.count()) * static_cast<double>(host.connect->inFlight() + 1);
+}
+
+SqlConnect *SqlBalancer::connect(std::size_t index) const
+{
+    return _hosts.at(index).connect;
+}
+
+bool SqlBalancer::isEjected(std::size_t index) const
+{
+    return _hosts.at(index).isEjected;
+}
+
+std::size_t SqlBalancer::size() const
+{
+    return _hosts.size();
+}
+
+}
@@ -0,0 +1,100 @@
+﻿#pragma once
+
+#include "global.h"
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <random>
+#include <vector>
+
+namespace AsyncPg {
+
+class SqlConnect;
+
+/// Параметры балансировщика соединений
+struct SqlBalancerOptions
+{
+    /// Соединение исключается, если время выполнения запросов превышает медианное
+    /// в заданное число раз
+    double ejectFactor = 3.0;
+
+    /// Соединения с временем выполнения запросов ниже порога не исключаются
+    std::chrono::microseconds minEjectLatency{10000};
+
+    /// Длительность исключения соединения
+    std::chrono::milliseconds ejectTime{30000};
+
+    /// Максимальная доля одновременно исключённых соединений
+    double maxEjected = 0.5;
+};
+
+/// Балансировщик запросов между соединениями с разными серверами
+///
+/// Соединение выбирается из двух случайных соединений по наименьшей стоимости:
+/// сглаженному времени выполнения запросов, умноженному на количество выполняемых
+/// и ожидающих команд. Для соединений без измеренного времени выполнения используется
+/// медианное время остальных соединений. Медленные соединения временно исключаются
+/// из выбора, после исключения их время выполнения запросов измеряется заново.
+/// Соединения с ошибкой ErrorCode::ConnectionFailed не выбираются.
+class ASYNCPGLIB SqlBalancer
+{
+public:
+    /// Фильтр соединений, принимающий номер соединения
+    using Filter = std::function<bool(std::size_t)>;
+
+    /// Конструктор класса
+    /// @param options Параметры балансировщика
+    explicit SqlBalancer(SqlBalancerOptions options = {});
+
+    /// Добавляет соединение
+    /// @param connect Соединение с базой данных, существующее до уничтожения балансировщика
+    /// @return Номер соединения
+    std::size_t add(SqlConnect *connect);
+
+    /// Выбирает соединение
+    /// @param filter Фильтр допустимых соединений (nullptr - все соединения)
+    /// @return Номер соединения или size(), если допустимых соединений нет
+    std::size_t select(const Filter &filter = nullptr);
+
+    /// Возвращает соединение
+    /// @param index Номер соединения
+    /// @return Соединение с базой данных
+    SqlConnect *connect(std::size_t index) const;
+
+    /// Проверяет исключено ли соединение из выбора
+    /// @param index Номер соединения
+    /// @return Результат проверки
+    bool isEjected(std::size_t index) const;
+
+    /// Возвращает количество соединений
+    /// @return Количество соединений
+    std::size_t size() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    /// Соединение балансировщика
+    struct Host
+    {
+        SqlConnect        *connect = nullptr;  ///< Соединение с базой данных
+        Clock::time_point  ejectedUntil;       ///< Время окончания исключения
+        bool               isEjected = false;  ///< Соединение исключено
+    };
+
+    /// Обновляет исключение медленных соединений
+    /// @param now Текущее время
+    void updateEjection(Clock::time_point now);
+
+    /// Возвращает стоимость выбора соединения
+    /// @param host Соединение балансировщика
+    /// @param estimate Время выполнения запросов соединения без измерений
+    /// @return Стоимость выбора соединения
+    double cost(const Host &host, std::chrono::microseconds estimate) const;
+
+    SqlBalancerOptions  _options;
+    std::vector<Host>   _hosts;
+    std::minstd_rand    _random;
+};
+
+}
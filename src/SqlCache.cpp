@@ -0,0 +1,211 @@
+﻿#include "SqlCache.h"
+#include "SqlConnect.h"
+
+#include <cstring>
+
+namespace AsyncPg {
+
+/// Дописывает в ключ целое число
+static void appendInt(std::string &key, int64_t value)
+{
+    char bytes[sizeof(value)];
+    std::memcpy(bytes, &value, sizeof(value));
+    key.append(bytes, sizeof(bytes));
+}
+
+std::string sqlQueryKey(std::string_view sql, const std::vector<SqlValue> &params)
+{
+    std::string key(sql);
+    key += '\0';
+
+    for (const auto &param : params) {
+        // Строки и массивы байт не копируются
+        if (auto pgParam = asPgParam(param)) {
+            appendInt(key, pgParam->oid);
+            appendInt(key, pgParam->data ? pgParam->length : -1);
+            if (pgParam->data)
+                key.append(pgParam->data, static_cast<std::size_t>(pgParam->length));
+        } else {
+            const auto &[oid, length, value] = asPgValue(param);
+            appendInt(key, oid);
+            appendInt(key, value ? static_cast<int64_t>(length) : -1);
+            if (value)
+                key.append(value, length);
+            delete[] value;
+        }
+
+        // Пользовательские типы с одинаковым значением различаются наименованием
+        const auto *custom = std::get_if<SqlType::Custom>(&param);
+        if (custom && *custom) {
+            appendInt(key, static_cast<int64_t>((*custom)->typeName.size()));
+            key += (*custom)->typeName;
+        }
+    }
+    return key;
+}
+
+SqlCache::SqlCache(SqlCacheOptions options)
+    : _options(options)
+{
+}
+
+void SqlCache::execute(SqlConnect &connect, std::string_view sql, std::vector<SqlValue> params,
+                       std::vector<std::string> tags, Callback func,
+                       std::chrono::milliseconds ttl)
+{
+    auto key = sqlQueryKey(sql, params);
+    if (auto result = findKey(key)) {
+        func(SqlError(), result);
+        return;
+    }
+
+    connect.execute(sql, std::move(params));
+    connect.post([this, key = std::move(key), tags = std::move(tags), func = std::move(func), ttl,
+                  generation = _generation](SqlConnect *self) mutable {
+        if (self->error()) {
+            func(self->error(), nullptr);
+            return;
+        }
+
+        auto result = self->takeResult();
+        // Результат, полученный до удаления по тегу, может быть устаревшим
+        if (generation == _generation)
+            insertKey(std::move(key), result, std::move(tags), ttl);
+        func(self->error(), result);
+    });
+}
+
+SqlSharedResult SqlCache::find(std::string_view sql, const std::vector<SqlValue> &params)
+{
+    return findKey(sqlQueryKey(sql, params));
+}
+
+void SqlCache::insert(std::string_view sql, const std::vector<SqlValue> &params,
+                      SqlSharedResult result, std::vector<std::string> tags,
+                      std::chrono::milliseconds ttl)
+{
+    insertKey(sqlQueryKey(sql, params), std::move(result), std::move(tags), ttl);
+}
+
+SqlSharedResult SqlCache::findKey(const std::string &key)
+{
+    auto it = _index.find(key);
+    if (it == _index.end()) {
+        ++_misses;
+        return nullptr;
+    }
+
+    auto entry = it->second;
+    if (Clock::now() >= entry->expires) {
+        erase(entry);
+        ++_misses;
+        return nullptr;
+    }
+
+    // Использованный результат переносится в начало списка
+    _entries.splice(_entries.begin(), _entries, entry);
+    ++_hits;
+    return entry->result;
+}
+
+void SqlCache::insertKey(std::string key, SqlSharedResult result, std::vector<std::string> tags,
+                         std::chrono::milliseconds ttl)
+{
+    if (!result)
+        return;
+
+    if (auto it = _index.find(key); it != _index.end())
+        erase(it->second);
+
+    const auto bytes = result->memorySize() + key.size();
+    if (bytes > _options.maxBytes)
+        return;
+
+    Entry entry;
+    entry.key = std::move(key);
+    entry.result = std::move(result);
+    entry.tags = std::move(tags);
+    entry.expires = Clock::now() + (ttl.count() > 0 ? ttl : _options.ttl);
+    entry.bytes = bytes;
+    _entries.push_front(std::move(entry));
+
+    const auto &inserted = _entries.front();
+    _index.emplace(inserted.key, _entries.begin());
+    for (const auto &tag : inserted.tags)
+        _tags[tag].insert(inserted.key);
+    _bytes += bytes;
+
+    while (_bytes > _options.maxBytes)
+        erase(std::prev(_entries.end()));
+}
+
+void SqlCache::erase(EntryList::iterator it)
+{
+    for (const auto &tag : it->tags) {
+        auto tagIt = _tags.find(tag);
+        if (tagIt == _tags.end())
+            continue;
+        tagIt->second.erase(it->key);
+        if (tagIt->second.empty())
+            _tags.erase(tagIt);
+    }
+
+    _index.erase(it->key);
+    _bytes -= it->bytes;
+    _entries.erase(it);
+}
+
+void SqlCache::invalidate(std::string_view tag)
+{
+    ++_generation;
+
+    auto tagIt = _tags.find(std::string(tag));
+    if (tagIt == _tags.end())
+        return;
+
+    const auto keys = std::move(tagIt->second);
+    _tags.erase(tagIt);
+    for (const auto &key : keys) {
+        auto it = _index.find(key);
+        if (it != _index.end())
+            erase(it->second);
+    }
+}
+
+void SqlCache::clear()
+{
+    ++_generation;
+    _index.clear();
+    _tags.clear();
+    _entries.clear();
+    _bytes = 0;
+}
+
+void SqlCache::listen(SqlConnect &connect, std::string_view channel)
+{
+    connect.listen(channel, [this](SqlConnect *, std::string_view channel, std::string_view payload) {
+        invalidate(payload.empty() ? channel : payload);
+    });
+}
+
+std::size_t SqlCache::size() const
+{
+    return _entries.size();
+}
+
+std::size_t SqlCache::bytes() const
+{
+    return _bytes;
+}
+
+uint64_t SqlCache::hits() const
+{
+    return _hits;
+}
+
+uint64_t SqlCache::misses() const
+{
+    return _misses;
+}
+
+}
@@ -0,0 +1,163 @@
+﻿#pragma once
+
+#include "global.h"
+
+#include "SqlError.h"
+#include "SqlResult.h"
+#include "SqlValue.h"
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace AsyncPg {
+
+class SqlConnect;
+
+/// Возвращает ключ запроса из текста запроса и двоичных значений параметров
+/// @param sql Запрос к базе данных
+/// @param params Параметры запроса
+/// @return Ключ запроса
+ASYNCPGLIB std::string sqlQueryKey(std::string_view sql, const std::vector<SqlValue> &params);
+
+/// Параметры кэша результатов запросов
+struct SqlCacheOptions
+{
+    std::size_t                maxBytes = 64 * 1024 * 1024;  ///< Максимальный размер результатов
+    std::chrono::milliseconds  ttl{60000};                   ///< Время жизни результата по умолчанию
+};
+
+/// Кэш результатов запросов
+///
+/// Результат запроса сохраняется по ключу из текста запроса и двоичных значений
+/// параметров. При попадании в кэш запрос к базе данных не выполняется, обработчик
+/// получает разделяемый неизменяемый результат. Результаты удаляются по истечении
+/// времени жизни, при превышении размера кэша (давно не используемые) и по тегам,
+/// например, наименованиям таблиц, в том числе по уведомлениям NOTIFY.
+/// Кэш используется в потоке цикла событий и должен существовать до завершения запросов.
+class ASYNCPGLIB SqlCache
+{
+public:
+    /// Функция обратного вызова результата запроса
+    using Callback = std::function<void(const SqlError &error, const SqlSharedResult &result)>;
+
+    /// Конструктор класса
+    /// @param options Параметры кэша
+    explicit SqlCache(SqlCacheOptions options = {});
+
+    /// Конструктор копирования
+    SqlCache(const SqlCache &) = delete;
+
+    /// Оператор копирования
+    void operator=(const SqlCache &) = delete;
+
+    /// Выполняет запрос к базе данных, если его результата нет в кэше
+    ///
+    /// При попадании в кэш обработчик вызывается сразу. Результат запроса, во время
+    /// выполнения которого кэш был очищен по тегу, не сохраняется.
+    /// @param connect Соединение с базой данных
+    /// @param sql Запрос к базе данных, существующий до выполнения запроса
+    /// @param params Параметры запроса
+    /// @param tags Теги результата
+    /// @param func Обработчик результата
+    /// @param ttl Время жизни результата (0 - время жизни по умолчанию)
+    void execute(SqlConnect &connect, std::string_view sql, std::vector<SqlValue> params,
+                 std::vector<std::string> tags, Callback func,
+                 std::chrono::milliseconds ttl = std::chrono::milliseconds(0));
+
+    /// Возвращает результат запроса из кэша
+    /// @param sql Запрос к базе данных
+    /// @param params Параметры запроса
+    /// @return Результат запроса или nullptr, если его нет в кэше
+    SqlSharedResult find(std::string_view sql, const std::vector<SqlValue> &params);
+
+    /// Сохраняет результат запроса в кэше
+    /// @param sql Запрос к базе данных
+    /// @param params Параметры запроса
+    /// @param result Результат запроса
+    /// @param tags Теги результата
+    /// @param ttl Время жизни результата (0 - время жизни по умолчанию)
+    void insert(std::string_view sql, const std::vector<SqlValue> &params, SqlSharedResult result,
+                std::vector<std::string> tags,
+                std::chrono::milliseconds ttl = std::chrono::milliseconds(0));
+
+    /// Удаляет результаты с тегом
+    /// @param tag Тег результата
+    void invalidate(std::string_view tag);
+
+    /// Удаляет все результаты
+    void clear();
+
+    /// Подписывает кэш на уведомления канала
+    ///
+    /// Уведомление удаляет результаты с тегом, равным содержимому уведомления,
+    /// а при пустом содержимом - с тегом, равным наименованию канала.
+    /// @param connect Соединение с базой данных
+    /// @param channel Наименование канала
+    void listen(SqlConnect &connect, std::string_view channel);
+
+    /// Возвращает количество результатов
+    /// @return Количество результатов
+    std::size_t size() const;
+
+    /// Возвращает размер результатов
+    /// @return Размер результатов в байтах
+    std::size_t bytes() const;
+
+    /// Возвращает количество попаданий в кэш
+    /// @return Количество попаданий
+    uint64_t hits() const;
+
+    /// Возвращает количество промахов кэша
+    /// @return Количество промахов
+    uint64_t misses() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    /// Результат запроса в кэше
+    struct Entry
+    {
+        std::string               key;       ///< Ключ результата
+        SqlSharedResult           result;    ///< Результат запроса
+        std::vector<std::string>  tags;      ///< Теги результата
+        Clock::time_point         expires;   ///< Время окончания жизни
+        std::size_t               bytes = 0; ///< Размер результата
+    };
+
+    using EntryList = std::list<Entry>;
+
+    /// Возвращает результат запроса из кэша по ключу
+    /// @param key Ключ результата
+    /// @return Результат запроса или nullptr
+    SqlSharedResult findKey(const std::string &key);
+
+    /// Сохраняет результат запроса в кэше по ключу
+    /// @param key Ключ результата
+    /// @param result Результат запроса
+    /// @param tags Теги результата
+    /// @param ttl Время жизни результата
+    void insertKey(std::string key, SqlSharedResult result, std::vector<std::string> tags,
+                   std::chrono::milliseconds ttl);
+
+    /// Удаляет результат
+    /// @param it Результат запроса в кэше
+    void erase(EntryList::iterator it);
+
+    SqlCacheOptions                                          _options;
+    EntryList                                                _entries;
+    std::unordered_map<std::string_view, EntryList::iterator> _index;
+    std::unordered_map<std::string, std::unordered_set<std::string_view>> _tags;
+    std::size_t                                              _bytes = 0;
+    uint64_t                                                 _generation = 0;
+    uint64_t                                                 _hits = 0;
+    uint64_t                                                 _misses = 0;
+};
+
+}
@@ -0,0 +1,455 @@
+﻿#include "SqlCell.h"
+
+#include <algorithm>
+
+namespace AsyncPg {
+
+static_assert(sizeof(SqlCell) == 24, "SqlCell must fit in 24 bytes");
+
+SqlCell::SqlCell(SqlType type)
+{
+    _type = static_cast<uint8_t>(type);
+}
+
+SqlCell::SqlCell(SqlType type, const char *data, std::size_t size,
+                 std::pmr::memory_resource *resource)
+{
+    setBytes(type, data, size, resource);
+}
+
+SqlCell::SqlCell(const SqlValue &value, std::pmr::memory_resource *resource)
+{
+    switch (value.index()) {
+    case SqlType::Boolean:
+        setScalar(SqlType::Boolean, std::get<SqlType::Boolean>(value));
+        break;
+    case SqlType::SmallInt:
+        setScalar(SqlType::SmallInt, std::get<SqlType::SmallInt>(value));
+        break;
+    case SqlType::Integer:
+        setScalar(SqlType::Integer, std::get<SqlType::Integer>(value));
+        break;
+    case SqlType::BigInt:
+        setScalar(SqlType::BigInt, std::get<SqlType::BigInt>(value));
+        break;
+    case SqlType::Real:
+        setScalar(SqlType::Real, std::get<SqlType::Real>(value));
+        break;
+    case SqlType::Double:
+        setScalar(SqlType::Double, std::get<SqlType::Double>(value));
+        break;
+    case SqlType::Date:
+        setScalar(SqlType::Date, std::get<SqlType::Date>(value));
+        break;
+    case SqlType::Time:
+        setScalar(SqlType::Time, std::get<SqlType::Time>(value));
+        break;
+    case SqlType::TimeTz:
+        setScalar(SqlType::TimeTz, std::get<SqlType::TimeTz>(value));
+        break;
+    case SqlType::TimeStamp:
+        setScalar(SqlType::TimeStamp, std::get<SqlType::TimeStamp>(value));
+        break;
+    case SqlType::TimeStampTz:
+        setScalar(SqlType::TimeStampTz, std::get<SqlType::TimeStampTz>(value));
+        break;
+    case SqlType::TimeStampUs:
+        setScalar(SqlType::TimeStampUs, std::get<SqlType::TimeStampUs>(value));
+        break;
+    case SqlType::TimeStampTzUs:
+        setScalar(SqlType::TimeStampTzUs, std::get<SqlType::TimeStampTzUs>(value));
+        break;
+    case SqlType::TimeUs:
+        setScalar(SqlType::TimeUs, std::get<SqlType::TimeUs>(value));
+        break;
+    case SqlType::DateDays:
+        setScalar(SqlType::DateDays, std::get<SqlType::DateDays>(value));
+        break;
+    case SqlType::Interval:
+        setScalar(SqlType::Interval, std::get<SqlType::Interval>(value));
+        break;
+    case SqlType::Uuid:
+        setScalar(SqlType::Uuid, std::get<SqlType::Uuid>(value));
+        break;
+    case SqlType::Bytea: {
+        const auto &bytes = std::get<SqlType::Bytea>(value);
+        if (bytes)
+            setBytes(SqlType::Bytea, bytes->data(), bytes->size(), resource);
+        else
+            _type = SqlType::Bytea;
+    } break;
+    case SqlType::Array: {
+        const auto &array = std::get<SqlType::Array>(value);
+        if (array) {
+            auto bytes = array->bytes();
+            setBytes(SqlType::Array, bytes.data(), bytes.size(), resource);
+        } else {
+            _type = SqlType::Array;
+        }
+    } break;
+    case SqlType::Custom: {
+        // Наименование типа хранится перед двоичным значением через нулевой символ
+        const auto &custom = std::get<SqlType::Custom>(value);
+        if (custom) {
+            std::string bytes;
+            bytes.reserve(custom->typeName.size() + 1 + custom->bytes.size());
+            bytes.append(custom->typeName).push_back('\0');
+            bytes.append(custom->bytes.data(), custom->bytes.size());
+            setBytes(SqlType::Custom, bytes.data(), bytes.size(), resource);
+        } else {
+            _type = SqlType::Custom;
+        }
+    } break;
+    case SqlType::Numeric: {
+        const auto &decimal = std::get<SqlType::Numeric>(value);
+        if (decimal) {
+            auto str = decimal->toString();
+            setBytes(SqlType::Numeric, str.data(), str.size(), resource);
+        } else {
+            _type = SqlType::Numeric;
+        }
+    } break;
+    case SqlType::Decimal:
+    case SqlType::Char:
+    case SqlType::Json:
+    case SqlType::Name:
+    case SqlType::Text:
+    case SqlType::VarChar:
+    case SqlType::Xml:
+    case SqlType::Jsonb: {
+        const auto type = static_cast<SqlType>(value.index());
+        std::visit([this, type, resource](const auto &str) {
+            using T = std::decay_t<decltype(str)>;
+            if constexpr (std::is_same_v<T, std::optional<std::string>>) {
+                if (str)
+                    setBytes(type, str->data(), str->size(), resource);
+                else
+                    _type = static_cast<uint8_t>(type);
+            }
+        }, value);
+    } break;
+    default:
+        break;
+    }
+}
+
+SqlCell::SqlCell(const SqlCell &other)
+{
+    if (other._size == HeapSize) {
+        auto bytes = other.view();
+        setBytes(other.type(), bytes.data(), bytes.size(), nullptr);
+    } else {
+        std::memcpy(_data, other._data, InlineSize);
+        _type = other._type;
+        _size = other._size;
+    }
+}
+
+SqlCell &SqlCell::operator=(const SqlCell &other)
+{
+    if (this != &other) {
+        SqlCell copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+SqlCell::SqlCell(SqlCell &&other) noexcept
+{
+    std::memcpy(_data, other._data, InlineSize);
+    _type = other._type;
+    _size = other._size;
+
+    other._type = SqlType::None;
+    other._size = NullSize;
+}
+
+SqlCell &SqlCell::operator=(SqlCell &&other) noexcept
+{
+    if (this != &other) {
+        reset();
+        std::memcpy(_data, other._data, InlineSize);
+        _type = other._type;
+        _size = other._size;
+
+        other._type = SqlType::None;
+        other._size = NullSize;
+    }
+    return *this;
+}
+
+SqlCell::~SqlCell()
+{
+    reset();
+}
+
+SqlType SqlCell::type() const
+{
+    return static_cast<SqlType>(_type);
+}
+
+bool SqlCell::isNull() const
+{
+    return _size == NullSize;
+}
+
+std::string_view SqlCell::view() const
+{
+    if (_size == NullSize)
+        return {};
+
+    if (_size == HeapSize) {
+        const char *block = nullptr;
+        std::size_t size = 0;
+        std::memcpy(&block, _data, sizeof(block));
+        std::memcpy(&size, _data + sizeof(block), sizeof(size));
+        return {block + HeapHeader, size};
+    }
+
+    return {_data, _size};
+}
+
+template<std::size_t I>
+static SqlValue scalarValue(const SqlCell &cell)
+{
+    using T = typename std::variant_alternative_t<I, SqlValue>::value_type;
+    if (cell.isNull())
+        return SqlValue(std::in_place_index<I>);
+    return SqlValue(std::in_place_index<I>, cell.scalar<T>());
+}
+
+template<std::size_t I>
+static SqlValue stringValue(const SqlCell &cell)
+{
+    if (cell.isNull())
+        return SqlValue(std::in_place_index<I>);
+    auto bytes = cell.view();
+    return SqlValue(std::in_place_index<I>, std::string(bytes.data(), bytes.size()));
+}
+
+SqlValue SqlCell::value() const
+{
+    switch (_type) {
+    case SqlType::Boolean:
+        return scalarValue<SqlType::Boolean>(*this);
+    case SqlType::SmallInt:
+        return scalarValue<SqlType::SmallInt>(*this);
+    case SqlType::Integer:
+        return scalarValue<SqlType::Integer>(*this);
+    case SqlType::BigInt:
+        return scalarValue<SqlType::BigInt>(*this);
+    case SqlType::Real:
+        return scalarValue<SqlType::Real>(*this);
+    case SqlType::Double:
+        return scalarValue<SqlType::Double>(*this);
+    case SqlType::Date:
+        return scalarValue<SqlType::Date>(*this);
+    case SqlType::Time:
+        return scalarValue<SqlType::Time>(*this);
+    case SqlType::TimeTz:
+        return scalarValue<SqlType::TimeTz>(*this);
+    case SqlType::TimeStamp:
+        return scalarValue<SqlType::TimeStamp>(*this);
+    case SqlType::TimeStampTz:
+        return scalarValue<SqlType::TimeStampTz>(*this);
+    case SqlType::TimeStampUs:
+        return scalarValue<SqlType::TimeStampUs>(*this);
+    case SqlType::TimeStampTzUs:
+        return scalarValue<SqlType::TimeStampTzUs>(*this);
+    case SqlType::TimeUs:
+        return scalarValue<SqlType::TimeUs>(*this);
+    case SqlType::DateDays:
+        return scalarValue<SqlType::DateDays>(*this);
+    case SqlType::Interval:
+        return scalarValue<SqlType::Interval>(*this);
+    case SqlType::Uuid:
+        return scalarValue<SqlType::Uuid>(*this);
+    case SqlType::Decimal:
+        return stringValue<SqlType::Decimal>(*this);
+    case SqlType::Char:
+        return stringValue<SqlType::Char>(*this);
+    case SqlType::Json:
+        return stringValue<SqlType::Json>(*this);
+    case SqlType::Name:
+        return stringValue<SqlType::Name>(*this);
+    case SqlType::Text:
+        return stringValue<SqlType::Text>(*this);
+    case SqlType::VarChar:
+        return stringValue<SqlType::VarChar>(*this);
+    case SqlType::Xml:
+        return stringValue<SqlType::Xml>(*this);
+    case SqlType::Jsonb:
+        return stringValue<SqlType::Jsonb>(*this);
+    case SqlType::Bytea: {
+        if (isNull())
+            return SqlValue(std::in_place_index<SqlType::Bytea>);
+        auto bytes = view();
+        return SqlValue(
+            std::in_place_index<SqlType::Bytea>, std::vector<char>(bytes.begin(), bytes.end()));
+    }
+    case SqlType::Array: {
+        if (isNull())
+            return SqlValue(std::in_place_index<SqlType::Array>);
+        auto bytes = view();
+        return SqlValue(std::in_place_index<SqlType::Array>,
+                        SqlArray::fromPg(bytes.data(), static_cast<int>(bytes.size())));
+    }
+    case SqlType::Numeric: {
+        if (isNull())
+            return SqlValue(std::in_place_index<SqlType::Numeric>);
+        return SqlValue(std::in_place_index<SqlType::Numeric>, SqlDecimal::fromString(view()));
+    }
+    case SqlType::Custom: {
+        if (isNull())
+            return SqlValue(std::in_place_index<SqlType::Custom>);
+        auto bytes = view();
+        const auto name = std::min(bytes.find('\0'), bytes.size());
+        const auto data = bytes.substr(std::min(name + 1, bytes.size()));
+        return SqlValue(std::in_place_index<SqlType::Custom>,
+                        SqlCustom{std::string(bytes.substr(0, name)),
+                                  std::vector<char>(data.begin(), data.end())});
+    }
+    default:
+        break;
+    }
+    return SqlValue();
+}
+
+template<class T>
+void SqlCell::setScalar(SqlType type, const std::optional<T> &value)
+{
+    static_assert(sizeof(T) <= InlineSize, "Scalar value must fit in SqlCell");
+
+    _type = static_cast<uint8_t>(type);
+    if (value) {
+        std::memcpy(_data, &*value, sizeof(T));
+        _size = 0;
+    }
+}
+
+void SqlCell::setBytes(SqlType type, const char *data, std::size_t size,
+                       std::pmr::memory_resource *resource)
+{
+    _type = static_cast<uint8_t>(type);
+    if (size <= InlineSize) {
+        std::memcpy(_data, data, size);
+        _size = static_cast<uint8_t>(size);
+        return;
+    }
+
+    // Ресурс памяти хранится в заголовке блока, так как не помещается в значение
+    if (!resource)
+        resource = std::pmr::get_default_resource();
+    auto *block = static_cast<char *>(resource->allocate(HeapHeader + size, alignof(void *)));
+    std::memcpy(block, &resource, sizeof(resource));
+    std::memcpy(block + HeapHeader, data, size);
+    std::memcpy(_data, &block, sizeof(block));
+    std::memcpy(_data + sizeof(block), &size, sizeof(size));
+    _size = HeapSize;
+}
+
+void SqlCell::reset()
+{
+    if (_size == HeapSize) {
+        char *block = nullptr;
+        std::size_t size = 0;
+        std::pmr::memory_resource *resource = nullptr;
+        std::memcpy(&block, _data, sizeof(block));
+        std::memcpy(&size, _data + sizeof(block), sizeof(size));
+        std::memcpy(&resource, block, sizeof(resource));
+        resource->deallocate(block, HeapHeader + size, alignof(void *));
+    }
+    _size = NullSize;
+}
+
+SqlCell asSqlCell(unsigned int oid, const char *data, int length,
+                  std::pmr::memory_resource *resource)
+{
+    const auto type = toSqlType(oid);
+    if (!data)
+        return SqlCell(type);
+
+    switch (type) {
+    case SqlType::Array:
+    case SqlType::Bytea:
+    case SqlType::Char:
+    case SqlType::Json:
+    case SqlType::Name:
+    case SqlType::Text:
+    case SqlType::VarChar:
+    case SqlType::Xml:
+        return SqlCell(type, data, static_cast<std::size_t>(length), resource);
+    case SqlType::Jsonb:
+        // Значение jsonb начинается с байта версии формата
+        return (length > 0)
+            ? SqlCell(type, data + 1, static_cast<std::size_t>(length - 1), resource)
+            : SqlCell(type, data, 0, resource);
+    default:
+        break;
+    }
+    return SqlCell(asSqlValue(oid, data, length), resource);
+}
+
+std::tuple<unsigned int, std::size_t, char *> asPgValue(const SqlCell &value)
+{
+    switch (value.type()) {
+    case SqlType::Bytea:
+    case SqlType::Char:
+    case SqlType::Json:
+    case SqlType::Name:
+    case SqlType::Text:
+    case SqlType::VarChar:
+    case SqlType::Xml: {
+        const auto oid = toPgType(value.type());
+        if (value.isNull())
+            return std::make_tuple(oid, 0, nullptr);
+
+        auto bytes = value.view();
+        char *v = new char[bytes.size()];
+        std::memcpy(v, bytes.data(), bytes.size());
+        return std::make_tuple(oid, bytes.size(), v);
+    }
+    default:
+        break;
+    }
+    return asPgValue(value.value());
+}
+
+
+std::optional<SqlParam> asPgParam(const SqlCell &value)
+{
+    switch (value.type()) {
+    case SqlType::Array:
+    case SqlType::Bytea:
+    case SqlType::Char:
+    case SqlType::Json:
+    case SqlType::Name:
+    case SqlType::Text:
+    case SqlType::VarChar:
+    case SqlType::Xml: {
+        SqlParam param;
+        if (!value.isNull()) {
+            auto bytes = value.view();
+            param.data = bytes.data();
+            param.length = static_cast<int>(bytes.size());
+        }
+        if (value.type() == SqlType::Array) {
+            // Тип массива определяется по типу элемента из заголовка массива
+            const auto *header = reinterpret_cast<const uint8_t *>(param.data);
+            if (param.length >= 12) {
+                param.oid = toPgArrayType(
+                    (static_cast<unsigned int>(header[8]) << 24) | (header[9] << 16)
+                    | (header[10] << 8) | header[11]);
+            }
+        } else {
+            param.oid = toPgType(value.type());
+        }
+        return param;
+    }
+    default:
+        break;
+    }
+    return std::nullopt;
+}
+
+}
@@ -0,0 +1,141 @@
+﻿#pragma once
+
+#include "global.h"
+
+#include "SqlValue.h"
+
+#include <cstring>
+#include <memory_resource>
+#include <string_view>
+
+namespace AsyncPg {
+
+/// Компактное значение поля строки результата Sql запроса
+///
+/// Занимает 24 байта. Скалярные значения, UUID и строки длиной до 22 байт
+/// хранятся внутри значения, в куче размещаются только более длинные строки.
+/// Память для длинных строк выделяется из заданного ресурса памяти, который
+/// должен существовать до уничтожения значения. Копия значения использует
+/// ресурс памяти по умолчанию, перемещение сохраняет ресурс памяти.
+/// Значение пользовательского типа хранится как наименование типа,
+/// нулевой символ и двоичное значение.
+class ASYNCPGLIB SqlCell
+{
+public:
+    /// Конструктор класса по умолчанию
+    SqlCell() = default;
+
+    /// Конструктор NULL значения
+    /// @param type Тип поля строки результата Sql запроса
+    explicit SqlCell(SqlType type);
+
+    /// Конструктор строкового значения
+    /// @param type Тип поля строки результата Sql запроса
+    /// @param data Данные значения
+    /// @param size Размер данных значения
+    /// @param resource Ресурс памяти (nullptr - ресурс памяти по умолчанию)
+    SqlCell(SqlType type, const char *data, std::size_t size,
+            std::pmr::memory_resource *resource = nullptr);
+
+    /// Конструктор класса
+    /// @param value Значение поля строки результата Sql запроса
+    /// @param resource Ресурс памяти (nullptr - ресурс памяти по умолчанию)
+    explicit SqlCell(const SqlValue &value, std::pmr::memory_resource *resource = nullptr);
+
+    /// Конструктор копирования
+    /// @param other Значение
+    SqlCell(const SqlCell &other);
+
+    /// Оператор копирования
+    /// @param other Значение
+    /// @return Значение
+    SqlCell &operator=(const SqlCell &other);
+
+    /// Конструктор перемещения
+    /// @param other Значение
+    SqlCell(SqlCell &&other) noexcept;
+
+    /// Оператор перемещения
+    /// @param other Значение
+    /// @return Значение
+    SqlCell &operator=(SqlCell &&other) noexcept;
+
+    /// Деструктор класса
+    ~SqlCell();
+
+    /// Возвращает тип значения
+    /// @return Тип поля строки результата Sql запроса
+    SqlType type() const;
+
+    /// Проверяет равно ли значение NULL
+    /// @return Результат проверки
+    bool isNull() const;
+
+    /// Возвращает скалярное значение
+    /// @param T Тип скалярного значения
+    /// @return Скалярное значение
+    template<class T>
+    T scalar() const
+    {
+        T result{};
+        std::memcpy(&result, _data, sizeof(T));
+        return result;
+    }
+
+    /// Возвращает данные строкового значения
+    /// @return Данные строкового значения
+    std::string_view view() const;
+
+    /// Возвращает значение поля строки результата Sql запроса
+    /// @return Значение поля строки результата Sql запроса
+    SqlValue value() const;
+
+    /// Возвращает значение поля строки результата Sql запроса
+    /// @param I Тип поля строки результата Sql запроса
+    /// @return Значение поля строки результата Sql запроса
+    template<std::size_t I>
+    std::variant_alternative_t<I, SqlValue> get() const
+    {
+        auto value = this->value();
+        if (auto *result = std::get_if<I>(&value))
+            return *result;
+        return std::nullopt;
+    }
+
+private:
+    static constexpr std::size_t InlineSize = 22;
+    static constexpr uint8_t     HeapSize   = 0xFE;
+    static constexpr uint8_t     NullSize   = 0xFF;
+    static constexpr std::size_t HeapHeader = sizeof(void *);
+
+    template<class T>
+    void setScalar(SqlType type, const std::optional<T> &value);
+    void setBytes(SqlType type, const char *data, std::size_t size,
+                  std::pmr::memory_resource *resource);
+    void reset();
+
+    alignas(8) char _data[InlineSize] = {};
+    uint8_t         _type = SqlType::None;
+    uint8_t         _size = NullSize;
+};
+
+/// Конвертирует значение PostgreSql в компактное значение поля строки результата Sql запроса
+/// @param oid Тип PostgreSql
+/// @param data Значение PostgreSql в двоичном формате (nullptr - NULL)
+/// @param length Длина значения PostgreSql
+/// @param resource Ресурс памяти (nullptr - ресурс памяти по умолчанию)
+/// @return Компактное значение поля строки результата Sql запроса
+ASYNCPGLIB SqlCell asSqlCell(unsigned int oid, const char *data, int length,
+                             std::pmr::memory_resource *resource = nullptr);
+
+/// Конвертирует компактное значение поля строки результата Sql запроса в значение PostgreSql
+/// @param value Компактное значение поля строки результата Sql запроса
+/// @return Значение PostgreSql
+ASYNCPGLIB std::tuple<unsigned int, std::size_t, char *> asPgValue(const SqlCell &value);
+
+/// Возвращает параметр Sql запроса, ссылающийся на данные значения без копирования
+/// @param value Компактное значение поля строки результата Sql запроса
+/// @return Параметр Sql запроса или std::nullopt, если значение требует кодирования
+ASYNCPGLIB std::optional<SqlParam> asPgParam(const SqlCell &value);
+
+}
@@ -0,0 +1,105 @@
+﻿#include "SqlCoalescer.h"
+#include "SqlCache.h"
+#include "SqlConnect.h"
+
+#include <algorithm>
+
+namespace AsyncPg {
+
+/// Выполняющийся запрос
+struct SqlFlight
+{
+    std::string                                                 key;
+    SqlConnect                                                 *connect = nullptr;
+    std::vector<std::pair<SqlCoalescer::Waiter, SqlCoalescer::Callback>>  waiters;
+    uint64_t                                                    command = 0;
+    bool                                                        isAbandoned = false;
+};
+
+SqlCoalescer::Waiter SqlCoalescer::execute(SqlConnect &connect, std::string_view sql,
+                                           std::vector<SqlValue> params, Callback func)
+{
+    const auto waiter = _nextWaiter++;
+    auto key = sqlQueryKey(sql, params);
+
+    if (auto it = _flights.find(key); it != _flights.end()) {
+        it->second->waiters.emplace_back(waiter, std::move(func));
+        _waiters.emplace(waiter, it->second);
+        ++_coalesced;
+        return waiter;
+    }
+
+    auto flight = std::make_shared<SqlFlight>();
+    flight->key = key;
+    flight->connect = &connect;
+    flight->waiters.emplace_back(waiter, std::move(func));
+    _flights.emplace(std::move(key), flight);
+    _waiters.emplace(waiter, flight);
+
+    connect.execute(sql, std::move(params));
+    flight->command = connect.lastCommand();
+    connect.post([this, flight](SqlConnect *self) {
+        finish(flight, self);
+    });
+    return waiter;
+}
+
+bool SqlCoalescer::detach(Waiter waiter)
+{
+    auto it = _waiters.find(waiter);
+    if (it == _waiters.end())
+        return false;
+
+    auto flight = std::move(it->second);
+    _waiters.erase(it);
+
+    auto &waiters = flight->waiters;
+    waiters.erase(std::remove_if(waiters.begin(), waiters.end(),
+                                 [waiter](const auto &item) { return item.first == waiter; }),
+                  waiters.end());
+    if (!waiters.empty())
+        return true;
+
+    // Следующий такой же запрос не должен присоединиться к прерываемому
+    flight->isAbandoned = true;
+    if (auto flightIt = _flights.find(flight->key);
+        flightIt != _flights.end() && flightIt->second == flight) {
+        _flights.erase(flightIt);
+    }
+    // Запрос прерывается, только если он ещё выполняется соединением
+    flight->connect->interrupt(flight->command);
+    return true;
+}
+
+void SqlCoalescer::finish(const std::shared_ptr<SqlFlight> &flight, SqlConnect *connect)
+{
+    if (flight->isAbandoned)
+        return;
+
+    _flights.erase(flight->key);
+    const auto waiters = std::move(flight->waiters);
+    flight->waiters.clear();
+    for (const auto &item : waiters)
+        _waiters.erase(item.first);
+
+    const auto error = connect->error();
+    SqlSharedResult result;
+    if (!error)
+        result = connect->takeResult();
+
+    // Обработчики получают один результат и могут выполнять новые запросы
+    for (const auto &item : waiters)
+        item.second(error, result);
+}
+
+std::size_t SqlCoalescer::size() const
+{
+    return _flights.size();
+}
+
+uint64_t SqlCoalescer::coalesced() const
+{
+    return _coalesced;
+}
+
+}
@@ -0,0 +1,86 @@
+﻿#pragma once
+
+#include "global.h"
+
+#include "SqlError.h"
+#include "SqlResult.h"
+#include "SqlValue.h"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace AsyncPg {
+
+class SqlConnect;
+struct SqlFlight;
+
+/// Объединение одинаковых выполняющихся запросов
+///
+/// Запрос с тем же текстом и двоичными значениями параметров, что и выполняющийся
+/// запрос, не отправляется на сервер, а ожидает результата выполняющегося запроса.
+/// Все ожидающие получают один разделяемый результат или одну и ту же ошибку.
+/// Ожидающий может отказаться от результата; если отказались все ожидающие,
+/// запрос прерывается. Объект используется в потоке цикла событий и должен
+/// существовать до завершения запросов.
+class ASYNCPGLIB SqlCoalescer
+{
+public:
+    /// Функция обратного вызова результата запроса
+    using Callback = std::function<void(const SqlError &error, const SqlSharedResult &result)>;
+
+    /// Идентификатор ожидающего результата
+    using Waiter = uint64_t;
+
+    /// Конструктор класса по умолчанию
+    SqlCoalescer() = default;
+
+    /// Конструктор копирования
+    SqlCoalescer(const SqlCoalescer &) = delete;
+
+    /// Оператор копирования
+    void operator=(const SqlCoalescer &) = delete;
+
+    /// Выполняет запрос к базе данных или присоединяется к выполняющемуся запросу
+    /// @param connect Соединение для выполнения нового запроса
+    /// @param sql Запрос к базе данных, существующий до выполнения запроса
+    /// @param params Параметры запроса
+    /// @param func Обработчик результата
+    /// @return Идентификатор ожидающего результата
+    Waiter execute(SqlConnect &connect, std::string_view sql, std::vector<SqlValue> params,
+                   Callback func);
+
+    /// Отказывается от результата запроса
+    ///
+    /// Обработчик ожидающего не вызывается. Если ожидающих больше нет, следующий такой же
+    /// запрос отправляется на сервер заново, а этот запрос прерывается, если он ещё
+    /// выполняется и за ним в очереди соединения нет других запросов.
+    /// @param waiter Идентификатор ожидающего результата
+    /// @return Ожидал ли результата идентификатор
+    bool detach(Waiter waiter);
+
+    /// Возвращает количество выполняющихся запросов
+    /// @return Количество запросов
+    std::size_t size() const;
+
+    /// Возвращает количество присоединений к выполняющимся запросам
+    /// @return Количество присоединений
+    uint64_t coalesced() const;
+
+private:
+    /// Обрабатывает завершение запроса
+    /// @param flight Выполняющийся запрос
+    /// @param connect Соединение с результатом запроса
+    void finish(const std::shared_ptr<SqlFlight> &flight, SqlConnect *connect);
+
+    std::unordered_map<std::string, std::shared_ptr<SqlFlight>>  _flights;
+    std::unordered_map<Waiter, std::shared_ptr<SqlFlight>>       _waiters;
+    Waiter                                                       _nextWaiter = 1;
+    uint64_t                                                     _coalesced = 0;
+};
+
+}
@@ -0,0 +1,131 @@
+﻿#include "SqlCodec.h"
+
+#include <algorithm>
+#include <mutex>
+
+namespace AsyncPg {
+
+static std::mutex &codecMutex()
+{
+    static std::mutex mutex;
+    return mutex;
+}
+
+static std::vector<SqlCodec> &codecRegistry()
+{
+    static std::vector<SqlCodec> codecs;
+    return codecs;
+}
+
+void registerSqlCodec(SqlCodec codec)
+{
+    std::lock_guard<std::mutex> lock(codecMutex());
+    auto &codecs = codecRegistry();
+    auto it = std::find_if(codecs.begin(), codecs.end(), [&codec](const SqlCodec &item) {
+        return item.typeName == codec.typeName;
+    });
+    if (it != codecs.end())
+        *it = std::move(codec);
+    else
+        codecs.push_back(std::move(codec));
+}
+
+std::vector<SqlCodec> sqlCodecs()
+{
+    std::lock_guard<std::mutex> lock(codecMutex());
+    return codecRegistry();
+}
+
+SqlValue makeSqlCustom(std::string_view typeName, const SqlValue &value)
+{
+    SqlCodec::Encoder encode;
+    {
+        std::lock_guard<std::mutex> lock(codecMutex());
+        for (const auto &codec : codecRegistry()) {
+            if (codec.typeName == typeName) {
+                encode = codec.encode;
+                break;
+            }
+        }
+    }
+
+    if (!encode)
+        return SqlValue(std::in_place_index<SqlType::Custom>);
+
+    return SqlValue(std::in_place_index<SqlType::Custom>,
+                    SqlCustom{std::string(typeName), encode(value)});
+}
+
+SqlTypeMap::SqlTypeMap(std::vector<SqlCodec> codecs,
+                       const std::vector<std::pair<unsigned int, std::string>> &types)
+    : _codecs(std::move(codecs))
+    , _oids(_codecs.size(), 0)
+{
+    std::size_t capacity = 1;
+    _shift = 32;
+    while (capacity < types.size() * 2) {
+        capacity <<= 1;
+        --_shift;
+    }
+    _slots.resize(capacity);
+
+    for (const auto &[oid, typeName] : types) {
+        auto it = std::find_if(_codecs.begin(), _codecs.end(), [&typeName](const SqlCodec &codec) {
+            return codec.typeName == typeName;
+        });
+        if (oid == 0 || it == _codecs.end())
+            continue;
+
+        const auto index = static_cast<std::size_t>(it - _codecs.begin());
+        if (_oids[index] != 0)
+            continue;
+        _oids[index] = oid;
+
+        auto pos = slot(oid);
+        while (_slots[pos].oid != 0)
+            pos = (pos + 1) & (_slots.size() - 1);
+        _slots[pos] = Slot{oid, static_cast<uint32_t>(index)};
+    }
+}
+
+const SqlCodec *SqlTypeMap::find(unsigned int oid) const
+{
+    if (oid == 0)
+        return nullptr;
+
+    for (auto pos = slot(oid); _slots[pos].oid != 0; pos = (pos + 1) & (_slots.size() - 1)) {
+        if (_slots[pos].oid == oid)
+            return &_codecs[_slots[pos].index];
+    }
+    return nullptr;
+}
+
+unsigned int SqlTypeMap::oid(std::string_view typeName) const
+{
+    for (std::size_t i = 0; i < _codecs.size(); ++i) {
+        if (_codecs[i].typeName == typeName)
+            return _oids[i];
+    }
+    return 0;
+}
+
+SqlValue SqlTypeMap::decode(const SqlCodec &codec, const char *data, int length)
+{
+    if (codec.decode)
+        return codec.decode(data, length);
+
+    if (!data)
+        return SqlValue(std::in_place_index<SqlType::Custom>);
+
+    return SqlValue(std::in_place_index<SqlType::Custom>,
+                    SqlCustom{codec.typeName, std::vector<char>(data, data + length)});
+}
+
+std::size_t SqlTypeMap::slot(unsigned int oid) const
+{
+    // Мультипликативное хеширование Фибоначчи
+    const auto hash = static_cast<uint32_t>(oid * 2654435769U);
+    return (_shift >= 32) ? 0 : static_cast<std::size_t>(hash >> _shift);
+}
+
+}
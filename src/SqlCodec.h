@@ -0,0 +1,93 @@
+﻿#pragma once
+
+#include "global.h"
+
+#include "SqlValue.h"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace AsyncPg {
+
+/// Кодек пользовательского типа PostgreSql
+///
+/// Кодеки регистрируются по наименованию типа до создания соединений.
+/// Типы PostgreSql кодеков определяются при соединении одним запросом к pg_type.
+struct ASYNCPGLIB SqlCodec
+{
+    /// Декодирует двоичное значение PostgreSql (data == nullptr - NULL)
+    using Decoder = std::function<SqlValue(const char *data, int length)>;
+
+    /// Кодирует значение в двоичный формат PostgreSql
+    using Encoder = std::function<std::vector<char>(const SqlValue &value)>;
+
+    std::string  typeName;  ///< Наименование типа (pg_type.typname)
+    Decoder      decode;    ///< Декодер (пустой - значение SqlCustom)
+    Encoder      encode;    ///< Кодер (пустой - значение передаётся только как SqlCustom)
+};
+
+/// Регистрирует кодек пользовательского типа PostgreSql
+///
+/// Кодек с уже зарегистрированным наименованием типа заменяется.
+/// @param codec Кодек пользовательского типа PostgreSql
+ASYNCPGLIB void registerSqlCodec(SqlCodec codec);
+
+/// Возвращает зарегистрированные кодеки пользовательских типов PostgreSql
+/// @return Кодеки пользовательских типов PostgreSql
+ASYNCPGLIB std::vector<SqlCodec> sqlCodecs();
+
+/// Кодирует значение в пользовательский тип PostgreSql зарегистрированным кодеком
+/// @param typeName Наименование типа
+/// @param value Значение
+/// @return Значение пользовательского типа (NULL, если кодер не зарегистрирован)
+ASYNCPGLIB SqlValue makeSqlCustom(std::string_view typeName, const SqlValue &value);
+
+/// Таблица пользовательских типов PostgreSql соединения
+///
+/// Поиск кодека по типу PostgreSql выполняется по хеш-таблице с открытой адресацией.
+class ASYNCPGLIB SqlTypeMap
+{
+public:
+    /// Конструктор класса
+    /// @param codecs Кодеки пользовательских типов
+    /// @param types Типы PostgreSql и наименования типов из pg_type
+    SqlTypeMap(std::vector<SqlCodec> codecs,
+               const std::vector<std::pair<unsigned int, std::string>> &types);
+
+    /// Возвращает кодек по типу PostgreSql
+    /// @param oid Тип PostgreSql
+    /// @return Кодек или nullptr, если тип не зарегистрирован
+    const SqlCodec *find(unsigned int oid) const;
+
+    /// Возвращает тип PostgreSql по наименованию типа
+    /// @param typeName Наименование типа
+    /// @return Тип PostgreSql (0 - тип не найден)
+    unsigned int oid(std::string_view typeName) const;
+
+    /// Декодирует значение пользовательского типа PostgreSql
+    /// @param codec Кодек пользовательского типа
+    /// @param data Значение PostgreSql в двоичном формате (nullptr - NULL)
+    /// @param length Длина значения PostgreSql
+    /// @return Значение поля строки результата Sql запроса
+    static SqlValue decode(const SqlCodec &codec, const char *data, int length);
+
+private:
+    struct Slot
+    {
+        unsigned int  oid = 0;
+        uint32_t      index = 0;
+    };
+
+    std::size_t slot(unsigned int oid) const;
+
+    std::vector<SqlCodec>      _codecs;
+    std::vector<unsigned int>  _oids;
+    std::vector<Slot>          _slots;
+    int                        _shift = 32;
+};
+
+}
@@ -1,12 +1,21 @@
 ﻿#include "SqlConnect.h"
+#include "SqlCell.h"
+#include "SqlCodec.h"
 #include "SqlError.h"
+#include "SqlOid.h"
 #include "SqlValue.h"
 
 #include <event.h>
 #include <event2/event.h>
 #include <libpq-fe.h>
 
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
 #include <iostream>
+#include <mutex>
+#include <thread>
 
 #ifdef _WIN32
 #include <io.h>
@@ -14,6 +23,12 @@
 #include <unistd.h>
 #endif
 
+#ifdef _WIN32
+#define LOCAL_SOCKETPAIR_AF AF_INET
+#else
+#define LOCAL_SOCKETPAIR_AF AF_UNIX
+#endif
+
 namespace AsyncPg {
 
 static void ev_connecting(evutil_socket_t /*fd*/, short /*what*/, void *arg)
@@ -22,6 +37,42 @@ static void ev_connecting(evutil_socket_t /*fd*/, short /*what*/, void *arg)
     sqlConnect->connecting();
 }
 
+static void ev_resolving(evutil_socket_t /*fd*/, short /*what*/, void *arg)
+{
+    auto *sqlConnect = reinterpret_cast<SqlConnect *>(arg);
+    sqlConnect->resolving();
+}
+
+static void ev_stepping(evutil_socket_t /*fd*/, short /*what*/, void *arg)
+{
+    auto *sqlConnect = reinterpret_cast<SqlConnect *>(arg);
+    sqlConnect->stepping();
+}
+
+static void ev_scripting(evutil_socket_t /*fd*/, short /*what*/, void *arg)
+{
+    auto *sqlConnect = reinterpret_cast<SqlConnect *>(arg);
+    sqlConnect->scripting();
+}
+
+static void ev_transacting(evutil_socket_t /*fd*/, short /*what*/, void *arg)
+{
+    auto *sqlConnect = reinterpret_cast<SqlConnect *>(arg);
+    sqlConnect->transacting();
+}
+
+static void ev_rollingBack(evutil_socket_t /*fd*/, short /*what*/, void *arg)
+{
+    auto *sqlConnect = reinterpret_cast<SqlConnect *>(arg);
+    sqlConnect->rollingBack();
+}
+
+static void ev_notifying(evutil_socket_t /*fd*/, short /*what*/, void *arg)
+{
+    auto *sqlConnect = reinterpret_cast<SqlConnect *>(arg);
+    sqlConnect->notifying();
+}
+
 static void ev_preparing(evutil_socket_t /*fd*/, short /*what*/, void *arg)
 {
     auto *sqlConnect = reinterpret_cast<SqlConnect *>(arg);
@@ -34,7 +85,317 @@ static void ev_executing(evutil_socket_t /*fd*/, short /*what*/, void *arg)
     sqlConnect->executing();
 }
 
-SqlConnect::SqlConnect(std::string_view connInfo, event_base *evbase)
+/// Параметры запроса PostgreSql
+struct PgParams
+{
+    template<class Params>
+    PgParams(const Params &params, std::pmr::memory_resource *resource,
+             const SqlTypeMap *typeMap = nullptr)
+        : types(resource), values(resource), lengths(resource), formats(resource), owned(resource)
+    {
+        const auto nParams = params.size();
+        types.resize(nParams);
+        values.resize(nParams);
+        lengths.resize(nParams);
+        formats.resize(nParams, 1);
+
+        using Value = typename Params::value_type;
+        for (std::size_t i = 0; i < nParams; ++i) {
+            // Строки и массивы байт передаются без копирования
+            std::optional<SqlParam> param;
+            if constexpr (std::is_same_v<Value, SqlParam>)
+                param = params[i];
+            else
+                param = asPgParam(params[i]);
+
+            if (param) {
+                types[i] = param->oid;
+                values[i] = param->data;
+                lengths[i] = param->length;
+                formats[i] = param->format;
+            } else if constexpr (!std::is_same_v<Value, SqlParam>) {
+                const auto &[oid, length, value] = asPgValue(params[i]);
+                types[i] = oid;
+                values[i] = value;
+                lengths[i] = static_cast<int>(length);
+                owned.push_back(value);
+
+                // Значение, которое не удалось закодировать, не передаётся как NULL
+                bool isNull = false;
+                if constexpr (std::is_same_v<Value, SqlCell>)
+                    isNull = params[i].isNull();
+                else
+                    isNull = isNullValue(params[i]);
+                if (!value && !isNull && error.empty())
+                    error = "Invalid value of parameter $" + std::to_string(i + 1);
+            }
+
+            // Тип пользовательского значения определяется по наименованию типа
+            if constexpr (std::is_same_v<Value, SqlValue>) {
+                const auto *custom = std::get_if<SqlType::Custom>(&params[i]);
+                if (typeMap && types[i] == 0 && custom && *custom)
+                    types[i] = typeMap->oid((*custom)->typeName);
+            } else if constexpr (std::is_same_v<Value, SqlCell>) {
+                const auto &cell = params[i];
+                if (typeMap && types[i] == 0 && cell.type() == SqlType::Custom && !cell.isNull()) {
+                    const auto bytes = cell.view();
+                    types[i] = typeMap->oid(bytes.substr(0, bytes.find('\0')));
+                }
+            }
+        }
+    }
+
+    void append(const std::vector<SqlParam> &params)
+    {
+        for (const auto &param : params) {
+            types.push_back(param.oid);
+            values.push_back(param.data);
+            lengths.push_back(param.length);
+            formats.push_back(param.format);
+        }
+    }
+
+    ~PgParams()
+    {
+        for (auto *value : owned)
+            delete[] value;
+    }
+
+    PgParams(const PgParams &) = delete;
+    void operator=(const PgParams &) = delete;
+
+    int size() const
+    {
+        return static_cast<int>(values.size());
+    }
+
+    std::pmr::vector<unsigned int> types;
+    std::pmr::vector<const char *> values;
+    std::pmr::vector<int>          lengths;
+    std::pmr::vector<int>          formats;
+    std::pmr::vector<char *>       owned;
+    std::string                    error;  ///< Ошибка кодирования параметров
+};
+
+/// Возвращает размер данных значения, принадлежащих значению
+static std::size_t payloadSize(const SqlValue &value)
+{
+    return sizeof(SqlValue) + std::visit([](const auto &alternative) -> std::size_t {
+        using T = std::decay_t<decltype(alternative)>;
+        if constexpr (std::is_same_v<T, std::optional<std::string>>
+                      || std::is_same_v<T, std::optional<std::vector<char>>>) {
+            return alternative ? alternative->capacity() : 0;
+        } else if constexpr (std::is_same_v<T, std::optional<SqlArray>>) {
+            return alternative ? alternative->bytes().size() : 0;
+        } else if constexpr (std::is_same_v<T, std::optional<SqlCustom>>) {
+            return alternative ? alternative->typeName.capacity() + alternative->bytes.capacity() : 0;
+        } else {
+            return 0;
+        }
+    }, value);
+}
+
+static std::size_t payloadSize(const SqlCell &value)
+{
+    // Строки, не поместившиеся в значение, размещаются в куче
+    auto size = value.view().size();
+    return sizeof(SqlCell) + (size > 22 ? size : 0);
+}
+
+static std::size_t payloadSize(const SqlParam & /*param*/)
+{
+    // Данные параметра принадлежат вызывающей стороне
+    return sizeof(SqlParam);
+}
+
+/// Возвращает размер данных параметров запроса
+template<class Params>
+static std::size_t payloadSize(const Params &params)
+{
+    std::size_t size = 0;
+    for (const auto &param : params)
+        size += payloadSize(param);
+    return size;
+}
+
+/// Шаг потоковой передачи данных
+enum class StreamStage {
+    Begin,
+    Open,
+    Truncate,
+    Transfer,
+    Close,
+    End,
+    Done,
+};
+
+/// Состояние потоковой передачи данных
+struct SqlStreaming
+{
+    std::string            sql;                 ///< Запрос фрагмента
+    std::vector<SqlValue>  params;              ///< Параметры запроса фрагмента
+    SqlChunkSink           sink;                ///< Приёмник фрагментов (чтение)
+    SqlChunkSource         source;              ///< Источник фрагментов (запись)
+    SqlStreamCallback      done;                ///< Обработчик завершения
+    std::vector<char>      buffer;              ///< Буфер записываемого фрагмента
+    std::size_t            chunkSize = 0;       ///< Размер фрагмента
+    std::size_t            pending = 0;         ///< Размер отправленного фрагмента
+    uint64_t               bytes = 0;           ///< Количество переданных байт
+    char                   loid[4] = {};        ///< Идентификатор большого объекта (oid)
+    char                   mode[4] = {};        ///< Режим открытия большого объекта (int4)
+    char                   fd[4] = {};          ///< Дескриптор большого объекта (int4)
+    char                   offset[4] = {};      ///< Позиция фрагмента bytea (int4)
+    char                   size[4] = {};        ///< Размер фрагмента (int4)
+    StreamStage            stage = StreamStage::Begin;
+    bool                   largeObject = false; ///< Передача большого объекта
+    bool                   transaction = false; ///< Транзакция открыта передачей
+};
+
+static SqlParam int32Param(unsigned int oid, const char (&value)[4])
+{
+    return SqlParam{oid, value, 4, 1};
+}
+
+/// Поток отправки запросов отмены
+///
+/// PQcancel ожидает ответа сервера, поэтому запросы отмены всех соединений
+/// отправляются по очереди одним фоновым потоком.
+class CancelWorker
+{
+public:
+    ~CancelWorker()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _isStopped = true;
+        }
+        _wakeup.notify_one();
+        if (_thread.joinable())
+            _thread.join();
+        for (auto *cancelObject : _queue)
+            PQfreeCancel(cancelObject);
+    }
+
+    /// Добавляет запрос отмены в очередь, поток освобождает объект отмены
+    void post(PGcancel *cancelObject)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _queue.push_back(cancelObject);
+            if (!_thread.joinable())
+                _thread = std::thread(&CancelWorker::run, this);
+        }
+        _wakeup.notify_one();
+    }
+
+private:
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        for (;;) {
+            _wakeup.wait(lock, [this]() { return _isStopped || !_queue.empty(); });
+            if (_isStopped)
+                return;
+
+            auto *cancelObject = _queue.front();
+            _queue.pop_front();
+            lock.unlock();
+
+            char errorBuffer[256];
+            PQcancel(cancelObject, errorBuffer, sizeof(errorBuffer));
+            PQfreeCancel(cancelObject);
+            lock.lock();
+        }
+    }
+
+    std::mutex                 _mutex;
+    std::condition_variable    _wakeup;
+    std::deque<PGcancel *>     _queue;
+    std::thread                _thread;
+    bool                       _isStopped = false;
+};
+
+static CancelWorker &cancelWorker()
+{
+    static CancelWorker worker;
+    return worker;
+}
+
+/// Фоновое декодирование результатов Sql запросов соединения
+///
+/// Поток декодирования создаётся при первом вызове decode() и используется
+/// соединением повторно. Декодируемый результат принадлежит заданию, поэтому
+/// не зависит от перемещения соединения.
+struct SqlDecoding
+{
+    SqlConnect               *owner = nullptr;  ///< Соединение с базой данных
+    std::thread               thread;           ///< Поток декодирования
+    std::mutex                mutex;            ///< Защита задания
+    std::condition_variable   wakeup;           ///< Появление задания
+    evutil_socket_t           sockets[2] = {-1, -1};  ///< Сигнал завершения задания
+    struct event             *event = nullptr;  ///< Событие завершения задания
+    bool                      isStopped = false;  ///< Поток завершается
+    bool                      isPending = false;  ///< Задание ожидает декодирования
+    bool                      isDone = false;     ///< Задание декодировано
+
+    SqlResult                      result;   ///< Декодируемый результат
+    SqlLayout                      layout = SqlLayout::Rows;  ///< Раскладка результата
+    unsigned int                   threads = 0;  ///< Количество потоков
+    SqlTable                       table;    ///< Декодированный результат
+    SqlConnect::DecodeCallback     func;     ///< Обработчик декодированного результата
+
+    ~SqlDecoding()
+    {
+        if (thread.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                isStopped = true;
+            }
+            wakeup.notify_one();
+            thread.join();
+        }
+        if (event)
+            event_free(event);
+        if (sockets[0] != -1)
+            evutil_closesocket(sockets[0]);
+        if (sockets[1] != -1)
+            evutil_closesocket(sockets[1]);
+    }
+
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            wakeup.wait(lock, [this]() { return isStopped || isPending; });
+            if (isStopped)
+                return;
+
+            lock.unlock();
+            auto decoded = decodeResult(result, layout, threads);
+            lock.lock();
+
+            table = std::move(decoded);
+            isPending = false;
+            isDone = true;
+            send(sockets[1], "", 1, 0);
+        }
+    }
+};
+
+static void ev_decoding(evutil_socket_t fd, short /*what*/, void *arg)
+{
+    char buffer[16];
+    recv(fd, buffer, sizeof(buffer), 0);
+
+    auto *decoding = reinterpret_cast<SqlDecoding *>(arg);
+    decoding->owner->decoding();
+}
+
+SqlConnect::SqlConnect(std::string_view connInfo, event_base *evbase,
+                       std::pmr::memory_resource *resource)
+    : _pool(std::make_shared<MemoryPool>(
+          resource ? resource : std::pmr::get_default_resource()))
+    , _lanes{CallbackQueue(_pool.get()), CallbackQueue(_pool.get()), CallbackQueue(_pool.get())}
 {
     _evbase = evbase;
     _connInfo = connInfo;
@@ -52,39 +413,123 @@ SqlConnect::SqlConnect(std::string_view connInfo, event_base *evbase)
 }
 
 SqlConnect::SqlConnect(SqlConnect &&other) noexcept
+    : _pool(other._pool)
+    , _lanes(std::move(other._lanes))
 {
     _evbase         = other._evbase;
-    _callbackQueue  = std::move(other._callbackQueue);
     _connect        = other._connect;
     _connInfo       = std::move(other._connInfo);
     _error          = std::move(other._error);
     _result         = std::move(other._result);
+    _partial        = std::move(other._partial);
+    _results        = std::move(other._results);
+    _onResult       = std::move(other._onResult);
+    _listeners      = std::move(other._listeners);
+    _pipelineQuery  = other._pipelineQuery;
+    _pipelineSize   = other._pipelineSize;
+    _isDropped      = other._isDropped;
+    _lastCommand    = other._lastCommand;
+    _command        = other._command;
+    _sentAt         = other._sentAt;
+    _latency        = other._latency;
+    _memory         = std::move(other._memory);
+    _limits         = other._limits;
+    _schedule       = other._schedule;
+    _waits          = other._waits;
+    _credits        = other._credits;
+    _priority       = other._priority;
+    _lane           = other._lane;
+    _tailLane       = other._tailLane;
+    _queueLimits    = other._queueLimits;
+    _onReady        = std::move(other._onReady);
+    _queuedQueries  = other._queuedQueries;
+    _isOverflow     = other._isOverflow;
+    _types          = std::move(other._types);
+    _typeError      = std::move(other._typeError);
+    _decoding       = std::move(other._decoding);
     _isExec         = other._isExec;
+    _singleRow      = other._singleRow;
     _socket         = other._socket;
 
     other._evbase  = nullptr;
     other._connect = nullptr;
+
+    if (_decoding)
+        _decoding->owner = this;
+
+    // Событие ожидания уведомлений ссылается на прежний объект
+    if (other._notifyEvent) {
+        event_free(other._notifyEvent);
+        other._notifyEvent = nullptr;
+        if (!_isExec)
+            watchNotifies();
+    }
 }
 
 SqlConnect &SqlConnect::operator=(SqlConnect &&other) noexcept
 {
     _evbase         = other._evbase;
-    _callbackQueue  = std::move(other._callbackQueue);
+    _lanes          = std::move(other._lanes);
     _connect        = other._connect;
     _connInfo       = std::move(other._connInfo);
     _error          = std::move(other._error);
     _result         = std::move(other._result);
+    _partial        = std::move(other._partial);
+    _results        = std::move(other._results);
+    _onResult       = std::move(other._onResult);
+    _listeners      = std::move(other._listeners);
+    _pipelineQuery  = other._pipelineQuery;
+    _pipelineSize   = other._pipelineSize;
+    _isDropped      = other._isDropped;
+    _lastCommand    = other._lastCommand;
+    _command        = other._command;
+    _sentAt         = other._sentAt;
+    _latency        = other._latency;
+    _memory         = std::move(other._memory);
+    _limits         = other._limits;
+    _schedule       = other._schedule;
+    _waits          = other._waits;
+    _credits        = other._credits;
+    _priority       = other._priority;
+    _lane           = other._lane;
+    _tailLane       = other._tailLane;
+    _queueLimits    = other._queueLimits;
+    _onReady        = std::move(other._onReady);
+    _queuedQueries  = other._queuedQueries;
+    _isOverflow     = other._isOverflow;
+    _types          = std::move(other._types);
+    _typeError      = std::move(other._typeError);
+    _decoding       = std::move(other._decoding);
     _isExec         = other._isExec;
+    _singleRow      = other._singleRow;
     _socket         = other._socket;
 
     other._evbase  = nullptr;
     other._connect = nullptr;
 
+    if (_decoding)
+        _decoding->owner = this;
+
+    if (_notifyEvent) {
+        event_free(_notifyEvent);
+        _notifyEvent = nullptr;
+    }
+    if (other._notifyEvent) {
+        event_free(other._notifyEvent);
+        other._notifyEvent = nullptr;
+        if (!_isExec)
+            watchNotifies();
+    }
+
     return *this;
 }
 
 SqlConnect::~SqlConnect()
 {
+    // Ожидает завершения потока декодирования до освобождения соединения
+    _decoding.reset();
+    if (_notifyEvent)
+        event_free(_notifyEvent);
     if (_connect)
         PQfinish(_connect);
 }
@@ -100,41 +545,132 @@ void SqlConnect::execute(std::string_view sql)
             return;
         }
         self->_error.clear();
+        self->startResult();
 
         auto event = event_new(self->_evbase, self->_socket, EV_READ, ev_executing, self);
         event_add(event, nullptr);
     };
-    push(callback);
+    push(callback, 0, CommandKind::Query);
 }
 
-void SqlConnect::execute(std::string_view sql, std::vector<SqlValue> params)
+void SqlConnect::executeScript(std::string_view sql, ResultCallback func)
 {
-    auto callback = [sql, params = std::move(params)](SqlConnect *self) {
-        const auto nParams = params.size();
-        auto *types = new unsigned int[nParams];
-        char **values = new char* [nParams];
-        int *lengths = new int[nParams];
-        int *formats = new int[nParams];
+    auto callback = [sql, func = std::move(func)](SqlConnect *self) {
+        self->_results.clear();
+        self->_onResult = func;
+        self->_sentAt = std::chrono::steady_clock::now();
+        self->updateResultMemory();
+
+        if (PQsendQuery(self->connect(), sql.data()) != 1) {
+            self->_error = SqlError(ErrorCode::ExecutionFailed, PQerrorMessage(self->connect()));
+            self->_onResult = nullptr;
+            self->pop();
+            return;
+        }
+        self->_error.clear();
+
+        auto event = event_new(self->_evbase, self->_socket, EV_READ, ev_scripting, self);
+        event_add(event, nullptr);
+    };
+    push(callback, 0, CommandKind::Query);
+}
+
+void SqlConnect::transaction(std::vector<SqlStatement> statements, SqlTransactionOptions options,
+                             ResultCallback func)
+{
+    std::size_t bytes = 0;
+    for (const auto &statement : statements)
+        bytes += statement.sql.capacity() + payloadSize(statement.params);
 
-        for (std::size_t i = 0, e = params.size(); i < e; ++i) {
-            const auto &[oid, length, value] = asPgValue(params[i]);
-            types[i] = oid;
-            values[i] = value;
-            lengths[i] = static_cast<int>(length);
-            formats[i] = 1;
+    auto callback = [statements = std::move(statements), begin = beginCommand(options),
+                     func = std::move(func)](SqlConnect *self) {
+        auto pgconn = self->connect();
+        self->_results.clear();
+        self->_onResult = func;
+        self->_pipelineQuery = 0;
+        self->_pipelineSize = statements.size() + 2;
+        self->_isDropped = false;
+        self->_sentAt = std::chrono::steady_clock::now();
+        self->updateResultMemory();
+        self->_error.clear();
+
+#ifdef LIBPQ_HAS_PIPELINING
+        if (PQenterPipelineMode(pgconn) != 1) {
+            self->_error = SqlError(ErrorCode::ExecutionFailed, PQerrorMessage(pgconn));
+            self->_onResult = nullptr;
+            self->pop();
+            return;
         }
 
-        auto result = PQsendQueryParams(
-            self->connect(), sql.data(), static_cast<int>(nParams),
-            types, values, lengths, formats, 1);
+        bool isSent = PQsendQueryParams(
+            pgconn, begin.c_str(), 0, nullptr, nullptr, nullptr, nullptr, 1) == 1;
+        for (auto it = statements.cbegin(); isSent && it != statements.cend(); ++it) {
+            PgParams pgParams(it->params, self->memoryResource(), self->_types.get());
+            if (!pgParams.error.empty()) {
+                self->_error = SqlError(ErrorCode::ExecutionFailed, pgParams.error);
+                isSent = false;
+                break;
+            }
+            isSent = PQsendQueryParams(
+                pgconn, it->sql.c_str(), pgParams.size(), pgParams.types.data(),
+                pgParams.values.data(), pgParams.lengths.data(), pgParams.formats.data(), 1) == 1;
+        }
+        isSent = isSent && PQsendQueryParams(
+            pgconn, "COMMIT", 0, nullptr, nullptr, nullptr, nullptr, 1) == 1;
 
-        for (std::size_t i = 0, e = params.size(); i < e; ++i)
-            delete[] values[i];
+        // Отправленные запросы без COMMIT откатываются после синхронизации
+        if (!isSent && !self->_error)
+            self->_error = SqlError(ErrorCode::ExecutionFailed, PQerrorMessage(pgconn));
 
-        delete[] types;
-        delete[] values;
-        delete[] lengths;
-        delete[] formats;
+        if (PQpipelineSync(pgconn) != 1) {
+            if (!self->_error)
+                self->_error = SqlError(ErrorCode::ExecutionFailed, PQerrorMessage(pgconn));
+            self->_onResult = nullptr;
+            self->pop();
+            return;
+        }
+
+        auto event = event_new(self->_evbase, self->_socket, EV_READ, ev_transacting, self);
+        event_add(event, nullptr);
+#else
+        self->_error = SqlError(ErrorCode::ExecutionFailed, "Pipeline mode is not supported by libpq");
+        self->_onResult = nullptr;
+        self->pop();
+#endif
+    };
+    push(callback, bytes, CommandKind::Query);
+}
+
+void SqlConnect::execute(std::string_view sql, std::vector<SqlValue> params)
+{
+    executeParams(sql, std::move(params));
+}
+
+void SqlConnect::execute(std::string_view sql, std::vector<SqlCell> params)
+{
+    executeParams(sql, std::move(params));
+}
+
+void SqlConnect::execute(std::string_view sql, std::vector<SqlParam> params)
+{
+    executeParams(sql, std::move(params));
+}
+
+template<class Params>
+void SqlConnect::executeParams(std::string_view sql, Params params)
+{
+    const auto bytes = payloadSize(params);
+    auto callback = [sql, params = std::move(params)](SqlConnect *self) {
+        PgParams pgParams(params, self->memoryResource(), self->_types.get());
+        if (!pgParams.error.empty()) {
+            self->_error = SqlError(ErrorCode::ExecutionFailed, pgParams.error);
+            self->pop();
+            return;
+        }
+
+        auto result = PQsendQueryParams(
+            self->connect(), sql.data(), pgParams.size(), pgParams.types.data(),
+            pgParams.values.data(), pgParams.lengths.data(), pgParams.formats.data(), 1);
 
         if (result != 1) {
             self->_error = SqlError(ErrorCode::ExecutionFailed, PQerrorMessage(self->connect()));
@@ -142,11 +678,95 @@ void SqlConnect::execute(std::string_view sql, std::vector<SqlValue> params)
             return;
         }
         self->_error.clear();
+        self->startResult();
 
         auto event = event_new(self->_evbase, self->_socket, EV_READ, ev_executing, self);
         event_add(event, nullptr);
     };
-    push(callback);
+    push(callback, bytes, CommandKind::Query);
+}
+
+void SqlConnect::listen(std::string_view channel, NotifyCallback func)
+{
+    _listeners.insert_or_assign(std::string(channel), std::move(func));
+    sendListen("LISTEN ", std::string(channel));
+}
+
+void SqlConnect::unlisten(std::string_view channel)
+{
+    if (auto it = _listeners.find(channel); it != _listeners.end())
+        _listeners.erase(it);
+    sendListen("UNLISTEN ", std::string(channel));
+}
+
+void SqlConnect::sendListen(const char *command, std::string channel)
+{
+    auto callback = [command, channel = std::move(channel)](SqlConnect *self) {
+        auto pgconn = self->connect();
+        auto *identifier = PQescapeIdentifier(pgconn, channel.data(), channel.size());
+        if (!identifier) {
+            self->_error = SqlError(ErrorCode::ExecutionFailed, PQerrorMessage(pgconn));
+            self->pop();
+            return;
+        }
+        const auto sql = command + std::string(identifier);
+        PQfreemem(identifier);
+
+        // Результат команды не сохраняется
+        self->_results.clear();
+        self->_onResult = [](SqlConnect *, SqlResult &) {};
+        self->_sentAt = std::chrono::steady_clock::now();
+        if (PQsendQuery(pgconn, sql.c_str()) != 1) {
+            self->_error = SqlError(ErrorCode::ExecutionFailed, PQerrorMessage(pgconn));
+            self->_onResult = nullptr;
+            self->pop();
+            return;
+        }
+        self->_error.clear();
+
+        auto event = event_new(self->_evbase, self->_socket, EV_READ, ev_scripting, self);
+        event_add(event, nullptr);
+    };
+    push(callback, 0, CommandKind::Query);
+}
+
+void SqlConnect::notifying()
+{
+    if (PQconsumeInput(connect()) != 1) {
+        _error = SqlError(ErrorCode::ConnectionFailed, PQerrorMessage(connect()));
+        event_del(_notifyEvent);
+        return;
+    }
+    dispatchNotifies();
+}
+
+void SqlConnect::dispatchNotifies()
+{
+    if (!_connect)
+        return;
+
+    while (auto *notify = PQnotifies(_connect)) {
+        const std::string channel = notify->relname;
+        const std::string payload = notify->extra;
+        PQfreemem(notify);
+
+        auto it = _listeners.find(channel);
+        if (it != _listeners.end()) {
+            // Обработчик может отписаться от канала
+            auto func = it->second;
+            func(this, channel, payload);
+        }
+    }
+}
+
+void SqlConnect::watchNotifies()
+{
+    if (_listeners.empty() || !_evbase || _socket < 0)
+        return;
+
+    if (!_notifyEvent)
+        _notifyEvent = event_new(_evbase, _socket, EV_READ | EV_PERSIST, ev_notifying, this);
+    event_add(_notifyEvent, nullptr);
 }
 
 void SqlConnect::prepare(std::string_view sql, std::vector<SqlType> sqlTypes)
@@ -173,33 +793,39 @@ void SqlConnect::prepare(std::string_view sql, std::vector<SqlType> sqlTypes)
         auto event = event_new(self->_evbase, self->_socket, EV_READ, ev_preparing, self);
         event_add(event, nullptr);
     };
-    push(callback);
+    push(callback, 0, CommandKind::Query);
 }
 
 void SqlConnect::execute(std::vector<SqlValue> params)
 {
-    auto callback = [params = std::move(params)](SqlConnect *self) {
-        const auto nParams = params.size();
-        char **values = new char* [nParams];
-        int *lengths = new int[nParams];
-        int *formats = new int[nParams];
+    executePrepared(std::move(params));
+}
 
-        for (std::size_t i = 0, e = params.size(); i < e; ++i) {
-            const auto &[oid, length, value] = asPgValue(params[i]);
-            values[i] = value;
-            lengths[i] = static_cast<int>(length);
-            formats[i] = 1;
-        }
+void SqlConnect::execute(std::vector<SqlCell> params)
+{
+    executePrepared(std::move(params));
+}
 
-        auto result = PQsendQueryPrepared(
-            self->connect(), "", static_cast<int>(nParams), values, lengths, formats, 1);
+void SqlConnect::execute(std::vector<SqlParam> params)
+{
+    executePrepared(std::move(params));
+}
 
-        for (std::size_t i = 0, e = params.size(); i < e; ++i)
-            delete[] values[i];
+template<class Params>
+void SqlConnect::executePrepared(Params params)
+{
+    const auto bytes = payloadSize(params);
+    auto callback = [params = std::move(params)](SqlConnect *self) {
+        PgParams pgParams(params, self->memoryResource());
+        if (!pgParams.error.empty()) {
+            self->_error = SqlError(ErrorCode::ExecutionFailed, pgParams.error);
+            self->pop();
+            return;
+        }
 
-        delete[] values;
-        delete[] lengths;
-        delete[] formats;
+        auto result = PQsendQueryPrepared(
+            self->connect(), "", pgParams.size(), pgParams.values.data(),
+            pgParams.lengths.data(), pgParams.formats.data(), 1);
 
         if (result != 1) {
             self->_error = SqlError(ErrorCode::ExecutionFailed, PQerrorMessage(self->connect()));
@@ -207,17 +833,23 @@ void SqlConnect::execute(std::vector<SqlValue> params)
             return;
         }
         self->_error.clear();
+        self->startResult();
 
         auto event = event_new(self->_evbase, self->_socket, EV_READ, ev_executing, self);
         event_add(event, nullptr);
     };
-    push(callback);
+    push(callback, bytes, CommandKind::Query);
 }
 
 bool SqlConnect::cancel()
 {
-    while (!_callbackQueue.empty())
-        _callbackQueue.pop();
+    for (auto &lane : _lanes) {
+        for (const auto &command : lane)
+            _memory.removeQueued(command.bytes);
+        lane.clear();
+    }
+    _queuedQueries = 0;
+    notifyReady();
 
     char errorBuffer[256];
     auto cancelObject = PQgetCancel(_connect);
@@ -230,6 +862,39 @@ bool SqlConnect::cancel()
     return canceled;
 }
 
+bool SqlConnect::interrupt(uint64_t command)
+{
+    if (!_isExec || command == 0 || command != _command)
+        return false;
+
+    // Отмена может дойти до сервера после завершения команды, поэтому она не
+    // отправляется, пока за командой в очереди есть другие запросы
+    for (const auto &lane : _lanes) {
+        for (const auto &queued : lane) {
+            if (queued.kind != CommandKind::Handler)
+                return false;
+        }
+    }
+    return sendCancel();
+}
+
+uint64_t SqlConnect::lastCommand() const
+{
+    return _lastCommand;
+}
+
+bool SqlConnect::sendCancel()
+{
+    if (!_connect)
+        return false;
+
+    auto cancelObject = PQgetCancel(_connect);
+    if (!cancelObject)
+        return false;
+    cancelWorker().post(cancelObject);
+    return true;
+}
+
 void SqlConnect::post(Callback func)
 {
     auto callback = [func = std::move(func)](SqlConnect *self) {
@@ -239,33 +904,413 @@ void SqlConnect::post(Callback func)
     push(callback);
 }
 
-SqlConnect SqlConnect::clone()
+void SqlConnect::decode(DecodeCallback func, SqlLayout layout, unsigned int threads)
 {
-    return SqlConnect(_connInfo, _evbase);
+    auto callback = [func = std::move(func), layout, threads](SqlConnect *self) {
+        auto *decoding = self->startDecoding();
+        if (!decoding) {
+            auto table = decodeResult(self->_result, layout, threads);
+            func(self, table);
+            self->pop();
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(decoding->mutex);
+            decoding->result = std::move(self->_result);
+            decoding->layout = layout;
+            decoding->threads = threads;
+            decoding->func = func;
+            decoding->isPending = true;
+        }
+        decoding->wakeup.notify_one();
+    };
+    push(callback);
 }
 
-void SqlConnect::connecting()
+SqlDecoding *SqlConnect::startDecoding()
 {
-    auto ret = PQconnectPoll(_connect);
-    switch (ret) {
-    case PGRES_POLLING_READING: {
-        auto event = event_new(_evbase, _socket, EV_READ, ev_connecting, this);
-        event_add(event, nullptr);
-    } break;
-    case PGRES_POLLING_WRITING: {
-        auto event = event_new(_evbase, _socket, EV_WRITE, ev_connecting, this);
-        event_add(event, nullptr);
-    } break;
-    case PGRES_POLLING_OK:
-        pop();
-        break;
-    case PGRES_POLLING_FAILED:
-        _error = SqlError(ErrorCode::ConnectionFailed, PQerrorMessage(_connect));
-        pop();
-        break;
-    default:
-        break;
-    }
+    if (_decoding)
+        return _decoding.get();
+    if (!_evbase)
+        return nullptr;
+
+    auto decoding = std::make_unique<SqlDecoding>();
+    if (evutil_socketpair(LOCAL_SOCKETPAIR_AF, SOCK_STREAM, 0, decoding->sockets) != 0)
+        return nullptr;
+
+    decoding->owner = this;
+    decoding->event = event_new(
+        _evbase, decoding->sockets[0], EV_READ | EV_PERSIST, ev_decoding, decoding.get());
+    if (!decoding->event)
+        return nullptr;
+    event_add(decoding->event, nullptr);
+    decoding->thread = std::thread(&SqlDecoding::run, decoding.get());
+
+    _decoding = std::move(decoding);
+    return _decoding.get();
+}
+
+void SqlConnect::decoding()
+{
+    SqlTable table;
+    DecodeCallback func;
+    {
+        std::lock_guard<std::mutex> lock(_decoding->mutex);
+        if (!_decoding->isDone)
+            return;
+        _decoding->isDone = false;
+        _result = std::move(_decoding->result);
+        table = std::move(_decoding->table);
+        func = std::move(_decoding->func);
+    }
+
+    func(this, table);
+    pop();
+}
+
+void SqlConnect::readLargeObject(
+    unsigned int loid, SqlChunkSink sink, SqlStreamCallback done, std::size_t chunkSize)
+{
+    auto stream = std::make_shared<SqlStreaming>();
+    stream->sql = "SELECT loread($1, $2)";
+    stream->sink = std::move(sink);
+    stream->done = std::move(done);
+    stream->chunkSize = std::max<std::size_t>(chunkSize, 1);
+    stream->largeObject = true;
+    writeBigEndian<uint32_t>(stream->loid, loid);
+    writeBigEndian<uint32_t>(stream->mode, INV_READ);
+    writeBigEndian<uint32_t>(stream->size, static_cast<uint32_t>(stream->chunkSize));
+
+    push([stream](SqlConnect *self) { self->streamNext(stream); }, 0, CommandKind::Task);
+}
+
+void SqlConnect::writeLargeObject(
+    unsigned int loid, SqlChunkSource source, SqlStreamCallback done, std::size_t chunkSize)
+{
+    auto stream = std::make_shared<SqlStreaming>();
+    stream->sql = "SELECT lowrite($1, $2)";
+    stream->source = std::move(source);
+    stream->done = std::move(done);
+    stream->chunkSize = std::max<std::size_t>(chunkSize, 1);
+    stream->largeObject = true;
+    writeBigEndian<uint32_t>(stream->loid, loid);
+    writeBigEndian<uint32_t>(stream->mode, INV_WRITE);
+
+    push([stream](SqlConnect *self) { self->streamNext(stream); }, 0, CommandKind::Task);
+}
+
+void SqlConnect::readBytea(std::string_view sql, std::vector<SqlValue> params, SqlChunkSink sink,
+                           SqlStreamCallback done, std::size_t chunkSize)
+{
+    auto stream = std::make_shared<SqlStreaming>();
+    const auto count = params.size();
+    stream->sql = "SELECT substring((";
+    stream->sql += sql;
+    stream->sql += ") FROM $" + std::to_string(count + 1) + " FOR $" + std::to_string(count + 2) + ")";
+    stream->params = std::move(params);
+    stream->sink = std::move(sink);
+    stream->done = std::move(done);
+    stream->chunkSize = std::max<std::size_t>(chunkSize, 1);
+    writeBigEndian<uint32_t>(stream->size, static_cast<uint32_t>(stream->chunkSize));
+
+    push([stream](SqlConnect *self) { self->streamNext(stream); }, 0, CommandKind::Task);
+}
+
+void SqlConnect::writeBytea(std::string_view sql, std::vector<SqlValue> params,
+                            SqlChunkSource source, SqlStreamCallback done, std::size_t chunkSize)
+{
+    auto stream = std::make_shared<SqlStreaming>();
+    stream->sql = sql;
+    stream->params = std::move(params);
+    stream->source = std::move(source);
+    stream->done = std::move(done);
+    stream->chunkSize = std::max<std::size_t>(chunkSize, 1);
+
+    push([stream](SqlConnect *self) { self->streamNext(stream); }, 0, CommandKind::Task);
+}
+
+void SqlConnect::step(const char *sql, const std::vector<SqlValue> &params,
+                      const std::vector<SqlParam> &extra, StepCallback func)
+{
+    PgParams pgParams(params, memoryResource(), _types.get());
+    pgParams.append(extra);
+
+    _step = std::move(func);
+    if (!pgParams.error.empty()) {
+        _error = SqlError(ErrorCode::ExecutionFailed, pgParams.error);
+        auto step = std::move(_step);
+        step(this, SqlResult());
+        return;
+    }
+
+    auto result = PQsendQueryParams(
+        _connect, sql, pgParams.size(), pgParams.types.data(), pgParams.values.data(),
+        pgParams.lengths.data(), pgParams.formats.data(), 1);
+
+    if (result != 1) {
+        _error = SqlError(ErrorCode::ExecutionFailed, PQerrorMessage(_connect));
+        auto step = std::move(_step);
+        step(this, SqlResult());
+        return;
+    }
+
+    event_base_once(_evbase, _socket, EV_READ, ev_stepping, this, nullptr);
+}
+
+void SqlConnect::stepping()
+{
+    auto pgconn = connect();
+    SqlResult result;
+    if (PQconsumeInput(pgconn) != 1) {
+        _error = SqlError(ErrorCode::ExecutionFailed, PQerrorMessage(pgconn));
+    } else if (PQisBusy(pgconn) == 1) {
+        event_base_once(_evbase, _socket, EV_READ, ev_stepping, this, nullptr);
+        return;
+    } else if (auto pgResult = PQgetResult(pgconn)) {
+        const auto status = PQresultStatus(pgResult);
+        if (status == PGRES_TUPLES_OK || status == PGRES_COMMAND_OK) {
+            result = SqlResult(pgResult);
+        } else {
+            _error = SqlError(ErrorCode::ExecutionFailed, PQerrorMessage(pgconn));
+            PQclear(pgResult);
+        }
+    }
+
+    while (auto pgResult = PQgetResult(pgconn))
+        PQclear(pgResult);
+
+    auto step = std::move(_step);
+    step(this, result);
+}
+
+void SqlConnect::streamNext(const std::shared_ptr<SqlStreaming> &stream)
+{
+    auto callback = [stream](SqlConnect *self, const SqlResult &result) {
+        self->streamResult(stream, result);
+    };
+
+    for (;;) {
+        switch (stream->stage) {
+        case StreamStage::Begin:
+            _error.clear();
+            if (PQtransactionStatus(_connect) == PQTRANS_IDLE) {
+                // Фрагменты bytea читаются из одного снимка данных
+                stream->transaction = true;
+                const bool snapshot = stream->sink && !stream->largeObject;
+                step(snapshot ? "BEGIN ISOLATION LEVEL REPEATABLE READ" : "BEGIN", {}, {}, callback);
+                return;
+            }
+            stream->stage = StreamStage::Open;
+            continue;
+        case StreamStage::Open:
+            if (stream->largeObject) {
+                step("SELECT lo_open($1, $2)", {},
+                     {int32Param(OIDOID, stream->loid), int32Param(INT4OID, stream->mode)}, callback);
+                return;
+            }
+            stream->stage = StreamStage::Transfer;
+            continue;
+        case StreamStage::Truncate:
+            if (stream->largeObject && stream->source) {
+                step("SELECT lo_truncate($1, 0)", {}, {int32Param(INT4OID, stream->fd)}, callback);
+                return;
+            }
+            stream->stage = StreamStage::Transfer;
+            continue;
+        case StreamStage::Transfer:
+            if (stream->sink) {
+                writeBigEndian<uint32_t>(stream->offset, static_cast<uint32_t>(stream->bytes + 1));
+                const auto &position = stream->largeObject ? stream->fd : stream->offset;
+                step(stream->sql.c_str(), stream->params,
+                     {int32Param(INT4OID, position), int32Param(INT4OID, stream->size)}, callback);
+                return;
+            }
+
+            stream->buffer.resize(stream->chunkSize);
+            stream->pending = stream->source(stream->buffer.data(), stream->chunkSize);
+            if (stream->pending > 0) {
+                SqlParam chunk{BYTEAOID, stream->buffer.data(), static_cast<int>(stream->pending), 1};
+                if (stream->largeObject)
+                    step(stream->sql.c_str(), {}, {int32Param(INT4OID, stream->fd), chunk}, callback);
+                else
+                    step(stream->sql.c_str(), stream->params, {chunk}, callback);
+                return;
+            }
+            stream->stage = StreamStage::Close;
+            continue;
+        case StreamStage::Close:
+            // Дескриптор большого объекта закрывается при завершении транзакции
+            if (stream->largeObject && !stream->transaction) {
+                step("SELECT lo_close($1)", {}, {int32Param(INT4OID, stream->fd)}, callback);
+                return;
+            }
+            stream->stage = StreamStage::End;
+            continue;
+        case StreamStage::End:
+            if (stream->transaction) {
+                stream->transaction = false;
+                step(_error ? "ROLLBACK" : "COMMIT", {}, {}, callback);
+                return;
+            }
+            stream->stage = StreamStage::Done;
+            continue;
+        case StreamStage::Done:
+            stream->buffer = std::vector<char>();
+            if (stream->done)
+                stream->done(this, stream->bytes);
+            pop();
+            return;
+        }
+    }
+}
+
+void SqlConnect::streamResult(const std::shared_ptr<SqlStreaming> &stream, const SqlResult &result)
+{
+    if (_error && stream->stage < StreamStage::End) {
+        stream->stage = StreamStage::End;
+        streamNext(stream);
+        return;
+    }
+
+    switch (stream->stage) {
+    case StreamStage::Begin:
+        stream->stage = StreamStage::Open;
+        break;
+    case StreamStage::Open:
+        if (result.rows() > 0 && result.length(0, 0) == 4)
+            std::memcpy(stream->fd, result.data(0, 0), sizeof(stream->fd));
+        stream->stage = StreamStage::Truncate;
+        break;
+    case StreamStage::Truncate:
+        stream->stage = StreamStage::Transfer;
+        break;
+    case StreamStage::Transfer:
+        if (stream->sink) {
+            const auto length = (result.rows() > 0 && !result.isNull(0, 0))
+                ? static_cast<std::size_t>(result.length(0, 0)) : 0;
+            stream->bytes += length;
+            bool next = length == stream->chunkSize;
+            if (length > 0 && !stream->sink(result.data(0, 0), length))
+                next = false;
+            if (!next)
+                stream->stage = StreamStage::Close;
+        } else {
+            stream->bytes += stream->pending;
+        }
+        break;
+    case StreamStage::Close:
+        stream->stage = StreamStage::End;
+        break;
+    case StreamStage::End:
+    case StreamStage::Done:
+        stream->stage = StreamStage::Done;
+        break;
+    }
+
+    streamNext(stream);
+}
+
+SqlConnect SqlConnect::clone()
+{
+    return SqlConnect(_connInfo, _evbase);
+}
+
+void SqlConnect::connecting()
+{
+    auto ret = PQconnectPoll(_connect);
+    switch (ret) {
+    case PGRES_POLLING_READING: {
+        auto event = event_new(_evbase, _socket, EV_READ, ev_connecting, this);
+        event_add(event, nullptr);
+    } break;
+    case PGRES_POLLING_WRITING: {
+        auto event = event_new(_evbase, _socket, EV_WRITE, ev_connecting, this);
+        event_add(event, nullptr);
+    } break;
+    case PGRES_POLLING_OK:
+        resolveTypes();
+        break;
+    case PGRES_POLLING_FAILED:
+        _error = SqlError(ErrorCode::ConnectionFailed, PQerrorMessage(_connect));
+        pop();
+        break;
+    default:
+        break;
+    }
+}
+
+void SqlConnect::resolveTypes()
+{
+    const auto codecs = sqlCodecs();
+    if (codecs.empty()) {
+        pop();
+        return;
+    }
+
+    std::vector<std::string_view> names;
+    names.reserve(codecs.size());
+    for (const auto &codec : codecs)
+        names.push_back(codec.typeName);
+
+    const auto array = SqlArray::from(names);
+    const auto bytes = array.bytes();
+    const unsigned int types[] = {array.arrayType()};
+    const char *values[] = {bytes.data()};
+    const int lengths[] = {static_cast<int>(bytes.size())};
+    const int formats[] = {1};
+
+    auto result = PQsendQueryParams(
+        _connect, "SELECT oid, typname::text FROM pg_catalog.pg_type WHERE typname = ANY($1)",
+        1, types, values, lengths, formats, 1);
+    if (result != 1) {
+        _typeError = SqlError(ErrorCode::ExecutionFailed, PQerrorMessage(_connect));
+        _error = _typeError;
+        pop();
+        return;
+    }
+
+    auto event = event_new(_evbase, _socket, EV_READ, ev_resolving, this);
+    event_add(event, nullptr);
+}
+
+void SqlConnect::resolving()
+{
+    auto pgconn = connect();
+    if (PQconsumeInput(pgconn) != 1) {
+        _typeError = SqlError(ErrorCode::ExecutionFailed, PQerrorMessage(pgconn));
+        _error = _typeError;
+        pop();
+        return;
+    }
+
+    if (PQisBusy(pgconn) == 1) {
+        auto event = event_new(_evbase, _socket, EV_READ, ev_resolving, this);
+        event_add(event, nullptr);
+        return;
+    }
+
+    if (auto pgResult = PQgetResult(pgconn)) {
+        if (PQresultStatus(pgResult) == PGRES_TUPLES_OK) {
+            std::vector<std::pair<unsigned int, std::string>> types;
+            for (int row = 0, rows = PQntuples(pgResult); row < rows; ++row) {
+                const auto *oid = reinterpret_cast<const uint8_t *>(PQgetvalue(pgResult, row, 0));
+                types.emplace_back(
+                    (static_cast<unsigned int>(oid[0]) << 24) | (oid[1] << 16) | (oid[2] << 8) | oid[3],
+                    std::string(PQgetvalue(pgResult, row, 1), PQgetlength(pgResult, row, 1)));
+            }
+            _types = std::make_shared<const SqlTypeMap>(sqlCodecs(), types);
+            _typeError.clear();
+        } else {
+            _typeError = SqlError(ErrorCode::ExecutionFailed, PQresultErrorMessage(pgResult));
+            _error = _typeError;
+        }
+        PQclear(pgResult);
+    }
+
+    while (auto pgResult = PQgetResult(pgconn))
+        PQclear(pgResult);
+    pop();
 }
 
 void SqlConnect::preparing()
@@ -299,10 +1344,18 @@ void SqlConnect::executing()
     auto pgconn = connect();
     if (PQconsumeInput(pgconn) != 1) {
         _error = SqlError(ErrorCode::ExecutionFailed, PQerrorMessage(pgconn));
+        _singleRow = false;
+        _partial = SqlResult();
+        updateResultMemory();
         pop();
         return;
     }
 
+    if (_singleRow) {
+        receiveRows();
+        return;
+    }
+
     if (PQisBusy(pgconn) == 1) {
         auto event = event_new(_evbase, _socket, EV_READ, ev_executing, this);
         event_add(event, nullptr);
@@ -312,25 +1365,311 @@ void SqlConnect::executing()
     if (auto pgResult = PQgetResult(pgconn)) {
         if (PQresultStatus(pgResult) == PGRES_TUPLES_OK) {
             _result = SqlResult(pgResult);
+            _result.setTypes(_types);
+            updateResultMemory();
+            if (isHardLimitExceeded()) {
+                _result = SqlResult();
+                _error = SqlError(ErrorCode::MemoryLimitExceeded);
+                updateResultMemory();
+            }
         } else {
             _error = SqlError(ErrorCode::ExecutionFailed, PQerrorMessage(pgconn));
             PQclear(pgResult);
         }
     }
 
+    while (auto pgResult = PQgetResult(pgconn))
+        PQclear(pgResult);
+    updateLatency();
+    pop();
+}
+
+void SqlConnect::scripting()
+{
+    auto pgconn = connect();
+    if (PQconsumeInput(pgconn) != 1) {
+        _error = SqlError(ErrorCode::ExecutionFailed, PQerrorMessage(pgconn));
+        _onResult = nullptr;
+        pop();
+        return;
+    }
+
+    while (PQisBusy(pgconn) == 0) {
+        auto pgResult = PQgetResult(pgconn);
+        if (!pgResult) {
+            _onResult = nullptr;
+            updateResultMemory();
+            updateLatency();
+            pop();
+            return;
+        }
+
+        switch (PQresultStatus(pgResult)) {
+        case PGRES_BAD_RESPONSE:
+        case PGRES_FATAL_ERROR:
+            // Сервер прекращает выполнение сценария на первой ошибке
+            if (!_error)
+                _error = SqlError(ErrorCode::ExecutionFailed, PQresultErrorMessage(pgResult));
+            PQclear(pgResult);
+            break;
+        default: {
+            SqlResult result(pgResult);
+            if (_error)
+                break;
+            result.setTypes(_types);
+            if (_onResult) {
+                _onResult(this, result);
+            } else {
+                _results.push_back(std::move(result));
+                updateResultMemory();
+                if (isHardLimitExceeded()) {
+                    _results.clear();
+                    _error = SqlError(ErrorCode::MemoryLimitExceeded);
+                    updateResultMemory();
+                }
+            }
+        } break;
+        }
+    }
+
+    auto event = event_new(_evbase, _socket, EV_READ, ev_scripting, this);
+    event_add(event, nullptr);
+}
+
+void SqlConnect::transacting()
+{
+    auto pgconn = connect();
+    if (PQconsumeInput(pgconn) != 1) {
+        _error = SqlError(ErrorCode::ExecutionFailed, PQerrorMessage(pgconn));
+        _results.clear();
+        _onResult = nullptr;
+        updateResultMemory();
+        pop();
+        return;
+    }
+
+#ifdef LIBPQ_HAS_PIPELINING
+    while (PQisBusy(pgconn) == 0) {
+        auto pgResult = PQgetResult(pgconn);
+        if (!pgResult) {
+            // Результаты очередного запроса конвейера получены
+            ++_pipelineQuery;
+            continue;
+        }
+
+        switch (PQresultStatus(pgResult)) {
+        case PGRES_PIPELINE_SYNC:
+            PQclear(pgResult);
+            PQexitPipelineMode(pgconn);
+            updateLatency();
+            _onResult = nullptr;
+            if (_error) {
+                _results.clear();
+                updateResultMemory();
+
+                // Прерванная транзакция остаётся открытой до ROLLBACK
+                if (PQtransactionStatus(pgconn) != PQTRANS_IDLE
+                    && PQsendQuery(pgconn, "ROLLBACK") == 1) {
+                    auto event = event_new(_evbase, _socket, EV_READ, ev_rollingBack, this);
+                    event_add(event, nullptr);
+                    return;
+                }
+            }
+            pop();
+            return;
+        case PGRES_PIPELINE_ABORTED:
+            // Запрос пропущен сервером после ошибки
+            PQclear(pgResult);
+            break;
+        case PGRES_BAD_RESPONSE:
+        case PGRES_FATAL_ERROR:
+            if (!_error)
+                _error = SqlError(ErrorCode::ExecutionFailed, PQresultErrorMessage(pgResult));
+            PQclear(pgResult);
+            break;
+        default: {
+            SqlResult result(pgResult);
+            // Результаты BEGIN и COMMIT не возвращаются
+            if (_error || _isDropped || _pipelineQuery == 0 || _pipelineQuery + 1 >= _pipelineSize)
+                break;
+            result.setTypes(_types);
+            if (_onResult) {
+                _onResult(this, result);
+            } else {
+                // COMMIT уже отправлен, поэтому при превышении лимита отбрасываются
+                // только результаты, а транзакция завершается без ошибки
+                _results.push_back(std::move(result));
+                updateResultMemory();
+                if (isHardLimitExceeded()) {
+                    _results.clear();
+                    _isDropped = true;
+                    updateResultMemory();
+                }
+            }
+        } break;
+        }
+    }
+#endif
+
+    auto event = event_new(_evbase, _socket, EV_READ, ev_transacting, this);
+    event_add(event, nullptr);
+}
+
+void SqlConnect::rollingBack()
+{
+    auto pgconn = connect();
+    if (PQconsumeInput(pgconn) != 1) {
+        pop();
+        return;
+    }
+
+    if (PQisBusy(pgconn) == 1) {
+        auto event = event_new(_evbase, _socket, EV_READ, ev_rollingBack, this);
+        event_add(event, nullptr);
+        return;
+    }
+
+    // Ошибка транзакции сохраняется, результат отката не возвращается
     while (auto pgResult = PQgetResult(pgconn))
         PQclear(pgResult);
     pop();
 }
 
+void SqlConnect::startResult()
+{
+    _sentAt = std::chrono::steady_clock::now();
+    _singleRow = _limits.soft != 0 && _memory.usage().total() >= _limits.soft
+        && PQsetSingleRowMode(_connect) == 1;
+}
+
+void SqlConnect::receiveRows()
+{
+    auto pgconn = connect();
+    while (PQisBusy(pgconn) == 0) {
+        auto pgResult = PQgetResult(pgconn);
+        if (!pgResult) {
+            // Строки накоплены в компактном хранилище, результат запроса завершён
+            if (!_error)
+                _result = std::move(_partial);
+            _partial = SqlResult();
+            _singleRow = false;
+            updateResultMemory();
+            updateLatency();
+            pop();
+            return;
+        }
+
+        switch (PQresultStatus(pgResult)) {
+        case PGRES_SINGLE_TUPLE:
+            if (!_error) {
+                if (_partial.columns() == 0)
+                    _partial.setTypes(_types);
+                if (!_partial.append(SqlResult(pgResult))) {
+                    // Смещения компактного хранилища ограничены 4 ГиБ
+                    _error = SqlError(ErrorCode::ExecutionFailed, "Result exceeds the compact storage size");
+                    _partial = SqlResult();
+                    updateResultMemory();
+                    sendCancel();
+                    break;
+                }
+                updateResultMemory();
+                if (isHardLimitExceeded()) {
+                    // Оставшиеся строки отбрасываются до завершения отменённого запроса
+                    _error = SqlError(ErrorCode::MemoryLimitExceeded);
+                    _partial = SqlResult();
+                    updateResultMemory();
+                    sendCancel();
+                }
+            } else {
+                PQclear(pgResult);
+            }
+            break;
+        case PGRES_TUPLES_OK:
+            // Завершающий результат содержит тег команды, а без строк - и описание колонок
+            if (_error) {
+                PQclear(pgResult);
+            } else if (_partial.columns() == 0) {
+                _partial = SqlResult(pgResult);
+                _partial.setTypes(_types);
+            } else if (!_partial.append(SqlResult(pgResult))) {
+                _error = SqlError(ErrorCode::ExecutionFailed, "Result exceeds the compact storage size");
+                _partial = SqlResult();
+            }
+            break;
+        default:
+            if (!_error)
+                _error = SqlError(ErrorCode::ExecutionFailed, PQerrorMessage(pgconn));
+            _partial = SqlResult();
+            PQclear(pgResult);
+            break;
+        }
+    }
+
+    auto event = event_new(_evbase, _socket, EV_READ, ev_executing, this);
+    event_add(event, nullptr);
+}
+
+void SqlConnect::updateLatency()
+{
+    // Вес нового измерения 1/LatencyDivisor сглаживает единичные выбросы
+    constexpr int LatencyDivisor = 5;
+
+    auto sample = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - _sentAt);
+    if (_latency.count() == 0)
+        _latency = std::max(sample, std::chrono::microseconds(1));
+    else
+        _latency += (sample - _latency) / LatencyDivisor;
+}
+
+void SqlConnect::updateResultMemory()
+{
+    auto bytes = _result.memorySize() + _partial.memorySize();
+    for (const auto &result : _results)
+        bytes += result.memorySize();
+    _memory.setResults(bytes);
+}
+
+bool SqlConnect::isHardLimitExceeded(std::size_t bytes) const
+{
+    return _limits.hard != 0 && _memory.usage().total() + bytes > _limits.hard;
+}
+
+void SqlConnect::setMemoryLimits(SqlMemoryLimits limits)
+{
+    _limits = limits;
+}
+
+SqlMemoryLimits SqlConnect::memoryLimits() const
+{
+    return _limits;
+}
+
+SqlMemoryUsage SqlConnect::memoryUsage() const
+{
+    return _memory.usage();
+}
+
 void SqlConnect::pop()
 {
-    if (!_callbackQueue.empty()) {
-        auto callback = _callbackQueue.front();
-        _callbackQueue.pop();
-        callback(this);
+    dispatchNotifies();
+
+    const auto lane = selectLane();
+    if (lane < Lanes) {
+        auto command = std::move(_lanes[lane].front());
+        _lanes[lane].pop_front();
+        _lane = lane;
+        _memory.removeQueued(command.bytes);
+        if (command.kind == CommandKind::Query) {
+            --_queuedQueries;
+            notifyReady();
+        }
+        _command = command.id;
+        command.callback(this);
     } else {
         _isExec = false;
+        _command = 0;
+        watchNotifies();
     }
 }
 
@@ -339,30 +1678,247 @@ const SqlResult &SqlConnect::result() const
     return _result;
 }
 
+const std::vector<SqlResult> &SqlConnect::results() const
+{
+    return _results;
+}
+
+std::vector<SqlResult> SqlConnect::takeResults()
+{
+    auto results = std::move(_results);
+    _results.clear();
+    updateResultMemory();
+    return results;
+}
+
+SqlSharedResult SqlConnect::takeResult(bool compact)
+{
+    auto result = std::make_shared<SqlResult>(std::move(_result));
+    updateResultMemory();
+    if (compact)
+        result->compact();
+    return result;
+}
+
 bool SqlConnect::isBusy() const
 {
     return _isExec;
 }
 
+std::size_t SqlConnect::inFlight() const
+{
+    std::size_t size = _isExec ? 1 : 0;
+    for (const auto &lane : _lanes)
+        size += lane.size();
+    return size;
+}
+
+std::chrono::microseconds SqlConnect::latency() const
+{
+    return _latency;
+}
+
+void SqlConnect::resetLatency()
+{
+    _latency = std::chrono::microseconds(0);
+}
+
+std::shared_ptr<const SqlTypeMap> SqlConnect::typeMap() const
+{
+    return _types;
+}
+
+const SqlError &SqlConnect::typeError() const
+{
+    return _typeError;
+}
+
+std::pmr::memory_resource *SqlConnect::memoryResource() const
+{
+    return _pool.get();
+}
+
 const SqlError &SqlConnect::error() const
 {
     return _error;
 }
 
-bool SqlConnect::push(const SqlConnect::Callback &callback)
+bool SqlConnect::push(const SqlConnect::Callback &callback, std::size_t bytes, CommandKind kind)
 {
+    // Команда заменяется ошибкой, чтобы сохранить порядок обработчиков очереди. Ошибка
+    // добавляется без повторной проверки лимитов, обработчики группы не заменяются
+    Command command{callback, bytes, kind};
+    if (kind != CommandKind::Handler && isHardLimitExceeded(bytes))
+        command = Command{errorCommand(ErrorCode::MemoryLimitExceeded)};
+    else if (kind == CommandKind::Query && _isExec && !reserveQueue(bytes))
+        command = Command{errorCommand(ErrorCode::QueueOverflow)};
+    command.id = ++_lastCommand;
+
+    // Обработчик добавляется в очередь предыдущей команды, чтобы не разрывать группу
+    const auto lane = command.kind == CommandKind::Handler
+        ? _tailLane : static_cast<std::size_t>(_priority);
+    _tailLane = lane;
+
     bool isCall = false;
     if (_isExec) {
-        _callbackQueue.push(callback);
+        _memory.addQueued(command.bytes);
+        if (command.kind == CommandKind::Query)
+            ++_queuedQueries;
+        _lanes[lane].push_back(std::move(command));
     } else {
-        callback(this);
+        // Команда может завершиться синхронно и вызвать pop()
         _isExec = true;
+        _lane = lane;
+        if (_notifyEvent)
+            event_del(_notifyEvent);
         isCall = true;
+        _command = command.id;
+        command.callback(this);
     }
 
     return isCall;
 }
 
+bool SqlConnect::reserveQueue(std::size_t bytes)
+{
+    if (!isQueueFull(bytes))
+        return true;
+
+    // Запрос, не помещающийся в пустую очередь, не вытесняет другие запросы
+    const bool isFit = _queueLimits.bytes == 0 || bytes <= _queueLimits.bytes;
+    if (_queueLimits.overflow == SqlOverflow::ShedOldest && isFit) {
+        // Вытесняются старые запросы начиная с низшего приоритета
+        for (auto lane = Lanes; lane-- > 0 && isQueueFull(bytes);) {
+            for (auto &command : _lanes[lane]) {
+                if (!isQueueFull(bytes))
+                    break;
+                if (command.kind != CommandKind::Query)
+                    continue;
+                _memory.removeQueued(command.bytes);
+                --_queuedQueries;
+                command = Command{errorCommand(ErrorCode::QueueOverflow)};
+            }
+        }
+        return true;
+    }
+
+    if (_queueLimits.overflow == SqlOverflow::Ready)
+        _isOverflow = true;
+    return false;
+}
+
+std::size_t SqlConnect::selectLane()
+{
+    // Обработчики выполняются сразу после команды своей группы
+    if (!_lanes[_lane].empty() && _lanes[_lane].front().kind == CommandKind::Handler)
+        return _lane;
+
+    std::size_t selected = Lanes;
+    if (_schedule.scheduling == SqlScheduling::Fair) {
+        // Плавный взвешенный циклический выбор
+        int64_t total = 0;
+        for (std::size_t lane = 0; lane < Lanes; ++lane) {
+            if (_lanes[lane].empty()) {
+                _credits[lane] = 0;
+                continue;
+            }
+            const auto weight = static_cast<int64_t>(std::max(_schedule.weights[lane], 1u));
+            _credits[lane] += weight;
+            total += weight;
+            if (selected == Lanes || _credits[lane] > _credits[selected])
+                selected = lane;
+        }
+        if (selected < Lanes)
+            _credits[selected] -= total;
+        return selected;
+    }
+
+    for (std::size_t lane = 0; lane < Lanes; ++lane) {
+        if (_lanes[lane].empty())
+            continue;
+        if (selected == Lanes) {
+            selected = lane;
+        } else if (_schedule.aging != 0 && _waits[lane] >= _schedule.aging) {
+            // Группа низкого приоритета слишком долго пропускала более приоритетные
+            selected = lane;
+            break;
+        }
+    }
+
+    for (std::size_t lane = selected + 1; lane < Lanes; ++lane) {
+        if (!_lanes[lane].empty())
+            ++_waits[lane];
+    }
+    if (selected < Lanes)
+        _waits[selected] = 0;
+    return selected;
+}
+
+void SqlConnect::setPriority(SqlPriority priority)
+{
+    _priority = priority;
+}
+
+SqlPriority SqlConnect::priority() const
+{
+    return _priority;
+}
+
+void SqlConnect::setSchedule(const SqlSchedule &schedule)
+{
+    _schedule = schedule;
+}
+
+const SqlSchedule &SqlConnect::schedule() const
+{
+    return _schedule;
+}
+
+void SqlConnect::notifyReady()
+{
+    if (!_isOverflow || !_onReady || isQueueFull())
+        return;
+
+    _isOverflow = false;
+    auto ready = _onReady;
+    ready(this);
+}
+
+SqlConnect::Callback SqlConnect::errorCommand(ErrorCode code)
+{
+    return [code](SqlConnect *self) {
+        self->_error = SqlError(code);
+        self->pop();
+    };
+}
+
+void SqlConnect::setQueueLimits(SqlQueueLimits limits, Callback ready)
+{
+    _queueLimits = limits;
+    _onReady = std::move(ready);
+}
+
+SqlQueueLimits SqlConnect::queueLimits() const
+{
+    return _queueLimits;
+}
+
+std::size_t SqlConnect::queueSize() const
+{
+    return _queuedQueries;
+}
+
+std::size_t SqlConnect::queueBytes() const
+{
+    return _memory.usage().queued;
+}
+
+bool SqlConnect::isQueueFull(std::size_t bytes) const
+{
+    return (_queueLimits.commands != 0 && _queuedQueries + 1 > _queueLimits.commands)
+        || (_queueLimits.bytes != 0 && _memory.usage().queued + bytes > _queueLimits.bytes);
+}
+
 struct pg_conn *SqlConnect::connect()
 {
     return _connect;
@@ -2,18 +2,77 @@
 
 #include "global.h"
 
+#include "SqlCell.h"
+#include "SqlDecode.h"
 #include "SqlError.h"
+#include "SqlMemory.h"
 #include "SqlResult.h"
+#include "SqlStream.h"
+#include "SqlTransaction.h"
 #include "SqlValue.h"
 
-#include <queue>
+#include <array>
+#include <chrono>
+#include <deque>
 #include <functional>
+#include <map>
+#include <memory>
+#include <memory_resource>
 
 using PGconn = struct pg_conn;
 struct event_base;
+struct event;
 
 namespace AsyncPg {
 
+struct SqlStreaming;
+struct SqlDecoding;
+
+/// Политика переполнения очереди запросов соединения
+enum class SqlOverflow
+{
+    Reject,     ///< Новый запрос завершается ошибкой ErrorCode::QueueOverflow
+    Ready,      ///< Как Reject, после освобождения места вызывается обработчик готовности
+    ShedOldest  ///< Старые запросы очереди завершаются ошибкой ErrorCode::QueueOverflow
+};
+
+/// Приоритет запросов соединения
+enum class SqlPriority
+{
+    High,    ///< Интерактивные запросы
+    Normal,  ///< Обычные запросы
+    Low      ///< Пакетные задания
+};
+
+/// Политика выбора очереди приоритета
+enum class SqlScheduling
+{
+    Strict,  ///< Строгий приоритет с защитой от голодания
+    Fair     ///< Взвешенное разделение между приоритетами
+};
+
+/// Параметры планировщика запросов соединения
+struct SqlSchedule
+{
+    /// Политика выбора очереди приоритета
+    SqlScheduling  scheduling = SqlScheduling::Strict;
+
+    /// Количество групп команд более высокого приоритета, после которого обслуживается
+    /// ожидающая группа (SqlScheduling::Strict, 0 - без защиты от голодания)
+    std::size_t  aging = 32;
+
+    /// Веса приоритетов High, Normal и Low (SqlScheduling::Fair)
+    std::array<unsigned int, 3>  weights = {8, 4, 1};
+};
+
+/// Лимиты очереди запросов соединения (0 - без ограничения)
+struct SqlQueueLimits
+{
+    std::size_t  commands = 0;                    ///< Количество запросов в очереди
+    std::size_t  bytes = 0;                       ///< Размер данных запросов в очереди
+    SqlOverflow  overflow = SqlOverflow::Reject;  ///< Политика переполнения
+};
+
 /// Соединение с базой данных
 class ASYNCPGLIB SqlConnect
 {
@@ -21,10 +80,25 @@ public:
     /// Функция обратного вызова
     using Callback = std::function<void(SqlConnect *)>;
 
+    /// Функция обратного вызова результата запроса сценария
+    using ResultCallback = std::function<void(SqlConnect *, SqlResult &)>;
+
+    /// Функция обратного вызова уведомления
+    using NotifyCallback =
+        std::function<void(SqlConnect *, std::string_view channel, std::string_view payload)>;
+
+    /// Функция обратного вызова декодированного результата
+    using DecodeCallback = std::function<void(SqlConnect *, SqlTable &)>;
+
     /// Конструктор класса
+    ///
+    /// Очередь команд и параметры запросов размещаются в пуле памяти соединения,
+    /// который получает память из заданного ресурса памяти.
     /// @param connInfo Строка соединения с базой данных в URI формате
     /// @param service Сервис ввода-вывода
-    explicit SqlConnect(std::string_view connInfo, struct event_base *evbase = nullptr);
+    /// @param resource Ресурс памяти (nullptr - ресурс памяти по умолчанию)
+    explicit SqlConnect(std::string_view connInfo, struct event_base *evbase = nullptr,
+                        std::pmr::memory_resource *resource = nullptr);
 
     /// Конструктор копирования
     SqlConnect(const SqlConnect&) = delete;
@@ -53,6 +127,54 @@ public:
     /// @param params Параметры запроса
     void execute(std::string_view sql, std::vector<SqlValue> params);
 
+    /// Выполняет параметрический запрос к базе данных
+    /// @param sql Запрос к базе данных
+    /// @param params Компактные параметры запроса
+    void execute(std::string_view sql, std::vector<SqlCell> params);
+
+    /// Выполняет параметрический запрос к базе данных без копирования параметров
+    ///
+    /// Данные параметров должны существовать до выполнения запроса.
+    /// @param sql Запрос к базе данных
+    /// @param params Параметры запроса, ссылающиеся на данные вызывающей стороны
+    void execute(std::string_view sql, std::vector<SqlParam> params);
+
+    /// Выполняет сценарий из нескольких запросов за один обмен с сервером
+    ///
+    /// Запросы выполняются простым протоколом, поэтому значения результатов передаются
+    /// в текстовом формате. Выполнение сценария прекращается на первой ошибке,
+    /// результаты предыдущих запросов сохраняются.
+    /// @param sql Запросы к базе данных, разделённые точкой с запятой
+    /// @param func Функция обратного вызова для каждого результата
+    ///             (nullptr - результаты сохраняются в results())
+    void executeScript(std::string_view sql, ResultCallback func = nullptr);
+
+    /// Выполняет запросы в транзакции за один обмен с сервером
+    ///
+    /// Команда начала транзакции, запросы и COMMIT передаются одним пакетом в режиме
+    /// конвейера. Результаты запросов сохраняются в results() в порядке запросов.
+    /// При ошибке оставшиеся запросы пропускаются сервером, транзакция откатывается,
+    /// а результаты очищаются. Превышение жёсткого лимита памяти не прерывает уже
+    /// отправленную транзакцию: она фиксируется без ошибки, а results() остаётся пустым.
+    /// @param statements Запросы транзакции
+    /// @param options Параметры транзакции
+    /// @param func Функция обратного вызова для каждого результата
+    ///             (nullptr - результаты сохраняются в results())
+    void transaction(std::vector<SqlStatement> statements, SqlTransactionOptions options = {},
+                     ResultCallback func = nullptr);
+
+    /// Подписывается на уведомления канала (LISTEN)
+    ///
+    /// Уведомления обрабатываются после завершения команд очереди, а при свободном
+    /// соединении - по мере поступления.
+    /// @param channel Наименование канала
+    /// @param func Обработчик уведомлений канала
+    void listen(std::string_view channel, NotifyCallback func);
+
+    /// Отписывается от уведомлений канала (UNLISTEN)
+    /// @param channel Наименование канала
+    void unlisten(std::string_view channel);
+
     /// Создаёт параметрический запрос к базе данных
     /// @param sql Запрос к базе данных
     /// @param sqlTypes Типы параметров
@@ -62,14 +184,85 @@ public:
     /// @param params Параметры запроса
     void execute(std::vector<SqlValue> params);
 
+    /// Выполняет подготовленный параметрический запрос к базе данных
+    /// @param params Компактные параметры запроса
+    void execute(std::vector<SqlCell> params);
+
+    /// Выполняет подготовленный параметрический запрос к базе данных без копирования параметров
+    ///
+    /// Данные параметров должны существовать до выполнения запроса.
+    /// @param params Параметры запроса, ссылающиеся на данные вызывающей стороны
+    void execute(std::vector<SqlParam> params);
+
     /// Отменяет запрос к базе данных
     /// @return Результат операции
     bool cancel();
 
+    /// Прерывает выполняемую команду, не очищая очередь команд
+    ///
+    /// Отмена отправляется, только если заданная команда выполняется и за ней в очереди
+    /// нет других запросов, поэтому отмена, полученная сервером после завершения команды,
+    /// не прерывает чужой запрос. Запрос отмены отправляется общим фоновым потоком
+    /// и не блокирует цикл событий, прерванный запрос завершается ошибкой.
+    /// @param command Номер команды (lastCommand() после добавления запроса)
+    /// @return Отправлен ли запрос отмены
+    bool interrupt(uint64_t command);
+
+    /// Возвращает номер последней добавленной в очередь команды
+    /// @return Номер команды (0 - команды не добавлялись)
+    uint64_t lastCommand() const;
+
     /// Устанавливает обработчик результата выполнения запроса
     /// @param func Функция обратного вызова
     void post(Callback func);
 
+    /// Декодирует результат выполнения запроса в фоновых потоках, не блокируя цикл событий
+    ///
+    /// Фоновый поток создаётся один раз и используется последующими вызовами. На время
+    /// декодирования результат переносится в задание и возвращается в result() перед
+    /// вызовом обработчика, деструктор соединения ожидает завершения декодирования.
+    /// @param func Функция обратного вызова, вызываемая в потоке цикла событий
+    /// @param layout Раскладка декодированного результата
+    /// @param threads Количество потоков (0 - по числу ядер процессора)
+    void decode(DecodeCallback func, SqlLayout layout = SqlLayout::Rows, unsigned int threads = 0);
+
+    /// Читает большой объект фрагментами
+    /// @param loid Идентификатор большого объекта
+    /// @param sink Приёмник фрагментов данных
+    /// @param done Обработчик завершения чтения
+    /// @param chunkSize Размер фрагмента
+    void readLargeObject(unsigned int loid, SqlChunkSink sink, SqlStreamCallback done,
+                         std::size_t chunkSize = SqlChunkSize);
+
+    /// Перезаписывает большой объект фрагментами
+    /// @param loid Идентификатор существующего большого объекта (lo_create)
+    /// @param source Источник фрагментов данных
+    /// @param done Обработчик завершения записи
+    /// @param chunkSize Размер фрагмента
+    void writeLargeObject(unsigned int loid, SqlChunkSource source, SqlStreamCallback done,
+                          std::size_t chunkSize = SqlChunkSize);
+
+    /// Читает значение bytea фрагментами с помощью substring()
+    /// @param sql Запрос, возвращающий одно значение bytea
+    /// @param params Параметры запроса
+    /// @param sink Приёмник фрагментов данных
+    /// @param done Обработчик завершения чтения
+    /// @param chunkSize Размер фрагмента
+    void readBytea(std::string_view sql, std::vector<SqlValue> params, SqlChunkSink sink,
+                   SqlStreamCallback done, std::size_t chunkSize = SqlChunkSize);
+
+    /// Записывает значение bytea фрагментами
+    ///
+    /// Запрос выполняется для каждого фрагмента, фрагмент передаётся последним
+    /// параметром, например: UPDATE files SET data = data || $2 WHERE id = $1
+    /// @param sql Запрос, дописывающий фрагмент
+    /// @param params Параметры запроса без фрагмента
+    /// @param source Источник фрагментов данных
+    /// @param done Обработчик завершения записи
+    /// @param chunkSize Размер фрагмента
+    void writeBytea(std::string_view sql, std::vector<SqlValue> params, SqlChunkSource source,
+                    SqlStreamCallback done, std::size_t chunkSize = SqlChunkSize);
+
     /// Создаёт копию текущего соединения с базой данных
     /// @return Соединение с базой данных
     SqlConnect clone();
@@ -82,41 +275,317 @@ public:
     /// @return Результат выполнения запроса
     const SqlResult &result() const;
 
+    /// Возвращает результаты запросов сценария
+    /// @return Результаты запросов сценария
+    const std::vector<SqlResult> &results() const;
+
+    /// Забирает результаты запросов сценария
+    /// @return Результаты запросов сценария
+    std::vector<SqlResult> takeResults();
+
+    /// Забирает результат выполнения запроса в разделяемое владение
+    /// @param compact Перенести значения в компактное хранилище
+    /// @return Разделяемый результат выполнения запроса
+    SqlSharedResult takeResult(bool compact = false);
+
     /// Проверяет занято ли соединение выполнением запросов
     /// @return Результат проверки
     bool isBusy() const;
 
+    /// Возвращает количество выполняемых и ожидающих в очереди команд
+    /// @return Количество команд
+    std::size_t inFlight() const;
+
+    /// Возвращает экспоненциально сглаженное время выполнения запросов
+    ///
+    /// Время измеряется от отправки запроса до получения всех его результатов.
+    /// @return Время выполнения запросов (0 - запросы не выполнялись)
+    std::chrono::microseconds latency() const;
+
+    /// Сбрасывает время выполнения запросов
+    void resetLatency();
+
+    /// Устанавливает лимиты памяти соединения
+    ///
+    /// При использовании памяти не ниже мягкого лимита запросы выполняются в потоковом
+    /// режиме: строки результата по мере получения переносятся в компактное хранилище,
+    /// а жёсткий лимит проверяется после каждой строки. Команда или запрос, превышающие
+    /// жёсткий лимит, завершаются ошибкой ErrorCode::MemoryLimitExceeded, а обработчики
+    /// результатов (post(), decode()) вызываются с этой ошибкой.
+    /// @param limits Лимиты памяти соединения
+    void setMemoryLimits(SqlMemoryLimits limits);
+
+    /// Возвращает лимиты памяти соединения
+    /// @return Лимиты памяти соединения
+    SqlMemoryLimits memoryLimits() const;
+
+    /// Возвращает использование памяти соединением
+    /// @return Использование памяти очередью команд и результатами запросов
+    SqlMemoryUsage memoryUsage() const;
+
+    /// Устанавливает лимиты очереди запросов
+    ///
+    /// Ограничиваются запросы, ожидающие в очереди. Обработчики результатов и потоковые
+    /// команды не ограничиваются. Отклонённый или вытесненный запрос заменяется в очереди
+    /// ошибкой ErrorCode::QueueOverflow, поэтому его обработчик результата вызывается
+    /// в прежнем порядке.
+    /// @param limits Лимиты очереди запросов
+    /// @param ready Обработчик готовности, вызываемый после освобождения места в очереди
+    ///              при политике SqlOverflow::Ready
+    void setQueueLimits(SqlQueueLimits limits, Callback ready = nullptr);
+
+    /// Возвращает лимиты очереди запросов
+    /// @return Лимиты очереди запросов
+    SqlQueueLimits queueLimits() const;
+
+    /// Возвращает количество запросов в очереди
+    /// @return Количество запросов
+    std::size_t queueSize() const;
+
+    /// Возвращает размер данных команд в очереди
+    /// @return Размер данных в байтах
+    std::size_t queueBytes() const;
+
+    /// Проверяет заполнена ли очередь запросов
+    /// @param bytes Размер данных добавляемого запроса
+    /// @return Результат проверки
+    bool isQueueFull(std::size_t bytes = 0) const;
+
+    /// Устанавливает приоритет следующих запросов
+    ///
+    /// Запросы выполняются группами: запрос и добавленные после него обработчики
+    /// (post(), decode()) выполняются подряд в очереди приоритета запроса, поэтому
+    /// порядок цепочек обработчиков сохраняется при любом приоритете.
+    /// @param priority Приоритет запросов
+    void setPriority(SqlPriority priority);
+
+    /// Возвращает приоритет следующих запросов
+    /// @return Приоритет запросов
+    SqlPriority priority() const;
+
+    /// Устанавливает параметры планировщика запросов
+    /// @param schedule Параметры планировщика запросов
+    void setSchedule(const SqlSchedule &schedule);
+
+    /// Возвращает параметры планировщика запросов
+    /// @return Параметры планировщика запросов
+    const SqlSchedule &schedule() const;
+
+    /// Возвращает таблицу пользовательских типов PostgreSql соединения
+    /// @return Таблица пользовательских типов (nullptr - типы не определены, см. typeError())
+    std::shared_ptr<const SqlTypeMap> typeMap() const;
+
+    /// Возвращает ошибку определения типов PostgreSql зарегистрированных кодеков
+    ///
+    /// Типы определяются после соединения до выполнения команд очереди. При ошибке
+    /// значения пользовательских типов не декодируются кодеками.
+    /// @return Ошибка определения типов
+    const SqlError &typeError() const;
+
+    /// Возвращает пул памяти соединения
+    ///
+    /// Пул не синхронизирован и используется только в потоке цикла событий.
+    /// @return Ресурс памяти
+    std::pmr::memory_resource *memoryResource() const;
+
     /// Производит соединение с PostgreSql
     void connecting();
 
+    /// Производит определение типов PostgreSql зарегистрированных кодеков
+    void resolving();
+
+    /// Производит выполнение шага потоковой передачи данных
+    void stepping();
+
     /// Производит подготовку параметрического SQL запроса
     void preparing();
 
     /// Производит запуск SQL запроса
     void executing();
 
+    /// Производит выполнение сценария из нескольких запросов
+    void scripting();
+
+    /// Производит получение результатов транзакции
+    void transacting();
+
+    /// Производит откат транзакции
+    void rollingBack();
+
+    /// Производит получение уведомлений свободного соединения
+    void notifying();
+
+    /// Производит завершение фонового декодирования результата
+    void decoding();
+
 protected:
+    /// Вид команды очереди соединения
+    enum class CommandKind
+    {
+        Query,   ///< Запрос, ограничиваемый лимитами очереди
+        Task,    ///< Команда, не ограничиваемая лимитами очереди
+        Handler  ///< Обработчик, выполняемый в группе предыдущей команды
+    };
+
     /// Возвращает соединение PostgreSql
     /// @return Соединение PostgreSql
     PGconn *connect();
 
     /// Добавляет обработчик результата SQL запроса в очередь
     /// @param callback Функция обратного вызова
+    /// @param bytes Размер данных, захваченных функцией обратного вызова
+    /// @param kind Вид команды
     /// @return Была ли вызван callback
-    bool push(const Callback &callback);
+    bool push(const Callback &callback, std::size_t bytes = 0,
+              CommandKind kind = CommandKind::Handler);
 
     /// Убирает обработчик результата SQL запроса из очереди
     void pop();
 
 private:
-    struct event_base    *_evbase = nullptr;
-    std::queue<Callback>  _callbackQueue;
-    PGconn               *_connect = nullptr;
-    std::string           _connInfo;
-    SqlError              _error;
-    SqlResult             _result;
-    bool                  _isExec = true;
-    int                   _socket = -1;
+    /// Выполняет параметрический запрос к базе данных
+    /// @param sql Запрос к базе данных
+    /// @param params Параметры запроса
+    template<class Params>
+    void executeParams(std::string_view sql, Params params);
+
+    /// Выполняет подготовленный параметрический запрос к базе данных
+    /// @param params Параметры запроса
+    template<class Params>
+    void executePrepared(Params params);
+
+    /// Запрашивает типы PostgreSql зарегистрированных кодеков
+    void resolveTypes();
+
+    /// Запускает поток фонового декодирования результатов
+    /// @return Состояние фонового декодирования (nullptr - декодирование в цикле событий)
+    SqlDecoding *startDecoding();
+
+    /// Обработчик результата шага потоковой передачи данных
+    using StepCallback = std::function<void(SqlConnect *, const SqlResult &)>;
+
+    /// Выполняет шаг потоковой передачи данных внутри текущей команды
+    /// @param sql Запрос к базе данных
+    /// @param params Параметры запроса
+    /// @param extra Дополнительные параметры запроса без копирования
+    /// @param func Обработчик результата шага
+    void step(const char *sql, const std::vector<SqlValue> &params,
+              const std::vector<SqlParam> &extra, StepCallback func);
+
+    /// Выполняет очередной шаг потоковой передачи данных
+    /// @param stream Состояние потоковой передачи данных
+    void streamNext(const std::shared_ptr<SqlStreaming> &stream);
+
+    /// Начинает получение результата запроса
+    ///
+    /// Запоминает время отправки запроса и включает потоковый режим получения
+    /// результата при превышении мягкого лимита.
+    void startResult();
+
+    /// Учитывает время выполнения завершённого запроса
+    void updateLatency();
+
+    /// Принимает строки результата запроса в потоковом режиме
+    void receiveRows();
+
+    /// Обновляет учёт памяти результатов запросов
+    void updateResultMemory();
+
+    /// Освобождает место в очереди для запроса согласно политике переполнения
+    /// @param bytes Размер данных запроса
+    /// @return Помещается ли запрос в очередь
+    bool reserveQueue(std::size_t bytes);
+
+    /// Выполняет команду подписки на уведомления канала
+    /// @param command Команда LISTEN или UNLISTEN
+    /// @param channel Наименование канала
+    void sendListen(const char *command, std::string channel);
+
+    /// Отправляет запрос отмены выполняемого запроса в фоновом потоке
+    /// @return Отправлен ли запрос отмены
+    bool sendCancel();
+
+    /// Вызывает обработчики полученных уведомлений
+    void dispatchNotifies();
+
+    /// Ожидает уведомления, пока соединение свободно
+    void watchNotifies();
+
+    /// Выбирает очередь приоритета следующей команды
+    /// @return Номер очереди приоритета (Lanes - очереди пусты)
+    std::size_t selectLane();
+
+    /// Вызывает обработчик готовности после освобождения места в очереди
+    void notifyReady();
+
+    /// Возвращает команду, завершающую запрос ошибкой
+    /// @param code Код ошибки
+    /// @return Функция обратного вызова
+    static Callback errorCommand(ErrorCode code);
+
+    /// Проверяет превышен ли жёсткий лимит памяти
+    /// @param bytes Размер дополнительных данных
+    /// @return Результат проверки
+    bool isHardLimitExceeded(std::size_t bytes = 0) const;
+
+    /// Обрабатывает результат шага потоковой передачи данных
+    /// @param stream Состояние потоковой передачи данных
+    /// @param result Результат шага
+    void streamResult(const std::shared_ptr<SqlStreaming> &stream, const SqlResult &result);
+
+    /// Команда очереди соединения
+    struct Command
+    {
+        Callback     callback;   ///< Функция обратного вызова
+        std::size_t  bytes = 0;  ///< Размер данных, захваченных функцией обратного вызова
+        CommandKind  kind = CommandKind::Task;  ///< Вид команды
+        uint64_t     id = 0;     ///< Номер команды
+    };
+
+    using CallbackQueue = std::pmr::deque<Command>;
+
+    /// Количество очередей приоритета
+    static constexpr std::size_t Lanes = 3;
+    using MemoryPool = std::pmr::unsynchronized_pool_resource;
+
+    struct event_base                 *_evbase = nullptr;
+    std::shared_ptr<MemoryPool>        _pool;
+    std::array<CallbackQueue, Lanes>   _lanes;
+    SqlSchedule                        _schedule;
+    std::array<std::size_t, Lanes>     _waits = {};
+    std::array<int64_t, Lanes>         _credits = {};
+    SqlPriority                        _priority = SqlPriority::Normal;
+    std::size_t                        _lane = 1;
+    std::size_t                        _tailLane = 1;
+    PGconn                            *_connect = nullptr;
+    std::string                        _connInfo;
+    SqlError                           _error;
+    SqlResult                          _result;
+    SqlResult                          _partial;
+    SqlMemoryCounter                   _memory;
+    SqlMemoryLimits                    _limits;
+    SqlQueueLimits                     _queueLimits;
+    Callback                           _onReady;
+    std::size_t                        _queuedQueries = 0;
+    bool                               _isOverflow = false;
+    std::vector<SqlResult>             _results;
+    ResultCallback                     _onResult;
+    std::map<std::string, NotifyCallback, std::less<>>  _listeners;
+    struct event                      *_notifyEvent = nullptr;
+    std::chrono::steady_clock::time_point  _sentAt;
+    std::chrono::microseconds          _latency{0};
+    std::size_t                        _pipelineQuery = 0;
+    std::size_t                        _pipelineSize = 0;
+    bool                               _isDropped = false;
+    uint64_t                           _lastCommand = 0;
+    uint64_t                           _command = 0;
+    StepCallback                       _step;
+    std::shared_ptr<const SqlTypeMap>  _types;
+    SqlError                           _typeError;
+    std::unique_ptr<SqlDecoding>       _decoding;
+    bool                               _isExec = true;
+    bool                               _singleRow = false;
+    int                                _socket = -1;
 };
 
 }
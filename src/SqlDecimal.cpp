@@ -0,0 +1,621 @@
+﻿#include "SqlDecimal.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <limits>
+
+namespace AsyncPg {
+
+#define NUMERIC_POS  0x0000
+#define NUMERIC_NEG  0x4000
+#define NUMERIC_NAN  0xC000
+#define NUMERIC_PINF 0xD000
+#define NUMERIC_NINF 0xF000
+
+/// Признаки десятичного числа
+enum DecimalFlag : uint8_t {
+    Negative = 1,
+    NotNumber = 2,
+    Infinite = 4,
+};
+
+/// Максимальный порядок экспоненциальной записи (как NUMERIC_MAX_PRECISION сервера)
+static constexpr int MaxExponent = 1000;
+
+/// Разобранное текстовое представление десятичного числа
+struct NumericText
+{
+    uint16_t          sign = NUMERIC_POS;
+    std::string_view  intPart;
+    std::string_view  fracPart;
+    std::string       digits;  ///< Цифры со сдвинутой экспонентой точкой
+};
+
+static int16_t readInt16(const char *data)
+{
+    return static_cast<int16_t>(
+        (static_cast<uint8_t>(data[0]) << 8) | static_cast<uint8_t>(data[1]));
+}
+
+static void writeInt16(char *out, int value)
+{
+    out[0] = static_cast<char>((value >> 8) & 0xFF);
+    out[1] = static_cast<char>(value & 0xFF);
+}
+
+static bool isDigit(char c)
+{
+    return '0' <= c && c <= '9';
+}
+
+static bool isSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+static bool equalsNoCase(std::string_view str, std::string_view word)
+{
+    if (str.size() != word.size())
+        return false;
+    for (std::size_t i = 0; i < str.size(); ++i) {
+        auto c = str[i];
+        if ('A' <= c && c <= 'Z')
+            c = static_cast<char>(c - 'A' + 'a');
+        if (c != word[i])
+            return false;
+    }
+    return true;
+}
+
+/// Переносит точку на заданное количество разрядов
+/// @param text Разобранное число без экспоненты
+/// @param exponent Порядок экспоненциальной записи
+static void shiftPoint(NumericText &text, int exponent)
+{
+    // Масштаб уменьшается на порядок, как в numeric_in сервера
+    const auto nInt = static_cast<long>(text.intPart.size());
+    const auto nFrac = static_cast<long>(text.fracPart.size());
+    const auto point = nInt + exponent;
+    const auto outInt = std::max(point, 0L);
+    const auto outFrac = std::max(nFrac - exponent, 0L);
+    const auto start = point - outInt;
+
+    text.digits.assign(static_cast<std::size_t>(outInt + outFrac), '0');
+    for (long pos = 0; pos < outInt + outFrac; ++pos) {
+        const auto source = start + pos;
+        if (source >= 0 && source < nInt)
+            text.digits[static_cast<std::size_t>(pos)] = text.intPart[static_cast<std::size_t>(source)];
+        else if (source >= nInt && source < nInt + nFrac)
+            text.digits[static_cast<std::size_t>(pos)] =
+                text.fracPart[static_cast<std::size_t>(source - nInt)];
+    }
+
+    const std::string_view digits = text.digits;
+    text.intPart = digits.substr(0, static_cast<std::size_t>(outInt));
+    text.fracPart = digits.substr(static_cast<std::size_t>(outInt));
+}
+
+static bool parseNumeric(std::string_view str, NumericText &text)
+{
+    text = NumericText{};
+    while (!str.empty() && isSpace(str.front()))
+        str.remove_prefix(1);
+    while (!str.empty() && isSpace(str.back()))
+        str.remove_suffix(1);
+
+    if (equalsNoCase(str, "nan")) {
+        text.sign = NUMERIC_NAN;
+        return true;
+    }
+
+    std::size_t pos = 0;
+    if (pos < str.size() && (str[pos] == '-' || str[pos] == '+')) {
+        if (str[pos] == '-')
+            text.sign = NUMERIC_NEG;
+        ++pos;
+    }
+
+    const auto word = str.substr(pos);
+    if (equalsNoCase(word, "infinity") || equalsNoCase(word, "inf")) {
+        text.sign = (text.sign == NUMERIC_NEG) ? NUMERIC_NINF : NUMERIC_PINF;
+        return true;
+    }
+
+    auto beg = pos;
+    while (pos < str.size() && isDigit(str[pos]))
+        ++pos;
+    text.intPart = str.substr(beg, pos - beg);
+
+    if (pos < str.size() && str[pos] == '.') {
+        beg = ++pos;
+        while (pos < str.size() && isDigit(str[pos]))
+            ++pos;
+        text.fracPart = str.substr(beg, pos - beg);
+    }
+
+    if (text.intPart.empty() && text.fracPart.empty())
+        return false;
+
+    if (pos < str.size() && (str[pos] == 'e' || str[pos] == 'E')) {
+        ++pos;
+        bool negative = false;
+        if (pos < str.size() && (str[pos] == '-' || str[pos] == '+')) {
+            negative = str[pos] == '-';
+            ++pos;
+        }
+
+        beg = pos;
+        int exponent = 0;
+        while (pos < str.size() && isDigit(str[pos]) && exponent <= MaxExponent)
+            exponent = exponent * 10 + (str[pos++] - '0');
+        if (pos == beg || exponent > MaxExponent || pos != str.size())
+            return false;
+
+        shiftPoint(text, negative ? -exponent : exponent);
+    }
+
+    if (pos != str.size())
+        return false;
+
+    while (!text.intPart.empty() && text.intPart.front() == '0')
+        text.intPart.remove_prefix(1);
+
+    return true;
+}
+
+/// Записывает группы цифр по основанию 10000 двоичного значения NUMERIC
+/// @param sign Знак числа
+/// @param nInt Количество цифр целой части без ведущих нулей
+/// @param nFrac Количество цифр дробной части
+/// @param digitAt Функция получения цифры по номеру
+/// @param out Буфер для записи (nullptr - только вычисление размера)
+/// @return Размер двоичного значения NUMERIC
+template<class DigitAt>
+static std::size_t encodeGroups(
+    uint16_t sign, std::size_t nInt, std::size_t nFrac, DigitAt digitAt, char *out)
+{
+    const auto leftPad = (4 - nInt % 4) % 4;
+    const auto rightPad = (4 - nFrac % 4) % 4;
+    const auto groups = (leftPad + nInt + nFrac + rightPad) / 4;
+
+    auto groupAt = [&](std::size_t group) {
+        int value = 0;
+        for (auto pos = group * 4, end = pos + 4; pos < end; ++pos) {
+            int digit = 0;
+            if (pos >= leftPad && pos < leftPad + nInt + nFrac)
+                digit = digitAt(pos - leftPad);
+            value = value * 10 + digit;
+        }
+        return value;
+    };
+
+    std::size_t first = 0;
+    while (first < groups && groupAt(first) == 0)
+        ++first;
+    std::size_t last = groups;
+    while (last > first && groupAt(last - 1) == 0)
+        --last;
+
+    const auto ndigits = last - first;
+    const auto size = 8 + ndigits * 2;
+    if (!out)
+        return size;
+
+    auto weight = static_cast<int>((leftPad + nInt) / 4) - 1 - static_cast<int>(first);
+    if (ndigits == 0) {
+        weight = 0;
+        sign = NUMERIC_POS;
+    }
+
+    writeInt16(out, static_cast<int>(ndigits));
+    writeInt16(out + 2, weight);
+    writeInt16(out + 4, sign);
+    writeInt16(out + 6, static_cast<int>(nFrac));
+    for (auto group = first; group < last; ++group)
+        writeInt16(out + 8 + (group - first) * 2, groupAt(group));
+
+    return size;
+}
+
+static std::size_t encodeSpecial(uint16_t sign, char *out)
+{
+    if (out) {
+        writeInt16(out, 0);
+        writeInt16(out + 2, 0);
+        writeInt16(out + 4, sign);
+        writeInt16(out + 6, 0);
+    }
+    return 8;
+}
+
+static std::size_t encodeText(const NumericText &text, char *out)
+{
+    if (text.sign != NUMERIC_POS && text.sign != NUMERIC_NEG)
+        return encodeSpecial(text.sign, out);
+
+    const auto nInt = text.intPart.size();
+    return encodeGroups(text.sign, nInt, text.fracPart.size(), [&text, nInt](std::size_t pos) {
+        return (pos < nInt) ? text.intPart[pos] - '0' : text.fracPart[pos - nInt] - '0';
+    }, out);
+}
+
+std::size_t numericPgSize(std::string_view str)
+{
+    NumericText text;
+    if (!parseNumeric(str, text))
+        return 0;
+    return encodeText(text, nullptr);
+}
+
+void numericToPg(std::string_view str, char *out)
+{
+    NumericText text;
+    if (parseNumeric(str, text))
+        encodeText(text, out);
+}
+
+static char *copyText(std::string_view str, char *out)
+{
+    std::memcpy(out, str.data(), str.size());
+    return out + str.size();
+}
+
+std::size_t numericTextSize(const char *data, int /*length*/)
+{
+    const auto weight = readInt16(data + 2);
+    const auto dscale = readInt16(data + 6);
+    return 9 + (weight < 0 ? 1 : 4 * (weight + 1)) + (dscale > 0 ? 1 + dscale : 0);
+}
+
+char *numericToChars(const char *data, int /*length*/, char *out)
+{
+    const auto ndigits = readInt16(data);
+    const auto weight = readInt16(data + 2);
+    const auto sign = static_cast<uint16_t>(readInt16(data + 4));
+    const auto dscale = readInt16(data + 6);
+
+    switch (sign) {
+    case NUMERIC_NAN:
+        return copyText("NaN", out);
+    case NUMERIC_PINF:
+        return copyText("Infinity", out);
+    case NUMERIC_NINF:
+        return copyText("-Infinity", out);
+    default:
+        break;
+    }
+
+    auto digitAt = [data, ndigits](int group) {
+        return (group >= 0 && group < ndigits) ? readInt16(data + 8 + group * 2) : 0;
+    };
+
+    if (sign == NUMERIC_NEG)
+        *out++ = '-';
+
+    if (weight < 0) {
+        *out++ = '0';
+    } else {
+        for (int group = 0; group <= weight; ++group) {
+            const auto digit = digitAt(group);
+            if (group == 0) {
+                out = std::to_chars(out, out + 4, digit).ptr;
+                continue;
+            }
+            out[0] = static_cast<char>('0' + digit / 1000);
+            out[1] = static_cast<char>('0' + digit / 100 % 10);
+            out[2] = static_cast<char>('0' + digit / 10 % 10);
+            out[3] = static_cast<char>('0' + digit % 10);
+            out += 4;
+        }
+    }
+
+    if (dscale > 0) {
+        *out++ = '.';
+        int written = 0;
+        for (int group = weight + 1; written < dscale; ++group) {
+            const auto digit = digitAt(group);
+            const char digits[4] = {
+                static_cast<char>('0' + digit / 1000),
+                static_cast<char>('0' + digit / 100 % 10),
+                static_cast<char>('0' + digit / 10 % 10),
+                static_cast<char>('0' + digit % 10)};
+            for (int i = 0; i < 4 && written < dscale; ++i, ++written)
+                *out++ = digits[i];
+        }
+    }
+
+    return out;
+}
+
+/// Умножает 128-битный коэффициент и прибавляет значение
+/// @return false при переполнении
+static bool mulAdd(uint32_t (&coef)[4], uint32_t mul, uint32_t add)
+{
+    uint64_t carry = add;
+    for (auto &limb : coef) {
+        const uint64_t value = static_cast<uint64_t>(limb) * mul + carry;
+        limb = static_cast<uint32_t>(value);
+        carry = value >> 32;
+    }
+    return carry == 0;
+}
+
+/// Делит 128-битный коэффициент
+/// @return Остаток от деления
+static uint32_t divMod(uint32_t (&coef)[4], uint32_t div)
+{
+    uint64_t rem = 0;
+    for (int i = 3; i >= 0; --i) {
+        const uint64_t value = (rem << 32) | coef[i];
+        coef[i] = static_cast<uint32_t>(value / div);
+        rem = value % div;
+    }
+    return static_cast<uint32_t>(rem);
+}
+
+static bool isZero(const uint32_t (&coef)[4])
+{
+    return (coef[0] | coef[1] | coef[2] | coef[3]) == 0;
+}
+
+/// Записывает цифры 128-битного коэффициента
+/// @return Количество цифр
+static std::size_t coefDigits(const uint32_t (&coef)[4], char (&digits)[40])
+{
+    uint32_t value[4] = {coef[0], coef[1], coef[2], coef[3]};
+    std::size_t count = 0;
+    do {
+        digits[count++] = static_cast<char>('0' + divMod(value, 10));
+    } while (!isZero(value));
+    std::reverse(digits, digits + count);
+    return count;
+}
+
+/// Записывает двоичное значение NUMERIC для 128-битного коэффициента
+/// @param out Буфер для записи (nullptr - только вычисление размера)
+/// @return Размер двоичного значения NUMERIC
+static std::size_t encodeCoef(const uint32_t (&coef)[4], int16_t scale, bool negative, char *out)
+{
+    char digits[40];
+    const auto count = isZero(coef) ? 0 : coefDigits(coef, digits);
+    const auto nFrac = static_cast<std::size_t>(scale);
+    const auto nInt = (count > nFrac) ? count - nFrac : 0;
+    const auto shift = nInt + nFrac - count;
+    return encodeGroups(negative ? NUMERIC_NEG : NUMERIC_POS, nInt, nFrac,
+                        [&digits, shift](std::size_t pos) {
+        return (pos < shift) ? 0 : digits[pos - shift] - '0';
+    }, out);
+}
+
+SqlDecimal::SqlDecimal(int64_t unscaled, int16_t scale)
+    : _scale(std::max<int16_t>(scale, 0))
+{
+    auto value = static_cast<uint64_t>(unscaled);
+    if (unscaled < 0) {
+        value = ~value + 1;
+        _flags = Negative;
+    }
+    _coef[0] = static_cast<uint32_t>(value);
+    _coef[1] = static_cast<uint32_t>(value >> 32);
+
+    // Отрицательный масштаб умножает коэффициент на степень 10
+    for (int i = scale; i < 0 && !isZero(_coef); ++i) {
+        if (!mulAdd(_coef, 10, 0)) {
+            auto digits = std::to_string(unscaled);
+            digits.append(static_cast<std::size_t>(-scale), '0');
+            _text = std::make_shared<const std::string>(std::move(digits));
+            std::fill(std::begin(_coef), std::end(_coef), 0);
+            break;
+        }
+    }
+}
+
+std::optional<SqlDecimal> SqlDecimal::fromString(std::string_view str)
+{
+    NumericText text;
+    if (!parseNumeric(str, text))
+        return std::nullopt;
+
+    SqlDecimal result;
+    switch (text.sign) {
+    case NUMERIC_NAN:
+        result._flags = NotNumber;
+        return result;
+    case NUMERIC_PINF:
+        result._flags = Infinite;
+        return result;
+    case NUMERIC_NINF:
+        result._flags = Infinite | Negative;
+        return result;
+    default:
+        break;
+    }
+
+    bool fixed = text.fracPart.size() <= static_cast<std::size_t>(std::numeric_limits<int16_t>::max());
+    for (auto part : {text.intPart, text.fracPart}) {
+        for (std::size_t i = 0; fixed && i < part.size(); ++i)
+            fixed = mulAdd(result._coef, 10, static_cast<uint32_t>(part[i] - '0'));
+    }
+
+    result._scale = static_cast<int16_t>(
+        std::min<std::size_t>(text.fracPart.size(), std::numeric_limits<int16_t>::max()));
+    if (text.sign == NUMERIC_NEG)
+        result._flags = Negative;
+
+    if (!fixed) {
+        std::string digits;
+        digits.reserve(text.intPart.size() + text.fracPart.size() + 3);
+        if (text.sign == NUMERIC_NEG)
+            digits += '-';
+        digits += text.intPart.empty() ? std::string_view("0") : text.intPart;
+        if (!text.fracPart.empty()) {
+            digits += '.';
+            digits += text.fracPart;
+        }
+        result._text = std::make_shared<const std::string>(std::move(digits));
+        std::fill(std::begin(result._coef), std::end(result._coef), 0);
+    }
+
+    return result;
+}
+
+SqlDecimal SqlDecimal::fromPg(const char *data, int length)
+{
+    SqlDecimal result;
+    const auto ndigits = readInt16(data);
+    const auto weight = readInt16(data + 2);
+    const auto sign = static_cast<uint16_t>(readInt16(data + 4));
+    const auto dscale = readInt16(data + 6);
+
+    switch (sign) {
+    case NUMERIC_NAN:
+        result._flags = NotNumber;
+        return result;
+    case NUMERIC_PINF:
+        result._flags = Infinite;
+        return result;
+    case NUMERIC_NINF:
+        result._flags = Infinite | Negative;
+        return result;
+    case NUMERIC_NEG:
+        result._flags = Negative;
+        break;
+    default:
+        break;
+    }
+    result._scale = dscale;
+
+    bool fixed = true;
+    for (int i = 0; fixed && i < ndigits; ++i)
+        fixed = mulAdd(result._coef, 10000, static_cast<uint32_t>(readInt16(data + 8 + i * 2)));
+
+    const int exp10 = (ndigits == 0) ? dscale : 4 * (ndigits - 1 - weight);
+    for (int i = exp10; fixed && i < dscale; ++i)
+        fixed = mulAdd(result._coef, 10, 0);
+    for (int i = dscale; fixed && i < exp10; ++i)
+        divMod(result._coef, 10);
+
+    if (!fixed) {
+        std::string text(numericTextSize(data, length), '\0');
+        text.resize(static_cast<std::size_t>(numericToChars(data, length, text.data()) - text.data()));
+        result._text = std::make_shared<const std::string>(std::move(text));
+        std::fill(std::begin(result._coef), std::end(result._coef), 0);
+    }
+
+    return result;
+}
+
+std::string SqlDecimal::toString() const
+{
+    std::string result(_text ? _text->size() : 44 + static_cast<std::size_t>(_scale), '\0');
+    auto *end = toChars(result.data(), result.data() + result.size());
+    result.resize(static_cast<std::size_t>(end - result.data()));
+    return result;
+}
+
+char *SqlDecimal::toChars(char *first, char *last) const
+{
+    const auto size = static_cast<std::size_t>(last - first);
+    if (_flags & (NotNumber | Infinite)) {
+        std::string_view text = (_flags & NotNumber) ? "NaN"
+            : (_flags & Negative) ? "-Infinity" : "Infinity";
+        return (text.size() <= size) ? copyText(text, first) : nullptr;
+    }
+
+    if (_text)
+        return (_text->size() <= size) ? copyText(*_text, first) : nullptr;
+
+    char digits[40];
+    const auto count = coefDigits(_coef, digits);
+    const auto scale = static_cast<std::size_t>(_scale);
+    const bool negative = (_flags & Negative) && !isZero(_coef);
+    const auto length = (negative ? 1 : 0)
+        + (scale >= count ? 2 + scale : count + (scale > 0 ? 1 : 0));
+    if (length > size)
+        return nullptr;
+
+    if (negative)
+        *first++ = '-';
+
+    if (scale >= count) {
+        *first++ = '0';
+        *first++ = '.';
+        first = std::fill_n(first, scale - count, '0');
+        return copyText(std::string_view(digits, count), first);
+    }
+
+    first = copyText(std::string_view(digits, count - scale), first);
+    if (scale > 0) {
+        *first++ = '.';
+        first = copyText(std::string_view(digits + count - scale, scale), first);
+    }
+    return first;
+}
+
+std::size_t SqlDecimal::pgSize() const
+{
+    if (_flags & (NotNumber | Infinite))
+        return 8;
+    if (_text)
+        return numericPgSize(*_text);
+    return encodeCoef(_coef, _scale, _flags & Negative, nullptr);
+}
+
+void SqlDecimal::toPg(char *out) const
+{
+    if (_flags & NotNumber)
+        encodeSpecial(NUMERIC_NAN, out);
+    else if (_flags & Infinite)
+        encodeSpecial((_flags & Negative) ? NUMERIC_NINF : NUMERIC_PINF, out);
+    else if (_text)
+        numericToPg(*_text, out);
+    else
+        encodeCoef(_coef, _scale, _flags & Negative, out);
+}
+
+bool SqlDecimal::toUnscaled(int64_t &unscaled) const
+{
+    if (!isFixed() || _coef[2] != 0 || _coef[3] != 0)
+        return false;
+
+    const auto value = (static_cast<uint64_t>(_coef[1]) << 32) | _coef[0];
+    const auto limit = static_cast<uint64_t>(std::numeric_limits<int64_t>::max());
+    if (_flags & Negative) {
+        if (value > limit + 1)
+            return false;
+        unscaled = static_cast<int64_t>(~value + 1);
+    } else {
+        if (value > limit)
+            return false;
+        unscaled = static_cast<int64_t>(value);
+    }
+    return true;
+}
+
+int16_t SqlDecimal::scale() const
+{
+    return _scale;
+}
+
+bool SqlDecimal::isNegative() const
+{
+    return (_flags & Negative) && (_text || (_flags & Infinite) || !isZero(_coef));
+}
+
+bool SqlDecimal::isNaN() const
+{
+    return _flags & NotNumber;
+}
+
+bool SqlDecimal::isInfinity() const
+{
+    return _flags & Infinite;
+}
+
+bool SqlDecimal::isFixed() const
+{
+    return !_text && !(_flags & (NotNumber | Infinite));
+}
+
+}
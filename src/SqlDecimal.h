@@ -0,0 +1,114 @@
+﻿#pragma once
+
+#include "global.h"
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace AsyncPg {
+
+/// Десятичное число с фиксированной точкой
+///
+/// Значение хранится в виде 128-битного коэффициента и масштаба
+/// (количества цифр после точки). Числа, не помещающиеся в 128 бит,
+/// хранятся в виде текстового представления произвольной точности.
+class ASYNCPGLIB SqlDecimal
+{
+public:
+    /// Конструктор класса по умолчанию (ноль)
+    SqlDecimal() = default;
+
+    /// Конструктор класса
+    /// @param unscaled Коэффициент десятичного числа
+    /// @param scale Количество цифр после точки (отрицательное - степень 10 множителя)
+    explicit SqlDecimal(int64_t unscaled, int16_t scale = 0);
+
+    /// Создаёт десятичное число из строки
+    /// @param str Строка вида [-]digits[.digits][e[-]digits], NaN, Infinity или -Infinity;
+    ///            пробельные символы по краям и регистр слов не учитываются
+    /// @return Десятичное число или std::nullopt, если строка некорректна
+    static std::optional<SqlDecimal> fromString(std::string_view str);
+
+    /// Создаёт десятичное число из двоичного значения NUMERIC
+    /// @param data Двоичное значение NUMERIC
+    /// @param length Длина двоичного значения NUMERIC
+    /// @return Десятичное число
+    static SqlDecimal fromPg(const char *data, int length);
+
+    /// Возвращает текстовое представление десятичного числа
+    /// @return Текстовое представление десятичного числа
+    std::string toString() const;
+
+    /// Записывает текстовое представление десятичного числа
+    /// @param first Начало буфера
+    /// @param last Конец буфера
+    /// @return Указатель на конец записанного текста или nullptr, если буфер мал
+    char *toChars(char *first, char *last) const;
+
+    /// Возвращает размер двоичного значения NUMERIC
+    /// @return Размер двоичного значения NUMERIC
+    std::size_t pgSize() const;
+
+    /// Записывает двоичное значение NUMERIC
+    /// @param out Буфер размером не менее pgSize()
+    void toPg(char *out) const;
+
+    /// Возвращает коэффициент десятичного числа, если он помещается в 64 бита
+    /// @param unscaled Коэффициент десятичного числа
+    /// @return Результат операции
+    bool toUnscaled(int64_t &unscaled) const;
+
+    /// Возвращает количество цифр после точки
+    /// @return Количество цифр после точки
+    int16_t scale() const;
+
+    /// Проверяет является ли число отрицательным
+    /// @return Результат проверки
+    bool isNegative() const;
+
+    /// Проверяет является ли значение не числом
+    /// @return Результат проверки
+    bool isNaN() const;
+
+    /// Проверяет является ли значение бесконечностью
+    /// @return Результат проверки
+    bool isInfinity() const;
+
+    /// Проверяет хранится ли число в виде 128-битного коэффициента
+    /// @return Результат проверки
+    bool isFixed() const;
+
+private:
+    uint32_t                            _coef[4] = {};
+    int16_t                             _scale = 0;
+    uint8_t                             _flags = 0;
+    std::shared_ptr<const std::string>  _text;
+};
+
+/// Возвращает максимальный размер текстового представления двоичного значения NUMERIC
+/// @param data Двоичное значение NUMERIC
+/// @param length Длина двоичного значения NUMERIC
+/// @return Максимальный размер текстового представления
+ASYNCPGLIB std::size_t numericTextSize(const char *data, int length);
+
+/// Записывает текстовое представление двоичного значения NUMERIC
+/// @param data Двоичное значение NUMERIC
+/// @param length Длина двоичного значения NUMERIC
+/// @param out Буфер размером не менее numericTextSize()
+/// @return Указатель на конец записанного текста
+ASYNCPGLIB char *numericToChars(const char *data, int length, char *out);
+
+/// Возвращает размер двоичного значения NUMERIC для текстового представления
+/// @param str Текстовое представление десятичного числа
+/// @return Размер двоичного значения NUMERIC (0 - строка некорректна)
+ASYNCPGLIB std::size_t numericPgSize(std::string_view str);
+
+/// Записывает двоичное значение NUMERIC для текстового представления
+/// @param str Текстовое представление десятичного числа
+/// @param out Буфер размером не менее numericPgSize()
+ASYNCPGLIB void numericToPg(std::string_view str, char *out);
+
+}
@@ -0,0 +1,198 @@
+﻿#include "SqlDecode.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace AsyncPg {
+
+/// Минимальное количество строк, декодируемых одним потоком
+static constexpr int MinRowsPerThread = 4096;
+
+static void decodeRows(const SqlResult &result, SqlLayout layout, SqlTable &table, int beg, int end)
+{
+    const auto columns = result.columns();
+    for (auto row = beg; row < end; ++row) {
+        for (auto col = 0; col < columns; ++col) {
+            if (layout == SqlLayout::Rows)
+                table[row][col] = result.value(row, col);
+            else
+                table[col][row] = result.value(row, col);
+        }
+    }
+}
+
+/// Пул потоков декодирования
+///
+/// Потоки создаются по мере необходимости и используются всеми вызовами
+/// decodeResult() и decodeCells() повторно, до завершения программы.
+class DecodePool
+{
+public:
+    ~DecodePool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _isStopped = true;
+        }
+        _wakeup.notify_all();
+        for (auto &thread : _threads)
+            thread.join();
+    }
+
+    /// Добавляет задачи в очередь, при необходимости добавляя потоки до count
+    void post(std::vector<std::function<void()>> &tasks, std::size_t count)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            for (auto &task : tasks)
+                _queue.push_back(std::move(task));
+            while (_threads.size() < count)
+                _threads.emplace_back(&DecodePool::run, this);
+        }
+        _wakeup.notify_all();
+    }
+
+private:
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        for (;;) {
+            _wakeup.wait(lock, [this]() { return _isStopped || !_queue.empty(); });
+            if (_isStopped)
+                return;
+
+            auto task = std::move(_queue.front());
+            _queue.pop_front();
+            lock.unlock();
+
+            task();
+            lock.lock();
+        }
+    }
+
+    std::mutex                              _mutex;
+    std::condition_variable                 _wakeup;
+    std::deque<std::function<void()>>       _queue;
+    std::vector<std::thread>                _threads;
+    bool                                    _isStopped = false;
+};
+
+static DecodePool &decodePool()
+{
+    static DecodePool pool;
+    return pool;
+}
+
+/// Разделяет строки результата между потоками пула и ожидает их завершения
+///
+/// Первую часть строк декодирует вызывающий поток, исключение любой части
+/// передаётся вызывающему потоку.
+template<class Func>
+static void parallelRows(int rows, unsigned int threads, Func func)
+{
+    if (threads == 0)
+        threads = std::max(std::thread::hardware_concurrency(), 1U);
+    threads = std::min(threads, static_cast<unsigned int>(rows / MinRowsPerThread + 1));
+
+    const auto step = static_cast<int>((rows + threads - 1) / threads);
+    if (threads == 1) {
+        func(0, rows);
+        return;
+    }
+
+    std::mutex mutex;
+    std::condition_variable finished;
+    auto pending = threads - 1;
+    std::exception_ptr error;
+
+    std::vector<std::function<void()>> tasks;
+    tasks.reserve(threads - 1);
+    for (unsigned int i = 1; i < threads; ++i) {
+        auto beg = std::min(static_cast<int>(i) * step, rows);
+        auto end = std::min(beg + step, rows);
+        tasks.emplace_back([&, beg, end]() {
+            std::exception_ptr taskError;
+            try {
+                func(beg, end);
+            } catch (...) {
+                taskError = std::current_exception();
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            if (taskError && !error)
+                error = taskError;
+            if (--pending == 0)
+                finished.notify_one();
+        });
+    }
+    decodePool().post(tasks, threads - 1);
+
+    std::exception_ptr ownError;
+    try {
+        func(0, std::min(step, rows));
+    } catch (...) {
+        ownError = std::current_exception();
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [&pending]() { return pending == 0; });
+    if (ownError)
+        std::rethrow_exception(ownError);
+    if (error)
+        std::rethrow_exception(error);
+}
+
+SqlTable decodeResult(const SqlResult &result, SqlLayout layout, unsigned int threads)
+{
+    const auto rows = result.rows();
+    const auto columns = result.columns();
+
+    SqlTable table(layout == SqlLayout::Rows ? rows : columns);
+    for (auto &line : table)
+        line.resize(layout == SqlLayout::Rows ? columns : rows);
+
+    parallelRows(rows, threads, [&result, layout, &table](int beg, int end) {
+        decodeRows(result, layout, table, beg, end);
+    });
+
+    return table;
+}
+
+SqlCells decodeCells(const SqlResult &result, unsigned int threads)
+{
+    const auto columns = result.columns();
+    SqlCells cells(static_cast<std::size_t>(result.rows()) * columns);
+
+    parallelRows(result.rows(), threads, [&result, columns, &cells](int beg, int end) {
+        for (auto row = beg; row < end; ++row) {
+            for (auto col = 0; col < columns; ++col)
+                cells[static_cast<std::size_t>(row) * columns + col] = result.cell(row, col);
+        }
+    });
+
+    return cells;
+}
+
+SqlPmrCells decodeCells(
+    const SqlResult &result, std::pmr::memory_resource *resource, unsigned int threads)
+{
+    const auto columns = result.columns();
+    SqlPmrCells cells(static_cast<std::size_t>(result.rows()) * columns, resource);
+
+    parallelRows(result.rows(), threads, [&result, columns, &cells, resource](int beg, int end) {
+        for (auto row = beg; row < end; ++row) {
+            for (auto col = 0; col < columns; ++col) {
+                cells[static_cast<std::size_t>(row) * columns + col] =
+                    result.cell(row, col, resource);
+            }
+        }
+    });
+
+    return cells;
+}
+
+}
@@ -0,0 +1,59 @@
+﻿#pragma once
+
+#include "global.h"
+
+#include "SqlResult.h"
+#include "SqlValue.h"
+
+#include <memory_resource>
+#include <vector>
+
+namespace AsyncPg {
+
+/// Раскладка декодированного результата Sql запроса
+enum class SqlLayout {
+    Rows,    ///< Значения сгруппированы по строкам
+    Columns, ///< Значения сгруппированы по колонкам
+};
+
+/// Декодированный результат Sql запроса
+using SqlTable = std::vector<std::vector<SqlValue>>;
+
+/// Декодированный результат Sql запроса в компактном виде (значения упакованы по строкам)
+using SqlCells = std::vector<SqlCell>;
+
+/// Декодированный результат Sql запроса в компактном виде, размещённый в ресурсе памяти
+using SqlPmrCells = std::pmr::vector<SqlCell>;
+
+/// Декодирует результат Sql запроса, разделяя строки между потоками
+///
+/// Потоки берутся из общего пула декодирования и используются повторно, первую часть
+/// строк декодирует вызывающий поток.
+/// @param result Результат Sql запроса
+/// @param layout Раскладка декодированного результата
+/// @param threads Количество потоков (0 - по числу ядер процессора)
+/// @return Декодированный результат Sql запроса
+ASYNCPGLIB SqlTable decodeResult(
+    const SqlResult &result, SqlLayout layout = SqlLayout::Rows, unsigned int threads = 0);
+
+/// Декодирует результат Sql запроса в компактные значения, разделяя строки между потоками
+/// @param result Результат Sql запроса
+/// @param threads Количество потоков (0 - по числу ядер процессора)
+/// @return Декодированный результат Sql запроса, значение поля находится
+///         по индексу row * columns + column
+ASYNCPGLIB SqlCells decodeCells(const SqlResult &result, unsigned int threads = 0);
+
+/// Декодирует результат Sql запроса в компактные значения, размещая их в ресурсе памяти
+///
+/// Значения и длинные строки размещаются в заданном ресурсе памяти, например в
+/// std::pmr::monotonic_buffer_resource, что позволяет освободить память запроса целиком.
+/// @param result Результат Sql запроса
+/// @param resource Ресурс памяти (при нескольких потоках должен быть потокобезопасным,
+///                 например std::pmr::synchronized_pool_resource)
+/// @param threads Количество потоков (0 - по числу ядер процессора)
+/// @return Декодированный результат Sql запроса, значение поля находится
+///         по индексу row * columns + column
+ASYNCPGLIB SqlPmrCells decodeCells(
+    const SqlResult &result, std::pmr::memory_resource *resource, unsigned int threads = 1);
+
+}
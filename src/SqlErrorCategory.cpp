@@ -31,6 +31,10 @@ std::string ErrorCategory::message(int ev) const
         return "Preparation sql query failed.";
     case ErrorCode::CancelFailed:
         return "Can't stop current query.";
+    case ErrorCode::MemoryLimitExceeded:
+        return "Memory limit exceeded.";
+    case ErrorCode::QueueOverflow:
+        return "Command queue overflow.";
     default:
         return "(unrecognized error)";
     }
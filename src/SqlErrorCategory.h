@@ -8,11 +8,13 @@ namespace std { template<> struct is_error_code_enum<AsyncPg::ErrorCode>: true_t
 namespace AsyncPg {
 
 enum class ErrorCode {
-    Ok                = 0,
-    ConnectionFailed  = 1,
-    ExecutionFailed   = 2,
-    PreparationFailed = 3,
-    CancelFailed      = 4,
+    Ok                  = 0,
+    ConnectionFailed    = 1,
+    ExecutionFailed     = 2,
+    PreparationFailed   = 3,
+    CancelFailed        = 4,
+    MemoryLimitExceeded = 5,
+    QueueOverflow       = 6,
 };
 
 std::error_code make_error_code(AsyncPg::ErrorCode e);
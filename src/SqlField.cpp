@@ -28,7 +28,17 @@ SqlField SqlField::operator*() const
 
 SqlValue SqlField::value() const
 {
-    return asSqlValue(this->record().result().pgresult(), this->row(), this->column());
+    return this->record().result().value(this->row(), this->column());
+}
+
+SqlValue SqlField::value(SqlType type) const
+{
+    return this->record().result().value(this->row(), this->column(), type);
+}
+
+std::string_view SqlField::jsonb() const
+{
+    return this->record().result().jsonb(this->row(), this->column());
 }
 
 int SqlField::rows() const
@@ -33,6 +33,11 @@ public:
     /// @return Значение поля строки результата Sql запроса
     SqlValue value() const;
 
+    /// Возвращает значение поля строки результата Sql запроса
+    /// @param type Желаемый тип поля строки результата Sql запроса
+    /// @return Значение поля строки результата Sql запроса
+    SqlValue value(SqlType type) const;
+
     /// Возвращает значение поля строки результата Sql запроса
     /// @param I Тип поля строки результата Sql запроса
     /// @return Значение поля строки результата Sql запроса
@@ -40,12 +45,16 @@ public:
     std::variant_alternative_t<I, SqlValue>
     value() const
     {
-        auto value = this->value();
+        auto value = this->value(static_cast<SqlType>(I));
         if (auto *result = std::get_if<I>(&value))
             return *result;
         return std::nullopt;
     }
 
+    /// Возвращает JSON значения поля jsonb или json без копирования
+    /// @return JSON значения поля (пустая строка - NULL)
+    std::string_view jsonb() const;
+
     /// Возвращает количество строк в результате Sql запроса
     /// @return Количество строк
     int rows() const;
@@ -0,0 +1,172 @@
+﻿#include "SqlHedge.h"
+
+#include <event2/event.h>
+
+#include <algorithm>
+
+namespace AsyncPg {
+
+/// Состояние запроса с повторной отправкой
+struct SqlHedging
+{
+    static constexpr std::size_t Attempts = 2;
+
+    std::string_view                       sql;
+    std::vector<SqlValue>                  params;
+    SqlConnect::Callback                   func;
+    std::chrono::steady_clock::time_point  sentAt;
+    struct event                          *timer = nullptr;
+    std::size_t                            hosts[Attempts] = {};
+    bool                                   isLaunched[Attempts] = {};
+    uint64_t                               commands[Attempts] = {};
+    bool                                   isFinished[Attempts] = {};
+    std::size_t                            active = 0;
+    bool                                   isDone = false;
+};
+
+/// Аргумент таймера повторной отправки
+struct HedgeTimer
+{
+    SqlHedge                     *hedge;
+    std::shared_ptr<SqlHedging>   state;
+};
+
+static void ev_hedging(evutil_socket_t /*fd*/, short /*what*/, void *arg)
+{
+    auto *timer = reinterpret_cast<HedgeTimer *>(arg);
+    auto *hedge = timer->hedge;
+    auto state = std::move(timer->state);
+    delete timer;
+
+    event_free(state->timer);
+    state->timer = nullptr;
+    hedge->hedging(state);
+}
+
+/// Останавливает таймер повторной отправки
+static void stopTimer(SqlHedging &state)
+{
+    if (!state.timer)
+        return;
+    delete reinterpret_cast<HedgeTimer *>(event_get_callback_arg(state.timer));
+    event_free(state.timer);
+    state.timer = nullptr;
+}
+
+SqlHedge::SqlHedge(SqlBalancer &balancer, event_base *evbase, SqlHedgeOptions options)
+    : _balancer(balancer)
+    , _evbase(evbase)
+    , _options(options)
+{
+    _samples.reserve(_options.window);
+}
+
+bool SqlHedge::execute(std::string_view sql, std::vector<SqlValue> params, Callback func)
+{
+    const auto index = _balancer.select();
+    if (index >= _balancer.size())
+        return false;
+
+    auto state = std::make_shared<SqlHedging>();
+    state->sql = sql;
+    state->params = std::move(params);
+    state->func = std::move(func);
+    state->sentAt = std::chrono::steady_clock::now();
+
+    const auto timeout = delay();
+    timeval tv;
+    tv.tv_sec = static_cast<long>(timeout.count() / 1000000);
+    tv.tv_usec = static_cast<long>(timeout.count() % 1000000);
+    auto *timer = new HedgeTimer{this, state};
+    state->timer = evtimer_new(_evbase, ev_hedging, timer);
+    evtimer_add(state->timer, &tv);
+
+    launch(state, 0, index);
+    return true;
+}
+
+void SqlHedge::hedging(const std::shared_ptr<SqlHedging> &state)
+{
+    if (state->isDone)
+        return;
+
+    // Повторный запрос отправляется только на свободное соединение,
+    // чтобы его выполнение и прерывание не затрагивали чужие запросы
+    const auto first = state->hosts[0];
+    const auto index = _balancer.select([this, first](std::size_t i) {
+        return i != first && _balancer.connect(i)->inFlight() == 0;
+    });
+    if (index < _balancer.size())
+        launch(state, 1, index);
+}
+
+void SqlHedge::launch(const std::shared_ptr<SqlHedging> &state, std::size_t slot,
+                      std::size_t index)
+{
+    auto *connect = _balancer.connect(index);
+    state->hosts[slot] = index;
+    state->isLaunched[slot] = true;
+    ++state->active;
+
+    connect->execute(state->sql, state->params);
+    state->commands[slot] = connect->lastCommand();
+    connect->post([this, state, slot](SqlConnect *self) {
+        finish(state, slot, self);
+    });
+}
+
+void SqlHedge::finish(const std::shared_ptr<SqlHedging> &state, std::size_t slot,
+                      SqlConnect *connect)
+{
+    state->isFinished[slot] = true;
+    --state->active;
+    if (state->isDone)
+        return;
+
+    // Ошибка возвращается после завершения всех попыток
+    if (connect->error() && state->active != 0)
+        return;
+
+    state->isDone = true;
+    stopTimer(*state);
+    if (!connect->error()) {
+        addSample(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - state->sentAt));
+    }
+
+    // Проигравший запрос прерывается, только пока он выполняется соединением
+    for (std::size_t i = 0; i < SqlHedging::Attempts; ++i) {
+        if (i != slot && state->isLaunched[i] && !state->isFinished[i])
+            _balancer.connect(state->hosts[i])->interrupt(state->commands[i]);
+    }
+
+    state->func(connect);
+}
+
+std::chrono::microseconds SqlHedge::delay() const
+{
+    if (_samples.size() < std::max<std::size_t>(_options.minSamples, 1))
+        return _options.initialDelay;
+
+    auto samples = _samples;
+    const auto rank = static_cast<std::size_t>(
+        _options.percentile * static_cast<double>(samples.size() - 1));
+    auto nth = samples.begin() + static_cast<std::ptrdiff_t>(std::min(rank, samples.size() - 1));
+    std::nth_element(samples.begin(), nth, samples.end());
+    return std::max(*nth, _options.minDelay);
+}
+
+void SqlHedge::addSample(std::chrono::microseconds sample)
+{
+    if (_options.window == 0)
+        return;
+
+    if (_samples.size() < _options.window) {
+        _samples.push_back(sample);
+    } else {
+        _samples[_nextSample] = sample;
+        _nextSample = (_nextSample + 1) % _options.window;
+    }
+}
+
+}
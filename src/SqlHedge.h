@@ -0,0 +1,109 @@
+﻿#pragma once
+
+#include "global.h"
+
+#include "SqlBalancer.h"
+#include "SqlConnect.h"
+#include "SqlValue.h"
+
+#include <chrono>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+struct event_base;
+
+namespace AsyncPg {
+
+struct SqlHedging;
+
+/// Параметры повторной отправки запросов
+struct SqlHedgeOptions
+{
+    /// Запрос повторяется, если он выполняется дольше заданного перцентиля
+    /// времени выполнения последних запросов
+    double percentile = 0.95;
+
+    /// Задержка повторной отправки до накопления minSamples измерений
+    std::chrono::microseconds initialDelay{50000};
+
+    /// Минимальная задержка повторной отправки
+    std::chrono::microseconds minDelay{1000};
+
+    /// Количество учитываемых последних измерений
+    std::size_t window = 256;
+
+    /// Количество измерений, необходимое для расчёта перцентиля
+    std::size_t minSamples = 20;
+};
+
+/// Повторная отправка идемпотентных запросов на чтение
+///
+/// Запрос отправляется на соединение, выбранное балансировщиком. Если он не завершился
+/// за время, равное заданному перцентилю времени выполнения последних запросов, тот же
+/// запрос отправляется на другое свободное соединение. Обработчик получает первый
+/// успешный результат. Проигравший запрос прерывается без блокировки цикла событий,
+/// если он ещё выполняется и за ним в очереди соединения нет других запросов.
+/// Ошибка возвращается, только если завершились с ошибкой все отправленные запросы.
+/// Функции обратного вызова ссылаются на объект, поэтому он должен существовать
+/// до завершения запросов.
+class ASYNCPGLIB SqlHedge
+{
+public:
+    /// Функция обратного вызова
+    using Callback = SqlConnect::Callback;
+
+    /// Конструктор класса
+    /// @param balancer Балансировщик соединений
+    /// @param evbase Сервис ввода-вывода
+    /// @param options Параметры повторной отправки запросов
+    SqlHedge(SqlBalancer &balancer, struct event_base *evbase, SqlHedgeOptions options = {});
+
+    /// Конструктор копирования
+    SqlHedge(const SqlHedge &) = delete;
+
+    /// Оператор копирования
+    void operator=(const SqlHedge &) = delete;
+
+    /// Выполняет запрос к базе данных
+    ///
+    /// Текст запроса должен существовать до выполнения запроса.
+    /// @param sql Запрос к базе данных
+    /// @param params Параметры запроса
+    /// @param func Обработчик результата, получающий соединение с результатом
+    /// @return Отправлен ли запрос (false - нет доступных соединений)
+    bool execute(std::string_view sql, std::vector<SqlValue> params, Callback func);
+
+    /// Возвращает текущую задержку повторной отправки
+    /// @return Задержка повторной отправки
+    std::chrono::microseconds delay() const;
+
+    /// Производит повторную отправку запроса
+    /// @param state Состояние запроса
+    void hedging(const std::shared_ptr<SqlHedging> &state);
+
+private:
+    /// Отправляет попытку выполнения запроса
+    /// @param state Состояние запроса
+    /// @param slot Номер попытки
+    /// @param index Номер соединения балансировщика
+    void launch(const std::shared_ptr<SqlHedging> &state, std::size_t slot, std::size_t index);
+
+    /// Обрабатывает завершение попытки выполнения запроса
+    /// @param state Состояние запроса
+    /// @param slot Номер попытки
+    /// @param connect Соединение с результатом попытки
+    void finish(const std::shared_ptr<SqlHedging> &state, std::size_t slot, SqlConnect *connect);
+
+    /// Учитывает время выполнения запроса
+    /// @param sample Время выполнения запроса
+    void addSample(std::chrono::microseconds sample);
+
+    SqlBalancer                            &_balancer;
+    struct event_base                      *_evbase = nullptr;
+    SqlHedgeOptions                         _options;
+    std::vector<std::chrono::microseconds>  _samples;
+    std::size_t                             _nextSample = 0;
+};
+
+}
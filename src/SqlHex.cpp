@@ -0,0 +1,213 @@
+﻿#include "SqlHex.h"
+#include "SqlOid.h"
+#include "SqlResult.h"
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define ASYNCPG_SSE2
+#endif
+
+namespace AsyncPg {
+
+/// Таблица пар шестнадцатеричных цифр для каждого байта
+static constexpr std::array<char, 512> makeHexPairs()
+{
+    constexpr char digits[] = "0123456789abcdef";
+    std::array<char, 512> pairs{};
+    for (std::size_t i = 0; i < 256; ++i) {
+        pairs[i * 2] = digits[i >> 4];
+        pairs[i * 2 + 1] = digits[i & 0xF];
+    }
+    return pairs;
+}
+
+/// Таблица значений шестнадцатеричных цифр (-1 - не цифра)
+static constexpr std::array<int8_t, 256> makeHexValues()
+{
+    std::array<int8_t, 256> values{};
+    for (std::size_t i = 0; i < 256; ++i) {
+        if (i >= '0' && i <= '9')
+            values[i] = static_cast<int8_t>(i - '0');
+        else if (i >= 'a' && i <= 'f')
+            values[i] = static_cast<int8_t>(i - 'a' + 10);
+        else if (i >= 'A' && i <= 'F')
+            values[i] = static_cast<int8_t>(i - 'A' + 10);
+        else
+            values[i] = -1;
+    }
+    return values;
+}
+
+static constexpr auto HexPairs = makeHexPairs();
+static constexpr auto HexValues = makeHexValues();
+
+#ifdef ASYNCPG_SSE2
+/// Преобразует 16 байт в 32 шестнадцатеричные цифры
+static void encode16(const char *data, char *out)
+{
+    const auto mask = _mm_set1_epi8(0x0F);
+    const auto nine = _mm_set1_epi8(9);
+    const auto zero = _mm_set1_epi8('0');
+    const auto alpha = _mm_set1_epi8('a' - '0' - 10);
+
+    auto bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data));
+    auto hi = _mm_and_si128(_mm_srli_epi16(bytes, 4), mask);
+    auto lo = _mm_and_si128(bytes, mask);
+
+    // Цифре больше 9 добавляется смещение до 'a'
+    hi = _mm_add_epi8(_mm_add_epi8(hi, zero), _mm_and_si128(_mm_cmpgt_epi8(hi, nine), alpha));
+    lo = _mm_add_epi8(_mm_add_epi8(lo, zero), _mm_and_si128(_mm_cmpgt_epi8(lo, nine), alpha));
+
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out), _mm_unpacklo_epi8(hi, lo));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 16), _mm_unpackhi_epi8(hi, lo));
+}
+
+/// Преобразует 16 шестнадцатеричных цифр в значения
+/// @return Маска корректных цифр
+static int digits16(const char *text, __m128i &values)
+{
+    const auto nine = _mm_set1_epi8(9);
+    const auto five = _mm_set1_epi8(5);
+    const auto ten = _mm_set1_epi8(10);
+
+    auto chars = _mm_loadu_si128(reinterpret_cast<const __m128i *>(text));
+    auto digit = _mm_sub_epi8(chars, _mm_set1_epi8('0'));
+    auto alpha = _mm_sub_epi8(_mm_or_si128(chars, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+
+    // Беззнаковое сравнение x <= n как max(x, n) == n
+    auto isDigit = _mm_cmpeq_epi8(_mm_max_epu8(digit, nine), nine);
+    auto isAlpha = _mm_cmpeq_epi8(_mm_max_epu8(alpha, five), five);
+
+    values = _mm_or_si128(_mm_and_si128(isDigit, digit),
+                          _mm_and_si128(isAlpha, _mm_add_epi8(alpha, ten)));
+    return _mm_movemask_epi8(_mm_or_si128(isDigit, isAlpha));
+}
+
+/// Преобразует 32 шестнадцатеричные цифры в 16 байт
+static bool decode16(const char *text, char *out)
+{
+    __m128i first;
+    __m128i second;
+    if ((digits16(text, first) & digits16(text + 16, second)) != 0xFFFF)
+        return false;
+
+    const auto low = _mm_set1_epi16(0x00FF);
+    auto pack = [&low](__m128i values) {
+        return _mm_or_si128(_mm_slli_epi16(_mm_and_si128(values, low), 4), _mm_srli_epi16(values, 8));
+    };
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out), _mm_packus_epi16(pack(first), pack(second)));
+    return true;
+}
+#endif
+
+char *hexEncode(const char *data, std::size_t size, char *out)
+{
+    std::size_t pos = 0;
+#ifdef ASYNCPG_SSE2
+    for (; pos + 16 <= size; pos += 16, out += 32)
+        encode16(data + pos, out);
+#endif
+    for (; pos < size; ++pos, out += 2)
+        std::memcpy(out, &HexPairs[static_cast<uint8_t>(data[pos]) * 2], 2);
+    return out;
+}
+
+bool hexDecode(const char *text, std::size_t size, char *out)
+{
+    if (size % 2 != 0)
+        return false;
+
+    std::size_t pos = 0;
+#ifdef ASYNCPG_SSE2
+    for (; pos + 32 <= size; pos += 32, out += 16) {
+        if (!decode16(text + pos, out))
+            return false;
+    }
+#endif
+    for (; pos < size; pos += 2) {
+        auto hi = HexValues[static_cast<uint8_t>(text[pos])];
+        auto lo = HexValues[static_cast<uint8_t>(text[pos + 1])];
+        if (hi < 0 || lo < 0)
+            return false;
+        *out++ = static_cast<char>((hi << 4) | lo);
+    }
+    return true;
+}
+
+char *uuidToChars(const char *uuid, char *out)
+{
+    char hex[32];
+    hexEncode(uuid, 16, hex);
+
+    std::memcpy(out, hex, 8);
+    out[8] = '-';
+    std::memcpy(out + 9, hex + 8, 4);
+    out[13] = '-';
+    std::memcpy(out + 14, hex + 12, 4);
+    out[18] = '-';
+    std::memcpy(out + 19, hex + 16, 4);
+    out[23] = '-';
+    std::memcpy(out + 24, hex + 20, 12);
+    return out + UuidTextSize;
+}
+
+char *uuidsToChars(const char *uuids, std::size_t count, char *out)
+{
+    for (std::size_t i = 0; i < count; ++i)
+        out = uuidToChars(uuids + i * 16, out);
+    return out;
+}
+
+char *uuidColumnToChars(const SqlResult &result, int column, char *out)
+{
+    const bool uuid = result.type(column) == UUIDOID;
+    for (int row = 0, rows = result.rows(); row < rows; ++row) {
+        if (!uuid || result.isNull(row, column) || result.length(row, column) != 16) {
+            std::memset(out, 0, UuidTextSize);
+            out += UuidTextSize;
+        } else {
+            out = uuidToChars(result.data(row, column), out);
+        }
+    }
+    return out;
+}
+
+bool uuidFromChars(std::string_view text, char *uuid)
+{
+    if ((text.size() == 38 || text.size() == 34) && text.front() == '{' && text.back() == '}')
+        text = text.substr(1, text.size() - 2);
+
+    if (text.size() == 32)
+        return hexDecode(text.data(), 32, uuid);
+
+    if (text.size() != UuidTextSize || text[8] != '-' || text[13] != '-'
+        || text[18] != '-' || text[23] != '-') {
+        return false;
+    }
+
+    char hex[32];
+    std::memcpy(hex, text.data(), 8);
+    std::memcpy(hex + 8, text.data() + 9, 4);
+    std::memcpy(hex + 12, text.data() + 14, 4);
+    std::memcpy(hex + 16, text.data() + 19, 4);
+    std::memcpy(hex + 20, text.data() + 24, 12);
+    return hexDecode(hex, 32, uuid);
+}
+
+std::size_t uuidsFromChars(const std::string_view *texts, std::size_t count, char *uuids)
+{
+    std::size_t valid = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        if (uuidFromChars(texts[i], uuids + i * 16))
+            ++valid;
+        else
+            std::memset(uuids + i * 16, 0, 16);
+    }
+    return valid;
+}
+
+}
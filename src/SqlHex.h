@@ -0,0 +1,63 @@
+﻿#pragma once
+
+#include "global.h"
+
+#include <cstddef>
+#include <string_view>
+
+namespace AsyncPg {
+
+class SqlResult;
+
+/// Размер канонического текстового представления UUID
+constexpr std::size_t UuidTextSize = 36;
+
+/// Записывает шестнадцатеричное представление байт
+/// @param data Байты
+/// @param size Количество байт
+/// @param out Буфер размером не менее 2 * size
+/// @return Указатель на конец записанного текста
+ASYNCPGLIB char *hexEncode(const char *data, std::size_t size, char *out);
+
+/// Разбирает шестнадцатеричное представление байт
+/// @param text Шестнадцатеричный текст (цифры в любом регистре)
+/// @param size Длина текста (чётная)
+/// @param out Буфер размером не менее size / 2
+/// @return Результат операции
+ASYNCPGLIB bool hexDecode(const char *text, std::size_t size, char *out);
+
+/// Записывает каноническое текстовое представление UUID
+/// @param uuid UUID (16 байт)
+/// @param out Буфер размером не менее UuidTextSize
+/// @return Указатель на конец записанного текста
+ASYNCPGLIB char *uuidToChars(const char *uuid, char *out);
+
+/// Записывает канонические текстовые представления последовательности UUID
+/// @param uuids UUID, расположенные подряд (16 * count байт)
+/// @param count Количество UUID
+/// @param out Буфер размером не менее UuidTextSize * count
+/// @return Указатель на конец записанного текста
+ASYNCPGLIB char *uuidsToChars(const char *uuids, std::size_t count, char *out);
+
+/// Записывает канонические текстовые представления колонки UUID результата Sql запроса
+/// @param result Результат Sql запроса
+/// @param column Номер колонки
+/// @param out Буфер размером не менее UuidTextSize * result.rows()
+///            (значения NULL записываются нулевыми символами)
+/// @return Указатель на конец записанного текста
+ASYNCPGLIB char *uuidColumnToChars(const SqlResult &result, int column, char *out);
+
+/// Разбирает текстовое представление UUID
+/// @param text UUID в каноническом виде, без дефисов или в фигурных скобках
+/// @param uuid Буфер размером не менее 16 байт
+/// @return Результат операции
+ASYNCPGLIB bool uuidFromChars(std::string_view text, char *uuid);
+
+/// Разбирает последовательность текстовых представлений UUID
+/// @param texts Текстовые представления UUID
+/// @param count Количество UUID
+/// @param uuids Буфер размером не менее 16 * count байт (некорректные UUID заполняются нулями)
+/// @return Количество корректных UUID
+ASYNCPGLIB std::size_t uuidsFromChars(const std::string_view *texts, std::size_t count, char *uuids);
+
+}
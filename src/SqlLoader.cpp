@@ -0,0 +1,189 @@
+﻿#include "SqlLoader.h"
+#include "SqlArray.h"
+#include "SqlConnect.h"
+#include "SqlOid.h"
+
+#include <event2/event.h>
+
+#include <unordered_map>
+
+namespace AsyncPg {
+
+/// Ключи пакета с обработчиками
+using LoadWaiters = std::unordered_map<std::string, std::vector<SqlLoader::Callback>>;
+
+static void ev_loading(evutil_socket_t /*fd*/, short /*what*/, void *arg)
+{
+    auto *loader = reinterpret_cast<SqlLoader *>(arg);
+    loader->flush();
+}
+
+static void appendInt32(std::string &out, uint32_t value)
+{
+    char bytes[4];
+    writeBigEndian(bytes, value);
+    out.append(bytes, sizeof(bytes));
+}
+
+SqlLoader::SqlLoader(SqlConnect &connect, std::string_view sql, event_base *evbase,
+                     SqlLoaderOptions options)
+    : _connect(connect)
+    , _sql(sql)
+    , _options(options)
+{
+    if (evbase)
+        _timer = evtimer_new(evbase, ev_loading, this);
+}
+
+SqlLoader::~SqlLoader()
+{
+    if (_timer)
+        event_free(_timer);
+}
+
+void SqlLoader::load(const SqlValue &key, Callback func)
+{
+    Pending pending;
+    pending.func = std::move(func);
+    bool isValid = true;
+    if (auto param = asPgParam(key)) {
+        pending.oid = param->oid;
+        pending.isNull = param->data == nullptr;
+        if (param->data)
+            pending.bytes.assign(param->data, static_cast<std::size_t>(param->length));
+        // Значения в текстовом формате (jsonb) не являются элементами двоичного массива
+        isValid = param->format == 1;
+    } else {
+        const auto &[oid, length, value] = asPgValue(key);
+        pending.oid = oid;
+        pending.isNull = value == nullptr;
+        if (value)
+            pending.bytes.assign(value, length);
+        delete[] value;
+        isValid = value || isNullValue(key);
+    }
+
+    // Пользовательские типы и массивы не имеют известного типа массива ключей
+    if (!isValid || (!pending.isNull && toPgArrayType(pending.oid) == 0)) {
+        pending.func(SqlError(ErrorCode::ExecutionFailed, "Invalid key value"), nullptr, {});
+        return;
+    }
+    _pending.push_back(std::move(pending));
+
+    if (_pending.size() >= _options.maxBatch || !_timer) {
+        flush();
+    } else if (_pending.size() == 1) {
+        const auto window = _options.window.count();
+        timeval tv;
+        tv.tv_sec = static_cast<long>(window / 1000000);
+        tv.tv_usec = static_cast<long>(window % 1000000);
+        evtimer_add(_timer, &tv);
+    }
+}
+
+void SqlLoader::flush()
+{
+    if (_timer)
+        evtimer_del(_timer);
+    if (_pending.empty())
+        return;
+
+    auto pending = std::move(_pending);
+    _pending.clear();
+
+    // Тип элементов массива определяется первым ключом, отличный от NULL
+    unsigned int elementType = 0;
+    for (const auto &item : pending) {
+        if (!item.isNull) {
+            elementType = item.oid;
+            break;
+        }
+    }
+
+    auto waiters = std::make_shared<LoadWaiters>();
+    std::vector<Callback> empty;
+    std::string keys;
+    int32_t count = 0;
+    for (auto &item : pending) {
+        if (item.isNull) {
+            empty.push_back(std::move(item.func));
+            continue;
+        }
+        if (item.oid != elementType) {
+            item.func(SqlError(ErrorCode::ExecutionFailed, "Key type mismatch"), nullptr, {});
+            continue;
+        }
+
+        auto &funcs = (*waiters)[item.bytes];
+        if (funcs.empty()) {
+            appendInt32(keys, static_cast<uint32_t>(item.bytes.size()));
+            keys += item.bytes;
+            ++count;
+        }
+        funcs.push_back(std::move(item.func));
+    }
+
+    if (count == 0) {
+        for (const auto &func : empty)
+            func(SqlError(), nullptr, {});
+        return;
+    }
+
+    // Одномерный массив без NULL в двоичном формате PostgreSql
+    std::string array;
+    array.reserve(20 + keys.size());
+    appendInt32(array, 1);
+    appendInt32(array, 0);
+    appendInt32(array, elementType);
+    appendInt32(array, static_cast<uint32_t>(count));
+    appendInt32(array, 1);
+    array += keys;
+
+    std::vector<SqlValue> params;
+    params.emplace_back(std::in_place_index<SqlType::Array>,
+                        SqlArray::fromPg(array.data(), static_cast<int>(array.size())));
+
+    const auto keyColumn = _options.keyColumn;
+    _connect.execute(_sql, std::move(params));
+    _connect.post([waiters, empty = std::move(empty), keyColumn](SqlConnect *self) {
+        if (self->error()) {
+            const auto error = self->error();
+            for (const auto &[key, funcs] : *waiters) {
+                for (const auto &func : funcs)
+                    func(error, nullptr, {});
+            }
+            for (const auto &func : empty)
+                func(error, nullptr, {});
+            return;
+        }
+
+        const auto result = self->takeResult();
+        std::unordered_map<std::string_view, std::vector<int>> rows;
+        if (keyColumn < result->columns()) {
+            for (int row = 0, count = result->rows(); row < count; ++row) {
+                if (result->isNull(row, keyColumn))
+                    continue;
+                const std::string_view key(result->data(row, keyColumn),
+                                           static_cast<std::size_t>(result->length(row, keyColumn)));
+                rows[key].push_back(row);
+            }
+        }
+
+        const std::vector<int> none;
+        for (const auto &[key, funcs] : *waiters) {
+            auto it = rows.find(key);
+            const auto &keyRows = it != rows.end() ? it->second : none;
+            for (const auto &func : funcs)
+                func(SqlError(), result, keyRows);
+        }
+        for (const auto &func : empty)
+            func(SqlError(), result, none);
+    });
+}
+
+std::size_t SqlLoader::pending() const
+{
+    return _pending.size();
+}
+
+}
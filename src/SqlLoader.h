@@ -0,0 +1,102 @@
+﻿#pragma once
+
+#include "global.h"
+
+#include "SqlError.h"
+#include "SqlResult.h"
+#include "SqlValue.h"
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct event_base;
+struct event;
+
+namespace AsyncPg {
+
+class SqlConnect;
+
+/// Параметры пакетной загрузки
+struct SqlLoaderOptions
+{
+    /// Время накопления ключей (0 - до следующей итерации цикла событий)
+    std::chrono::microseconds  window{0};
+
+    /// Количество ключей, при котором пакет отправляется сразу
+    std::size_t  maxBatch = 1000;
+
+    /// Номер колонки результата, содержащей ключ
+    int  keyColumn = 0;
+};
+
+/// Пакетная загрузка строк по ключу
+///
+/// Ключи, запрошенные за одну итерацию цикла событий (или за заданное время),
+/// передаются одним запросом вида SELECT ... WHERE id = ANY($1) в параметре-массиве
+/// в двоичном формате. Строки результата распределяются между вызывающими по
+/// совпадению двоичного значения колонки ключа с двоичным значением ключа, поэтому
+/// тип ключа должен совпадать с типом колонки. Одинаковые ключи запрашиваются
+/// один раз. Объект используется в потоке цикла событий и должен существовать
+/// до завершения запросов.
+class ASYNCPGLIB SqlLoader
+{
+public:
+    /// Функция обратного вызова строк ключа
+    ///
+    /// Строки ключа передаются номерами строк разделяемого результата пакета.
+    using Callback = std::function<void(const SqlError &error, const SqlSharedResult &result,
+                                        const std::vector<int> &rows)>;
+
+    /// Конструктор класса
+    /// @param connect Соединение с базой данных
+    /// @param sql Запрос пакета с параметром-массивом ключей $1
+    /// @param evbase Сервис ввода-вывода
+    /// @param options Параметры пакетной загрузки
+    SqlLoader(SqlConnect &connect, std::string_view sql, struct event_base *evbase,
+              SqlLoaderOptions options = {});
+
+    /// Конструктор копирования
+    SqlLoader(const SqlLoader &) = delete;
+
+    /// Оператор копирования
+    void operator=(const SqlLoader &) = delete;
+
+    /// Деструктор класса
+    ~SqlLoader();
+
+    /// Запрашивает строки по ключу
+    ///
+    /// Ключи одного пакета должны иметь один тип, ключ NULL не имеет строк.
+    /// Ключи jsonb, массивы и значения пользовательских типов отклоняются с ошибкой.
+    /// @param key Значение ключа
+    /// @param func Обработчик строк ключа
+    void load(const SqlValue &key, Callback func);
+
+    /// Отправляет накопленные ключи одним запросом
+    void flush();
+
+    /// Возвращает количество накопленных ключей
+    /// @return Количество ключей
+    std::size_t pending() const;
+
+private:
+    /// Ключ, ожидающий отправки
+    struct Pending
+    {
+        unsigned int  oid = 0;       ///< Тип PostgreSql ключа
+        std::string   bytes;         ///< Двоичное значение ключа
+        bool          isNull = false; ///< Ключ равен NULL
+        Callback      func;          ///< Обработчик строк ключа
+    };
+
+    SqlConnect            &_connect;
+    std::string            _sql;
+    struct event          *_timer = nullptr;
+    SqlLoaderOptions       _options;
+    std::vector<Pending>   _pending;
+};
+
+}
@@ -0,0 +1,67 @@
+﻿#include "SqlMemory.h"
+
+#include <atomic>
+
+namespace AsyncPg {
+
+static std::atomic<std::size_t> globalQueued{0};
+static std::atomic<std::size_t> globalResults{0};
+
+SqlMemoryUsage sqlMemoryUsage()
+{
+    SqlMemoryUsage usage;
+    usage.queued = globalQueued.load(std::memory_order_relaxed);
+    usage.results = globalResults.load(std::memory_order_relaxed);
+    return usage;
+}
+
+SqlMemoryCounter::SqlMemoryCounter(SqlMemoryCounter &&other) noexcept
+{
+    _usage = other._usage;
+    other._usage = SqlMemoryUsage();
+}
+
+SqlMemoryCounter &SqlMemoryCounter::operator=(SqlMemoryCounter &&other) noexcept
+{
+    if (this != &other) {
+        removeQueued(_usage.queued);
+        setResults(0);
+        _usage = other._usage;
+        other._usage = SqlMemoryUsage();
+    }
+    return *this;
+}
+
+SqlMemoryCounter::~SqlMemoryCounter()
+{
+    removeQueued(_usage.queued);
+    setResults(0);
+}
+
+void SqlMemoryCounter::addQueued(std::size_t bytes)
+{
+    _usage.queued += bytes;
+    globalQueued.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void SqlMemoryCounter::removeQueued(std::size_t bytes)
+{
+    _usage.queued -= bytes;
+    globalQueued.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+void SqlMemoryCounter::setResults(std::size_t bytes)
+{
+    if (bytes >= _usage.results)
+        globalResults.fetch_add(bytes - _usage.results, std::memory_order_relaxed);
+    else
+        globalResults.fetch_sub(_usage.results - bytes, std::memory_order_relaxed);
+    _usage.results = bytes;
+}
+
+const SqlMemoryUsage &SqlMemoryCounter::usage() const
+{
+    return _usage;
+}
+
+}
@@ -0,0 +1,81 @@
+﻿#pragma once
+
+#include "global.h"
+
+#include <cstddef>
+
+namespace AsyncPg {
+
+/// Использование памяти
+struct SqlMemoryUsage
+{
+    std::size_t  queued = 0;   ///< Данные команд в очереди
+    std::size_t  results = 0;  ///< Результаты запросов
+
+    /// Возвращает общий объём используемой памяти
+    /// @return Объём используемой памяти в байтах
+    std::size_t total() const
+    {
+        return queued + results;
+    }
+};
+
+/// Лимиты памяти соединения (0 - без ограничения)
+struct SqlMemoryLimits
+{
+    std::size_t  soft = 0;  ///< При превышении запросы выполняются в потоковом режиме
+    std::size_t  hard = 0;  ///< При превышении команды и запросы завершаются с ошибкой
+};
+
+/// Возвращает использование памяти всеми соединениями
+/// @return Использование памяти
+ASYNCPGLIB SqlMemoryUsage sqlMemoryUsage();
+
+/// Счётчик использования памяти соединения
+///
+/// Изменения счётчика учитываются в использовании памяти всеми соединениями.
+class ASYNCPGLIB SqlMemoryCounter
+{
+public:
+    /// Конструктор класса по умолчанию
+    SqlMemoryCounter() = default;
+
+    /// Конструктор копирования
+    SqlMemoryCounter(const SqlMemoryCounter &) = delete;
+
+    /// Оператор копирования
+    void operator=(const SqlMemoryCounter &) = delete;
+
+    /// Конструктор перемещения
+    /// @param other Счётчик использования памяти
+    SqlMemoryCounter(SqlMemoryCounter &&other) noexcept;
+
+    /// Оператор перемещения
+    /// @param other Счётчик использования памяти
+    /// @return Счётчик использования памяти
+    SqlMemoryCounter &operator=(SqlMemoryCounter &&other) noexcept;
+
+    /// Деструктор класса
+    ~SqlMemoryCounter();
+
+    /// Учитывает данные команды, добавленной в очередь
+    /// @param bytes Размер данных команды
+    void addQueued(std::size_t bytes);
+
+    /// Учитывает данные команды, извлечённой из очереди
+    /// @param bytes Размер данных команды
+    void removeQueued(std::size_t bytes);
+
+    /// Устанавливает размер результатов запросов
+    /// @param bytes Размер результатов запросов
+    void setResults(std::size_t bytes);
+
+    /// Возвращает использование памяти
+    /// @return Использование памяти
+    const SqlMemoryUsage &usage() const;
+
+private:
+    SqlMemoryUsage  _usage;
+};
+
+}
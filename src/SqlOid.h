@@ -0,0 +1,97 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+/// Типы PostgreSql
+#define BOOLOID 16
+#define CHAROID 18
+#define NAMEOID 19
+#define JSONOID 114
+#define XMLOID 142
+#define VARCHAROID 1043
+#define TEXTOID 25
+#define INT8OID 20
+#define INT2OID 21
+#define INT4OID 23
+#define NUMERICOID 1700
+#define FLOAT4OID 700
+#define FLOAT8OID 701
+#define DATEOID 1082
+#define TIMEOID 1083
+#define TIMETZOID 1266
+#define TIMESTAMPOID 1114
+#define TIMESTAMPTZOID 1184
+#define INTERVALOID 1186
+#define BYTEAOID 17
+#define UUIDOID 2950
+#define JSONBOID 3802
+#define OIDOID 26
+
+/// Типы массивов PostgreSql
+#define BOOLARRAYOID 1000
+#define BYTEAARRAYOID 1001
+#define CHARARRAYOID 1002
+#define NAMEARRAYOID 1003
+#define INT2ARRAYOID 1005
+#define INT4ARRAYOID 1007
+#define TEXTARRAYOID 1009
+#define VARCHARARRAYOID 1015
+#define INT8ARRAYOID 1016
+#define FLOAT4ARRAYOID 1021
+#define FLOAT8ARRAYOID 1022
+#define TIMESTAMPARRAYOID 1115
+#define DATEARRAYOID 1182
+#define TIMEARRAYOID 1183
+#define TIMESTAMPTZARRAYOID 1185
+#define NUMERICARRAYOID 1231
+#define TIMETZARRAYOID 1270
+#define UUIDARRAYOID 2951
+#define JSONARRAYOID 199
+#define XMLARRAYOID 143
+#define JSONBARRAYOID 3807
+
+/// Версия двоичного формата jsonb
+#define JSONB_VERSION 1
+
+/// Режимы открытия большого объекта
+#define INV_WRITE 0x00020000
+#define INV_READ 0x00040000
+
+#define POSTGRES_EPOCH_USEC 946684800000000
+#define POSTGRES_DAY_USEC 86400000000
+
+/// Разница между эпохой PostgreSql и эпохой Unix в днях
+#define POSTGRES_EPOCH_DAYS 10957
+
+namespace AsyncPg {
+
+/// Читает целое число в двоичном формате PostgreSql (big-endian)
+/// @param data Двоичное значение
+/// @return Целое число
+template<class T>
+inline T readBigEndian(const char *data)
+{
+    static_assert(std::is_integral_v<T>, "Big-endian value must be integral");
+    std::make_unsigned_t<T> bits = 0;
+    for (std::size_t i = 0; i < sizeof(T); ++i)
+        bits = static_cast<std::make_unsigned_t<T>>((bits << 8) | static_cast<uint8_t>(data[i]));
+    return static_cast<T>(bits);
+}
+
+/// Записывает целое число в двоичном формате PostgreSql (big-endian)
+/// @param out Буфер размером не менее sizeof(T)
+/// @param value Целое число
+template<class T>
+inline void writeBigEndian(char *out, T value)
+{
+    static_assert(std::is_integral_v<T>, "Big-endian value must be integral");
+    auto bits = static_cast<std::make_unsigned_t<T>>(value);
+    for (std::size_t i = sizeof(T); i-- > 0;) {
+        out[i] = static_cast<char>(bits & 0xFF);
+        bits = static_cast<std::make_unsigned_t<T>>(bits >> 8);
+    }
+}
+
+}
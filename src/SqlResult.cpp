@@ -1,13 +1,33 @@
 ﻿#include "SqlResult.h"
 
+#include "SqlCodec.h"
 #include "SqlRecord.h"
+#include "SqlOid.h"
+#include "SqlText.h"
 
 #include <libpq-fe.h>
 
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
 #include <iostream>
+#include <limits>
+#include <vector>
 
 namespace AsyncPg {
 
+/// Компактное хранилище значений результата Sql запроса
+struct SqlCompact
+{
+    std::vector<char>          data;     ///< Значения полей, упакованные по строкам
+    std::vector<uint32_t>      offsets;  ///< Смещения значений полей в data
+    std::vector<bool>          nulls;    ///< Признаки NULL значений полей
+    std::vector<std::string>   names;    ///< Наименования колонок
+    std::vector<unsigned int>  types;    ///< Типы PostgreSql колонок
+    std::vector<int>           formats;  ///< Форматы значений колонок
+    std::string                command;  ///< Тег команды
+};
+
 SqlResult::SqlResult(PGresult *pgresult)
 {
     _result = pgresult;
@@ -20,19 +40,33 @@ SqlResult::SqlResult(PGresult *pgresult)
 SqlResult::SqlResult(SqlResult &&other) noexcept
 {
     _result = other._result;
+    _compact = std::move(other._compact);
+    _types = std::move(other._types);
     _rows = other._rows;
     _columns = other._columns;
 
     other._result = nullptr;
+    other._rows = 0;
+    other._columns = 0;
 }
 
 SqlResult &SqlResult::operator=(SqlResult &&other) noexcept
 {
+    if (this == &other)
+        return *this;
+
+    if (_result)
+        PQclear(_result);
+
     _result = other._result;
+    _compact = std::move(other._compact);
+    _types = std::move(other._types);
     _rows = other._rows;
     _columns = other._columns;
 
     other._result = nullptr;
+    other._rows = 0;
+    other._columns = 0;
 
     return *this;
 }
@@ -55,14 +89,242 @@ int SqlResult::columns() const
 
 std::string SqlResult::fieldName(int column) const
 {
+    if (_compact)
+        return _compact->names[column];
     return std::string(PQfname(_result, column));
 }
 
 int SqlResult::column(std::string_view fieldName) const
 {
+    if (_compact) {
+        auto &names = _compact->names;
+        auto it = std::find(names.begin(), names.end(), fieldName);
+        return it != names.end() ? static_cast<int>(it - names.begin()) : -1;
+    }
     return PQfnumber(_result, fieldName.data());
 }
 
+unsigned int SqlResult::type(int column) const
+{
+    if (_compact)
+        return _compact->types[column];
+    return PQftype(_result, column);
+}
+
+int SqlResult::format(int column) const
+{
+    if (_compact)
+        return _compact->formats[column];
+    return PQfformat(_result, column);
+}
+
+std::string SqlResult::commandTag() const
+{
+    if (_compact)
+        return _compact->command;
+    return _result ? std::string(PQcmdStatus(_result)) : std::string();
+}
+
+int64_t SqlResult::affectedRows() const
+{
+    // Количество строк - последнее слово тега команды (INSERT 0 5, UPDATE 5, SELECT 5)
+    std::string_view tag;
+    if (_compact)
+        tag = _compact->command;
+    else if (_result)
+        tag = PQcmdTuples(_result);
+    tag = tag.substr(tag.rfind(' ') == std::string_view::npos ? 0 : tag.rfind(' ') + 1);
+
+    int64_t rows = -1;
+    auto [end, ec] = std::from_chars(tag.data(), tag.data() + tag.size(), rows);
+    return (ec == std::errc() && end == tag.data() + tag.size() && !tag.empty()) ? rows : -1;
+}
+
+bool SqlResult::isNull(int row, int column) const
+{
+    if (_compact)
+        return _compact->nulls[static_cast<std::size_t>(row) * _columns + column];
+    return PQgetisnull(_result, row, column) != 0;
+}
+
+const char *SqlResult::data(int row, int column) const
+{
+    if (_compact)
+        return _compact->data.data() +
+            _compact->offsets[static_cast<std::size_t>(row) * _columns + column];
+    return PQgetvalue(_result, row, column);
+}
+
+int SqlResult::length(int row, int column) const
+{
+    if (_compact) {
+        auto cell = static_cast<std::size_t>(row) * _columns + column;
+        return static_cast<int>(_compact->offsets[cell + 1] - _compact->offsets[cell]);
+    }
+    return PQgetlength(_result, row, column);
+}
+
+SqlValue SqlResult::value(int row, int column, SqlType type) const
+{
+    if (!_result && !_compact)
+        return SqlValue();
+
+    const auto oid = this->type(column);
+    const auto *value = isNull(row, column) ? nullptr : data(row, column);
+    if (format(column) == 0)
+        return asSqlValueText(oid, value, length(row, column), type);
+    if (_types) {
+        if (const auto *codec = _types->find(oid))
+            return SqlTypeMap::decode(*codec, value, length(row, column));
+    }
+    return asSqlValue(oid, value, length(row, column), type);
+}
+
+SqlCell SqlResult::cell(int row, int column, std::pmr::memory_resource *resource) const
+{
+    if (!_result && !_compact)
+        return SqlCell();
+
+    // Текстовые значения и пользовательские типы декодируются через value()
+    if (format(column) == 0 || (_types && _types->find(type(column))))
+        return SqlCell(value(row, column), resource);
+    return asSqlCell(type(column), isNull(row, column) ? nullptr : data(row, column),
+                     length(row, column), resource);
+}
+
+void SqlResult::setTypes(std::shared_ptr<const SqlTypeMap> types)
+{
+    _types = std::move(types);
+}
+
+std::string_view SqlResult::jsonb(int row, int column) const
+{
+    if ((!_result && !_compact) || isNull(row, column))
+        return std::string_view();
+
+    const auto *value = data(row, column);
+    const auto size = static_cast<std::size_t>(length(row, column));
+    // Значение jsonb в двоичном формате начинается с байта версии формата
+    if (type(column) == JSONBOID && format(column) != 0 && size > 0)
+        return std::string_view(value + 1, size - 1);
+    return std::string_view(value, size);
+}
+
+/// Возвращает размер значений полей результата Sql запроса
+static std::size_t cellsSize(const SqlResult &result)
+{
+    std::size_t size = 0;
+    for (int row = 0, rows = result.rows(); row < rows; ++row)
+        for (int col = 0, columns = result.columns(); col < columns; ++col)
+            size += result.length(row, col);
+    return size;
+}
+
+/// Создаёт пустое компактное хранилище с колонками результата Sql запроса
+static std::unique_ptr<SqlCompact> makeCompact(const SqlResult &result)
+{
+    auto compact = std::make_unique<SqlCompact>();
+    compact->names.reserve(result.columns());
+    compact->types.reserve(result.columns());
+    compact->formats.reserve(result.columns());
+    for (int col = 0; col < result.columns(); ++col) {
+        compact->names.push_back(result.fieldName(col));
+        compact->types.push_back(result.type(col));
+        compact->formats.push_back(result.format(col));
+    }
+    compact->command = result.commandTag();
+    compact->offsets.push_back(0);
+    return compact;
+}
+
+/// Добавляет значения полей результата Sql запроса в компактное хранилище
+static void appendCells(SqlCompact &compact, const SqlResult &result)
+{
+    for (int row = 0, rows = result.rows(); row < rows; ++row) {
+        for (int col = 0, columns = result.columns(); col < columns; ++col) {
+            const auto *value = result.data(row, col);
+            compact.nulls.push_back(result.isNull(row, col));
+            compact.data.insert(compact.data.end(), value, value + result.length(row, col));
+            compact.offsets.push_back(static_cast<uint32_t>(compact.data.size()));
+        }
+    }
+}
+
+bool SqlResult::compact()
+{
+    if (_compact)
+        return true;
+
+    if (!*this)
+        return false;
+
+    const auto cells = static_cast<std::size_t>(_rows) * _columns;
+    const auto size = cellsSize(*this);
+    if (size > std::numeric_limits<uint32_t>::max())
+        return false;
+
+    auto compact = makeCompact(*this);
+    compact->data.reserve(size);
+    compact->offsets.reserve(cells + 1);
+    compact->nulls.reserve(cells);
+    appendCells(*compact, *this);
+
+    PQclear(_result);
+    _result = nullptr;
+    _compact = std::move(compact);
+
+    return true;
+}
+
+bool SqlResult::append(const SqlResult &other)
+{
+    if (!other)
+        return false;
+
+    if (!_compact) {
+        if (_result && !compact())
+            return false;
+        if (!_compact) {
+            _compact = makeCompact(other);
+            _columns = other.columns();
+            _rows = 0;
+        }
+    }
+
+    if (other.columns() != _columns
+        || _compact->data.size() + cellsSize(other) > std::numeric_limits<uint32_t>::max()) {
+        return false;
+    }
+
+    appendCells(*_compact, other);
+    _rows += other.rows();
+
+    // Тег команды передаётся завершающим результатом потокового режима
+    auto command = other.commandTag();
+    if (!command.empty())
+        _compact->command = std::move(command);
+    return true;
+}
+
+std::size_t SqlResult::memorySize() const
+{
+    if (_compact) {
+        std::size_t size = sizeof(SqlCompact) + _compact->data.capacity()
+            + _compact->offsets.capacity() * sizeof(uint32_t) + _compact->nulls.capacity() / 8
+            + _compact->types.capacity() * sizeof(unsigned int)
+            + _compact->formats.capacity() * sizeof(int) + _compact->command.capacity();
+        for (const auto &name : _compact->names)
+            size += sizeof(name) + name.capacity();
+        return size;
+    }
+    return _result ? PQresultMemorySize(_result) : 0;
+}
+
+bool SqlResult::isCompact() const
+{
+    return _compact != nullptr;
+}
+
 pg_result *SqlResult::pgresult() const
 {
     return _result;
@@ -70,6 +332,9 @@ pg_result *SqlResult::pgresult() const
 
 bool SqlResult::operator!() const
 {
+    if (_compact)
+        return false;
+
     if (_result) {
         switch(PQresultStatus(_result)) {
         case PGRES_EMPTY_QUERY:     /* empty query string was executed */
@@ -84,11 +349,18 @@ bool SqlResult::operator!() const
         case PGRES_COPY_BOTH:       /* Copy In/Out data transfer in progress */
         case PGRES_NONFATAL_ERROR:  /* notice or warning message */
         case PGRES_SINGLE_TUPLE:    /* single tuple from larger resultset */
+#ifdef LIBPQ_HAS_PIPELINING
+        case PGRES_PIPELINE_SYNC:   /* pipeline synchronization point */
+#endif
             return false;
 
         case PGRES_BAD_RESPONSE:    /* an unexpected response was recv'd from the
                                             * backend */
         case PGRES_FATAL_ERROR:     /* query failed */
+#ifdef LIBPQ_HAS_PIPELINING
+        case PGRES_PIPELINE_ABORTED: /* command didn't run because of an abort
+                                            * earlier in a pipeline */
+#endif
             return true;
         }
     }
@@ -2,13 +2,20 @@
 
 #include "global.h"
 
+#include "SqlCell.h"
+#include "SqlValue.h"
+
+#include <memory>
 #include <string>
+#include <string_view>
 
 using PGresult = struct pg_result;
 
 namespace AsyncPg {
 
 class SqlRecord;
+class SqlTypeMap;
+struct SqlCompact;
 
 /// Результат Sql запроса
 class ASYNCPGLIB SqlResult
@@ -52,8 +59,87 @@ public:
     /// @return Номер колонки
     int column(std::string_view fieldName) const;
 
+    /// Возвращает тип PostgreSql колонки
+    /// @param column Номер колонки
+    /// @return Тип PostgreSql
+    unsigned int type(int column) const;
+
+    /// Возвращает формат значений колонки
+    /// @param column Номер колонки
+    /// @return Формат значений (0 - текстовый, 1 - двоичный)
+    int format(int column) const;
+
+    /// Возвращает тег выполненной команды (например, INSERT 0 5)
+    /// @return Тег команды
+    std::string commandTag() const;
+
+    /// Возвращает количество строк, обработанных командой
+    /// @return Количество строк (-1 - команда не сообщает количество строк)
+    int64_t affectedRows() const;
+
+    /// Проверяет равно ли значение поля NULL
+    /// @param row Номер строки
+    /// @param column Номер колонки
+    /// @return Результат проверки
+    bool isNull(int row, int column) const;
+
+    /// Возвращает значение поля в двоичном формате PostgreSql
+    /// @param row Номер строки
+    /// @param column Номер колонки
+    /// @return Значение поля в двоичном формате PostgreSql
+    const char *data(int row, int column) const;
+
+    /// Возвращает длину значения поля в двоичном формате PostgreSql
+    /// @param row Номер строки
+    /// @param column Номер колонки
+    /// @return Длина значения поля
+    int length(int row, int column) const;
+
+    /// Возвращает значение поля
+    /// @param row Номер строки
+    /// @param column Номер колонки
+    /// @param type Желаемый тип значения (SqlType::None - тип по умолчанию)
+    /// @return Значение поля
+    SqlValue value(int row, int column, SqlType type = SqlType::None) const;
+
+    /// Возвращает компактное значение поля
+    /// @param row Номер строки
+    /// @param column Номер колонки
+    /// @param resource Ресурс памяти (nullptr - ресурс памяти по умолчанию)
+    /// @return Компактное значение поля
+    SqlCell cell(int row, int column, std::pmr::memory_resource *resource = nullptr) const;
+
+    /// Возвращает JSON значения поля jsonb или json без копирования
+    /// @param row Номер строки
+    /// @param column Номер колонки
+    /// @return JSON значения поля (пустая строка - NULL)
+    std::string_view jsonb(int row, int column) const;
+
+    /// Устанавливает таблицу пользовательских типов PostgreSql
+    /// @param types Таблица пользовательских типов PostgreSql
+    void setTypes(std::shared_ptr<const SqlTypeMap> types);
+
+    /// Переносит значения в компактное хранилище и освобождает результат PostgreSql
+    /// @return Результат операции
+    bool compact();
+
+    /// Добавляет строки результата Sql запроса в компактное хранилище
+    ///
+    /// Используется для накопления строк, получаемых в потоковом режиме.
+    /// @param other Результат Sql запроса с тем же набором колонок
+    /// @return Результат операции
+    bool append(const SqlResult &other);
+
+    /// Возвращает объём памяти, занимаемой результатом Sql запроса
+    /// @return Объём памяти в байтах
+    std::size_t memorySize() const;
+
+    /// Проверяет хранятся ли значения в компактном хранилище
+    /// @return Результат проверки
+    bool isCompact() const;
+
     /// Возвращает результат PostgreSql
-    /// @return Результат PostgreSql
+    /// @return Результат PostgreSql (nullptr для компактного хранилища)
     PGresult *pgresult() const;
 
     /// Возвращает флаг наличия результата Sql запроса
@@ -74,9 +160,17 @@ public:
     SqlRecord end() const;
 
 private:
-    PGresult *_result  = nullptr;
-    int       _rows    = 0;
-    int       _columns = 0;
+    PGresult                          *_result  = nullptr;
+    std::unique_ptr<SqlCompact>        _compact;
+    std::shared_ptr<const SqlTypeMap>  _types;
+    int                                _rows    = 0;
+    int                                _columns = 0;
 };
 
+/// Разделяемый неизменяемый результат Sql запроса
+///
+/// Счётчик ссылок атомарный, поэтому результат можно читать из нескольких потоков.
+/// Строки и поля результата действительны, пока существует хотя бы один владелец.
+using SqlSharedResult = std::shared_ptr<const SqlResult>;
+
 }
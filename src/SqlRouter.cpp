@@ -0,0 +1,327 @@
+﻿#include "SqlRouter.h"
+
+#include <algorithm>
+#include <cctype>
+
+namespace AsyncPg {
+
+/// Запрос позиции WAL основного сервера
+static constexpr char WriteLsnSql[] = "SELECT (pg_current_wal_lsn() - '0/0'::pg_lsn)::int8";
+
+/// Запрос позиции воспроизведения WAL реплики
+static constexpr char ReplayLsnSql[] = "SELECT (pg_last_wal_replay_lsn() - '0/0'::pg_lsn)::int8";
+
+static bool isWordChar(char c)
+{
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+/// Возвращает позицию после комментария, строки или идентификатора в кавычках
+static std::size_t skipQuoted(std::string_view sql, std::size_t pos)
+{
+    const auto c = sql[pos];
+    const auto rest = sql.substr(pos);
+
+    if (rest.substr(0, 2) == "--") {
+        const auto end = sql.find('\n', pos);
+        return end == std::string_view::npos ? sql.size() : end + 1;
+    }
+
+    if (rest.substr(0, 2) == "/*") {
+        // Блочные комментарии могут быть вложенными
+        int depth = 0;
+        while (pos < sql.size()) {
+            const auto pair = sql.substr(pos, 2);
+            if (pair == "/*") {
+                ++depth;
+                pos += 2;
+            } else if (pair == "*/") {
+                pos += 2;
+                if (--depth == 0)
+                    return pos;
+            } else {
+                ++pos;
+            }
+        }
+        return sql.size();
+    }
+
+    if (c == '\'' || c == '"') {
+        // Строка E'...' допускает экранирование обратной косой чертой
+        const bool isEscape = c == '\'' && pos > 0 && (sql[pos - 1] == 'E' || sql[pos - 1] == 'e')
+            && (pos < 2 || !isWordChar(sql[pos - 2]));
+        for (++pos; pos < sql.size(); ++pos) {
+            if (isEscape && sql[pos] == '\\')
+                ++pos;
+            else if (sql[pos] == c)
+                return pos + 1;
+        }
+        return sql.size();
+    }
+
+    if (c == '$' && pos + 1 < sql.size() && !std::isdigit(static_cast<unsigned char>(sql[pos + 1]))) {
+        auto end = pos + 1;
+        while (end < sql.size() && isWordChar(sql[end]))
+            ++end;
+        if (end < sql.size() && sql[end] == '$') {
+            const auto tag = sql.substr(pos, end - pos + 1);
+            const auto close = sql.find(tag, end + 1);
+            return close == std::string_view::npos ? sql.size() : close + tag.size();
+        }
+    }
+
+    return pos;
+}
+
+SqlRoute sqlRoute(std::string_view sql)
+{
+    static constexpr std::string_view readCommands[] = {
+        "SELECT", "WITH", "VALUES", "TABLE", "SHOW", "EXPLAIN"
+    };
+    static constexpr std::string_view writeWords[] = {
+        "INSERT", "UPDATE", "DELETE", "MERGE", "INTO", "NEXTVAL", "SETVAL"
+    };
+
+    std::string first;
+    std::string prev;
+    std::size_t pos = 0;
+    while (pos < sql.size()) {
+        const auto next = skipQuoted(sql, pos);
+        if (next != pos) {
+            pos = next;
+            continue;
+        }
+        if (!isWordChar(sql[pos])) {
+            ++pos;
+            continue;
+        }
+
+        std::string word;
+        for (; pos < sql.size() && isWordChar(sql[pos]); ++pos)
+            word += static_cast<char>(std::toupper(static_cast<unsigned char>(sql[pos])));
+
+        if (first.empty()) {
+            first = word;
+            if (std::find(std::begin(readCommands), std::end(readCommands), first)
+                == std::end(readCommands))
+                return SqlRoute::Write;
+        } else if (std::find(std::begin(writeWords), std::end(writeWords), word)
+                       != std::end(writeWords)
+                   || (word == "SHARE" && (prev == "FOR" || prev == "KEY"))) {
+            return SqlRoute::Write;
+        }
+        prev = std::move(word);
+    }
+
+    return first.empty() ? SqlRoute::Write : SqlRoute::Read;
+}
+
+/// Определяет открыта ли транзакция после выполнения запроса
+///
+/// Учитываются первые слова каждой команды запроса: BEGIN и START открывают
+/// транзакцию, COMMIT, END, ABORT, ROLLBACK (кроме ROLLBACK TO) и PREPARE TRANSACTION
+/// завершают её.
+/// @param sql Запрос к базе данных
+/// @param isOpen Признак открытой транзакции до выполнения запроса
+/// @return Признак открытой транзакции
+static bool isTransactionOpen(std::string_view sql, bool isOpen)
+{
+    std::string first;
+    std::string second;
+    const auto apply = [&first, &second, &isOpen]() {
+        if (first == "BEGIN" || first == "START")
+            isOpen = true;
+        else if (first == "COMMIT" || first == "END" || first == "ABORT"
+                 || (first == "ROLLBACK" && second != "TO")
+                 || (first == "PREPARE" && second == "TRANSACTION"))
+            isOpen = false;
+        first.clear();
+        second.clear();
+    };
+
+    std::size_t pos = 0;
+    while (pos < sql.size()) {
+        const auto next = skipQuoted(sql, pos);
+        if (next != pos) {
+            pos = next;
+            continue;
+        }
+        if (sql[pos] == ';')
+            apply();
+        if (!isWordChar(sql[pos])) {
+            ++pos;
+            continue;
+        }
+
+        std::string word;
+        for (; pos < sql.size() && isWordChar(sql[pos]); ++pos)
+            word += static_cast<char>(std::toupper(static_cast<unsigned char>(sql[pos])));
+        if (first.empty())
+            first = std::move(word);
+        else if (second.empty())
+            second = std::move(word);
+    }
+    apply();
+    return isOpen;
+}
+
+/// Возвращает позицию WAL из результата запроса позиции WAL
+static uint64_t lsnValue(const SqlConnect *connect)
+{
+    const auto &result = connect->result();
+    if (connect->error() || result.rows() == 0 || result.isNull(0, 0))
+        return 0;
+
+    const auto value = result.value(0, 0);
+    const auto *lsn = std::get_if<SqlType::BigInt>(&value);
+    return lsn && *lsn ? static_cast<uint64_t>(**lsn) : 0;
+}
+
+SqlRouter::SqlRouter(std::string_view primaryInfo, const std::vector<std::string> &replicaInfos,
+                     event_base *evbase, std::pmr::memory_resource *resource,
+                     SqlBalancerOptions balancing)
+    : _primary(std::make_unique<SqlConnect>(primaryInfo, evbase, resource))
+    , _balancer(balancing)
+{
+    _replicas.reserve(replicaInfos.size());
+    for (const auto &info : replicaInfos) {
+        Replica replica;
+        replica.connect = std::make_unique<SqlConnect>(info, evbase, resource);
+        _balancer.add(replica.connect.get());
+        _replicas.push_back(std::move(replica));
+    }
+}
+
+void SqlRouter::execute(std::string_view sql, Callback func, SqlRoute route)
+{
+    if (route == SqlRoute::Auto)
+        route = sqlRoute(sql);
+
+    auto &connect = select(route, _isConsistent);
+    _isTransaction = isTransactionOpen(sql, _isTransaction);
+    connect.execute(sql);
+    if (route == SqlRoute::Write)
+        postWrite(connect, std::move(func));
+    else
+        connect.post(std::move(func));
+}
+
+void SqlRouter::execute(std::string_view sql, std::vector<SqlValue> params, Callback func,
+                        SqlRoute route)
+{
+    if (route == SqlRoute::Auto)
+        route = sqlRoute(sql);
+
+    auto &connect = select(route, _isConsistent);
+    _isTransaction = isTransactionOpen(sql, _isTransaction);
+    connect.execute(sql, std::move(params));
+    if (route == SqlRoute::Write)
+        postWrite(connect, std::move(func));
+    else
+        connect.post(std::move(func));
+}
+
+SqlConnect &SqlRouter::connection(std::string_view sql, SqlRoute route)
+{
+    return select(route == SqlRoute::Auto ? sqlRoute(sql) : route, _isConsistent);
+}
+
+SqlConnect &SqlRouter::select(SqlRoute route, bool isTracked)
+{
+    // Запросы открытой транзакции и чтение до получения позиции WAL изменений
+    // выполняются на основном сервере
+    if (route == SqlRoute::Write || _replicas.empty() || _isTransaction
+        || (isTracked && _pendingWrites != 0)) {
+        return *_primary;
+    }
+
+    const auto index = _balancer.select([this, isTracked](std::size_t i) {
+        return !isTracked || _replicas[i].replayLsn >= _writeLsn;
+    });
+    if (index < _replicas.size())
+        return *_replicas[index].connect;
+
+    // Позиции реплик обновляются для следующих запросов, текущий не ждёт реплик
+    if (isTracked)
+        refreshReplicas();
+    return *_primary;
+}
+
+void SqlRouter::postWrite(SqlConnect &connect, Callback func)
+{
+    if (!_isConsistent) {
+        connect.post(std::move(func));
+        return;
+    }
+
+    ++_pendingWrites;
+    connect.post([this, func = std::move(func)](SqlConnect *self) {
+        func(self);
+
+        // Запрос позиции WAL заменяет результат, поэтому выполняется после обработчика
+        self->execute(WriteLsnSql);
+        self->post([this](SqlConnect *self) {
+            _writeLsn = std::max(_writeLsn, lsnValue(self));
+            --_pendingWrites;
+        });
+    });
+}
+
+void SqlRouter::refreshReplicas()
+{
+    for (std::size_t i = 0; i < _replicas.size(); ++i) {
+        auto &replica = _replicas[i];
+        if (replica.isRefresh)
+            continue;
+
+        replica.isRefresh = true;
+        replica.connect->execute(ReplayLsnSql);
+        replica.connect->post([this, i](SqlConnect *self) {
+            auto &replica = _replicas[i];
+            replica.replayLsn = std::max(replica.replayLsn, lsnValue(self));
+            replica.isRefresh = false;
+        });
+    }
+}
+
+void SqlRouter::setConsistentReads(bool enabled)
+{
+    _isConsistent = enabled;
+}
+
+bool SqlRouter::isConsistentReads() const
+{
+    return _isConsistent;
+}
+
+bool SqlRouter::isTransaction() const
+{
+    return _isTransaction;
+}
+
+uint64_t SqlRouter::writeLsn() const
+{
+    return _writeLsn;
+}
+
+uint64_t SqlRouter::replayLsn(std::size_t index) const
+{
+    return _replicas.at(index).replayLsn;
+}
+
+SqlConnect &SqlRouter::primary()
+{
+    return *_primary;
+}
+
+SqlConnect &SqlRouter::replica(std::size_t index)
+{
+    return *_replicas.at(index).connect;
+}
+
+std::size_t SqlRouter::replicaCount() const
+{
+    return _replicas.size();
+}
+
+}
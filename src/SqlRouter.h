@@ -0,0 +1,160 @@
+﻿#pragma once
+
+#include "global.h"
+
+#include "SqlBalancer.h"
+#include "SqlConnect.h"
+
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct event_base;
+
+namespace AsyncPg {
+
+/// Направление Sql запроса
+enum class SqlRoute
+{
+    Auto,   ///< Определяется по тексту запроса
+    Read,   ///< Запрос только для чтения (реплика)
+    Write   ///< Изменяющий запрос (основной сервер)
+};
+
+/// Определяет направление Sql запроса по тексту запроса
+///
+/// Запросы SELECT, WITH, VALUES, TABLE, SHOW и EXPLAIN без изменяющих команд,
+/// блокировок строк и nextval/setval считаются запросами только для чтения.
+/// Функции с побочными эффектами не распознаются, такие запросы следует
+/// направлять явно.
+/// @param sql Запрос к базе данных
+/// @return SqlRoute::Read или SqlRoute::Write
+ASYNCPGLIB SqlRoute sqlRoute(std::string_view sql);
+
+/// Маршрутизатор запросов между основным сервером и репликами
+///
+/// Изменяющие запросы выполняются на основном сервере, запросы только для чтения -
+/// на реплике, выбранной балансировщиком по времени выполнения запросов.
+/// Транзакция, открытая через execute() (BEGIN, START TRANSACTION), закрепляет все
+/// запросы за основным сервером до её завершения (COMMIT, ROLLBACK, END). Запросы
+/// транзакции, выполняемые через connection(), следует направлять SqlRoute::Write.
+/// В режиме согласованного чтения после изменяющего запроса запоминается позиция
+/// WAL основного сервера, и чтение направляется только на реплики, воспроизведение
+/// WAL которых достигло этой позиции, иначе - на основной сервер.
+/// Функции обратного вызова очередей соединений ссылаются на маршрутизатор,
+/// поэтому он не перемещается и должен существовать до завершения запросов.
+class ASYNCPGLIB SqlRouter
+{
+public:
+    /// Функция обратного вызова
+    using Callback = SqlConnect::Callback;
+
+    /// Конструктор класса
+    /// @param primaryInfo Строка соединения с основным сервером
+    /// @param replicaInfos Строки соединения с репликами
+    /// @param evbase Сервис ввода-вывода
+    /// @param resource Ресурс памяти соединений (nullptr - ресурс памяти по умолчанию)
+    /// @param balancing Параметры балансировщика реплик
+    SqlRouter(std::string_view primaryInfo, const std::vector<std::string> &replicaInfos,
+              struct event_base *evbase = nullptr, std::pmr::memory_resource *resource = nullptr,
+              SqlBalancerOptions balancing = {});
+
+    /// Конструктор копирования
+    SqlRouter(const SqlRouter &) = delete;
+
+    /// Оператор копирования
+    void operator=(const SqlRouter &) = delete;
+
+    /// Выполняет запрос к базе данных
+    /// @param sql Запрос к базе данных
+    /// @param func Обработчик результата, получающий выбранное соединение
+    /// @param route Направление запроса
+    void execute(std::string_view sql, Callback func, SqlRoute route = SqlRoute::Auto);
+
+    /// Выполняет параметрический запрос к базе данных
+    /// @param sql Запрос к базе данных
+    /// @param params Параметры запроса
+    /// @param func Обработчик результата, получающий выбранное соединение
+    /// @param route Направление запроса
+    void execute(std::string_view sql, std::vector<SqlValue> params, Callback func,
+                 SqlRoute route = SqlRoute::Auto);
+
+    /// Выбирает соединение для запроса без учёта позиции WAL изменений
+    ///
+    /// Позиция WAL изменяющих запросов и транзакции, выполненные через выбранное
+    /// соединение, не отслеживаются.
+    /// @param sql Запрос к базе данных
+    /// @param route Направление запроса
+    /// @return Соединение с базой данных
+    SqlConnect &connection(std::string_view sql, SqlRoute route = SqlRoute::Auto);
+
+    /// Включает согласованное чтение собственных изменений
+    /// @param enabled Признак согласованного чтения
+    void setConsistentReads(bool enabled);
+
+    /// Проверяет включено ли согласованное чтение собственных изменений
+    /// @return Результат проверки
+    bool isConsistentReads() const;
+
+    /// Проверяет открыта ли транзакция, начатая через execute()
+    /// @return Результат проверки
+    bool isTransaction() const;
+
+    /// Запрашивает позиции воспроизведения WAL реплик
+    void refreshReplicas();
+
+    /// Возвращает позицию WAL последнего изменяющего запроса
+    /// @return Позиция WAL в байтах
+    uint64_t writeLsn() const;
+
+    /// Возвращает известную позицию воспроизведения WAL реплики
+    /// @param index Номер реплики
+    /// @return Позиция WAL в байтах (0 - неизвестна)
+    uint64_t replayLsn(std::size_t index) const;
+
+    /// Возвращает соединение с основным сервером
+    /// @return Соединение с базой данных
+    SqlConnect &primary();
+
+    /// Возвращает соединение с репликой
+    /// @param index Номер реплики
+    /// @return Соединение с базой данных
+    SqlConnect &replica(std::size_t index);
+
+    /// Возвращает количество реплик
+    /// @return Количество реплик
+    std::size_t replicaCount() const;
+
+private:
+    /// Реплика
+    struct Replica
+    {
+        std::unique_ptr<SqlConnect>  connect;             ///< Соединение с репликой
+        uint64_t                     replayLsn = 0;       ///< Позиция воспроизведения WAL
+        bool                         isRefresh = false;   ///< Выполняется запрос позиции WAL
+    };
+
+    /// Выбирает соединение для запроса
+    /// @param route Направление запроса
+    /// @param isTracked Учитывать позицию WAL изменений
+    /// @return Соединение с базой данных
+    SqlConnect &select(SqlRoute route, bool isTracked);
+
+    /// Устанавливает обработчик результата изменяющего запроса
+    /// @param connect Соединение с основным сервером
+    /// @param func Обработчик результата
+    void postWrite(SqlConnect &connect, Callback func);
+
+    std::unique_ptr<SqlConnect>  _primary;
+    std::vector<Replica>         _replicas;
+    SqlBalancer                  _balancer;
+    std::size_t                  _pendingWrites = 0;
+    uint64_t                     _writeLsn = 0;
+    bool                         _isConsistent = false;
+    bool                         _isTransaction = false;
+};
+
+}
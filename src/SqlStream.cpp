@@ -0,0 +1,49 @@
+﻿#include "SqlStream.h"
+
+#include <cerrno>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace AsyncPg {
+
+SqlChunkSink fdSink(int fd)
+{
+    return [fd](const char *data, std::size_t size) {
+        while (size > 0) {
+#ifdef _WIN32
+            auto written = _write(fd, data, static_cast<unsigned int>(size));
+#else
+            auto written = write(fd, data, size);
+#endif
+            if (written < 0 && errno == EINTR)
+                continue;
+            if (written <= 0)
+                return false;
+            data += written;
+            size -= static_cast<std::size_t>(written);
+        }
+        return true;
+    };
+}
+
+SqlChunkSource fdSource(int fd)
+{
+    return [fd](char *buffer, std::size_t size) -> std::size_t {
+        for (;;) {
+#ifdef _WIN32
+            auto count = _read(fd, buffer, static_cast<unsigned int>(size));
+#else
+            auto count = read(fd, buffer, size);
+#endif
+            if (count < 0 && errno == EINTR)
+                continue;
+            return (count > 0) ? static_cast<std::size_t>(count) : 0;
+        }
+    };
+}
+
+}
@@ -0,0 +1,44 @@
+﻿#pragma once
+
+#include "global.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace AsyncPg {
+
+class SqlConnect;
+
+/// Размер фрагмента потоковой передачи данных по умолчанию
+constexpr std::size_t SqlChunkSize = 256 * 1024;
+
+/// Приёмник фрагментов данных
+///
+/// Следующий фрагмент запрашивается только после возврата из приёмника,
+/// поэтому в памяти находится не более одного фрагмента.
+/// Возвращает false для прекращения передачи.
+using SqlChunkSink = std::function<bool(const char *data, std::size_t size)>;
+
+/// Источник фрагментов данных
+///
+/// Записывает в буфер не более size байт и возвращает количество записанных
+/// байт (0 - конец данных).
+using SqlChunkSource = std::function<std::size_t(char *buffer, std::size_t size)>;
+
+/// Обработчик завершения потоковой передачи данных
+///
+/// Ошибка передачи доступна через SqlConnect::error().
+using SqlStreamCallback = std::function<void(SqlConnect *, uint64_t bytes)>;
+
+/// Создаёт приёмник фрагментов данных, записывающий их в файловый дескриптор
+/// @param fd Файловый дескриптор
+/// @return Приёмник фрагментов данных
+ASYNCPGLIB SqlChunkSink fdSink(int fd);
+
+/// Создаёт источник фрагментов данных, читающий их из файлового дескриптора
+/// @param fd Файловый дескриптор
+/// @return Источник фрагментов данных
+ASYNCPGLIB SqlChunkSource fdSource(int fd);
+
+}
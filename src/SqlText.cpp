@@ -0,0 +1,369 @@
+﻿#include "SqlText.h"
+#include "SqlHex.h"
+#include "SqlOid.h"
+
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+namespace AsyncPg {
+
+/// Разбирает число, занимающее весь текст
+template<class T>
+static bool parseNumber(std::string_view text, T &value)
+{
+    const auto *last = text.data() + text.size();
+    auto [end, ec] = std::from_chars(text.data(), last, value);
+    return ec == std::errc() && end == last;
+}
+
+/// Последовательный разбор текстового представления
+class TextCursor
+{
+public:
+    explicit TextCursor(std::string_view text) : _text(text) {}
+
+    /// Разбирает беззнаковое целое число
+    bool number(int64_t &value)
+    {
+        const auto *first = _text.data() + _pos;
+        if (atEnd() || *first == '-')
+            return false;
+        auto [end, ec] = std::from_chars(first, _text.data() + _text.size(), value);
+        if (ec != std::errc())
+            return false;
+        _pos += static_cast<std::size_t>(end - first);
+        return true;
+    }
+
+    /// Пропускает символ, если он следующий
+    bool skip(char c)
+    {
+        if (_pos < _text.size() && _text[_pos] == c) {
+            ++_pos;
+            return true;
+        }
+        return false;
+    }
+
+    /// Возвращает следующий символ (0 - конец текста)
+    char peek() const
+    {
+        return _pos < _text.size() ? _text[_pos] : '\0';
+    }
+
+    /// Проверяет достигнут ли конец текста
+    bool atEnd() const
+    {
+        return _pos == _text.size();
+    }
+
+private:
+    std::string_view  _text;
+    std::size_t       _pos = 0;
+};
+
+/// Возвращает количество дней от эпохи Unix для даты григорианского календаря
+static int64_t daysFromCivil(int64_t year, int64_t month, int64_t day)
+{
+    year -= month <= 2 ? 1 : 0;
+    const int64_t era = (year >= 0 ? year : year - 399) / 400;
+    const int64_t yoe = year - era * 400;
+    const int64_t doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    const int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+/// Отделяет признак даты до нашей эры
+static bool stripEra(std::string_view &text)
+{
+    constexpr std::string_view era = " BC";
+    if (text.size() > era.size() && text.substr(text.size() - era.size()) == era) {
+        text.remove_suffix(era.size());
+        return true;
+    }
+    return false;
+}
+
+/// Разбирает дату YYYY-MM-DD в количество дней от эпохи PostgreSql
+static bool parseDate(TextCursor &cursor, bool bc, int64_t &days)
+{
+    int64_t year = 0;
+    int64_t month = 0;
+    int64_t day = 0;
+    if (!cursor.number(year) || !cursor.skip('-') || !cursor.number(month) || !cursor.skip('-')
+        || !cursor.number(day) || month < 1 || month > 12 || day < 1 || day > 31) {
+        return false;
+    }
+    days = daysFromCivil(bc ? 1 - year : year, month, day)
+        - POSTGRES_EPOCH_USEC / POSTGRES_DAY_USEC;
+    return true;
+}
+
+/// Разбирает время HH:MM:SS[.ffffff] в количество микросекунд
+static bool parseTime(TextCursor &cursor, int64_t &usec)
+{
+    int64_t hours = 0;
+    int64_t minutes = 0;
+    int64_t seconds = 0;
+    if (!cursor.number(hours) || !cursor.skip(':') || !cursor.number(minutes)
+        || !cursor.skip(':') || !cursor.number(seconds)) {
+        return false;
+    }
+
+    int64_t fraction = 0;
+    if (cursor.skip('.')) {
+        int digits = 0;
+        for (char c = cursor.peek(); c >= '0' && c <= '9'; c = cursor.peek()) {
+            if (digits++ < 6)
+                fraction = fraction * 10 + (c - '0');
+            cursor.skip(c);
+        }
+        for (; digits < 6; ++digits)
+            fraction *= 10;
+    }
+
+    usec = ((hours * 60 + minutes) * 60 + seconds) * 1000000 + fraction;
+    return true;
+}
+
+/// Разбирает смещение часового пояса ±HH[:MM[:SS]] в секундах к востоку от UTC
+static bool parseZone(TextCursor &cursor, int64_t &seconds)
+{
+    const auto sign = cursor.peek();
+    if (!cursor.skip('+') && !cursor.skip('-'))
+        return false;
+
+    int64_t hours = 0;
+    int64_t minutes = 0;
+    int64_t secs = 0;
+    if (!cursor.number(hours))
+        return false;
+    if (cursor.skip(':') && (!cursor.number(minutes) || (cursor.skip(':') && !cursor.number(secs))))
+        return false;
+
+    seconds = (hours * 60 + minutes) * 60 + secs;
+    if (sign == '-')
+        seconds = -seconds;
+    return true;
+}
+
+/// Разбирает бесконечность даты или момента времени
+template<class T>
+static bool parseInfinity(std::string_view text, T &value)
+{
+    if (text == "infinity")
+        value = std::numeric_limits<T>::max();
+    else if (text == "-infinity")
+        value = std::numeric_limits<T>::min();
+    else
+        return false;
+    return true;
+}
+
+/// Разбирает момент времени в количество микросекунд от эпохи PostgreSql
+static bool parseTimeStamp(std::string_view text, bool withZone, int64_t &usec)
+{
+    if (parseInfinity(text, usec))
+        return true;
+
+    const bool bc = stripEra(text);
+    TextCursor cursor(text);
+    int64_t days = 0;
+    int64_t time = 0;
+    if (!parseDate(cursor, bc, days) || !cursor.skip(' ') || !parseTime(cursor, time))
+        return false;
+
+    int64_t zone = 0;
+    if (withZone && !parseZone(cursor, zone))
+        return false;
+    usec = days * POSTGRES_DAY_USEC + time - zone * 1000000;
+    return cursor.atEnd();
+}
+
+/// Разбирает интервал в формате postgres: [N year[s]] [N mon[s]] [N day[s]] [±HH:MM:SS[.ffffff]]
+static bool parseInterval(std::string_view text, int64_t &usec, int32_t &days, int32_t &months)
+{
+    usec = 0;
+    days = 0;
+    months = 0;
+    while (!text.empty()) {
+        auto space = text.find(' ');
+        auto token = text.substr(0, space);
+        text = (space == std::string_view::npos) ? std::string_view() : text.substr(space + 1);
+
+        if (token.find(':') != std::string_view::npos) {
+            const bool negative = token.front() == '-';
+            if (token.front() == '-' || token.front() == '+')
+                token.remove_prefix(1);
+            TextCursor cursor(token);
+            if (!parseTime(cursor, usec) || !cursor.atEnd())
+                return false;
+            if (negative)
+                usec = -usec;
+            continue;
+        }
+
+        int32_t value = 0;
+        if (!token.empty() && token.front() == '+')
+            token.remove_prefix(1);
+        if (!parseNumber(token, value))
+            return false;
+
+        space = text.find(' ');
+        auto unit = text.substr(0, space);
+        text = (space == std::string_view::npos) ? std::string_view() : text.substr(space + 1);
+        if (unit == "year" || unit == "years")
+            months += value * 12;
+        else if (unit == "mon" || unit == "mons")
+            months += value;
+        else if (unit == "day" || unit == "days")
+            days += value;
+        else
+            return false;
+    }
+    return true;
+}
+
+/// Возвращает значение в виде текста
+static SqlValue textValue(std::string_view text)
+{
+    return makeSqlValue<SqlType::Text>(std::string(text));
+}
+
+/// Конвертирует целое число из текстового формата через двоичный формат
+template<class T>
+static SqlValue integerValue(unsigned int oid, std::string_view text, SqlType type)
+{
+    T value = 0;
+    if (!parseNumber(text, value))
+        return textValue(text);
+
+    char buffer[sizeof(T)];
+    writeBigEndian(buffer, value);
+    return asSqlValue(oid, buffer, sizeof(T), type);
+}
+
+/// Конвертирует число с плавающей точкой из текстового формата через двоичный формат
+template<class T, class I>
+static SqlValue floatValue(unsigned int oid, std::string_view text, SqlType type)
+{
+    T value = 0;
+    if (!parseNumber(text, value))
+        return textValue(text);
+
+    I bits = 0;
+    std::memcpy(&bits, &value, sizeof(T));
+    char buffer[sizeof(T)];
+    writeBigEndian(buffer, bits);
+    return asSqlValue(oid, buffer, sizeof(T), type);
+}
+
+SqlValue asSqlValueText(unsigned int oid, const char *data, int length, SqlType type)
+{
+    if (!data)
+        return asSqlValue(oid, nullptr, 0, type);
+
+    const std::string_view text(data, static_cast<std::size_t>(length));
+    char buffer[16];
+    switch (oid) {
+    case BOOLOID:
+        buffer[0] = (text == "t") ? 1 : 0;
+        return asSqlValue(oid, buffer, 1, type);
+    case INT2OID:
+        return integerValue<int16_t>(oid, text, type);
+    case INT4OID:
+        return integerValue<int32_t>(oid, text, type);
+    case INT8OID:
+        return integerValue<int64_t>(oid, text, type);
+    case FLOAT4OID:
+        return floatValue<float, int32_t>(oid, text, type);
+    case FLOAT8OID:
+        return floatValue<double, int64_t>(oid, text, type);
+    case NUMERICOID: {
+        const auto size = numericPgSize(text);
+        if (size == 0)
+            return textValue(text);
+        std::vector<char> numeric(size);
+        numericToPg(text, numeric.data());
+        return asSqlValue(oid, numeric.data(), static_cast<int>(size), type);
+    }
+    case DATEOID: {
+        int32_t days = 0;
+        if (!parseInfinity(text, days)) {
+            std::string_view date = text;
+            const bool bc = stripEra(date);
+            TextCursor cursor(date);
+            int64_t value = 0;
+            if (!parseDate(cursor, bc, value) || !cursor.atEnd())
+                return textValue(text);
+            days = static_cast<int32_t>(value);
+        }
+        writeBigEndian(buffer, days);
+        return asSqlValue(oid, buffer, 4, type);
+    }
+    case TIMEOID:
+    case TIMETZOID: {
+        TextCursor cursor(text);
+        int64_t usec = 0;
+        int64_t zone = 0;
+        if (!parseTime(cursor, usec) || (oid == TIMETZOID && !parseZone(cursor, zone))
+            || !cursor.atEnd()) {
+            return textValue(text);
+        }
+        // Часовой пояс timetz хранится в секундах к западу от UTC
+        writeBigEndian(buffer, usec);
+        writeBigEndian(buffer + 8, static_cast<int32_t>(-zone));
+        return asSqlValue(oid, buffer, oid == TIMETZOID ? 12 : 8, type);
+    }
+    case TIMESTAMPOID:
+    case TIMESTAMPTZOID: {
+        int64_t usec = 0;
+        if (!parseTimeStamp(text, oid == TIMESTAMPTZOID, usec))
+            return textValue(text);
+        writeBigEndian(buffer, usec);
+        return asSqlValue(oid, buffer, 8, type);
+    }
+    case INTERVALOID: {
+        int64_t usec = 0;
+        int32_t days = 0;
+        int32_t months = 0;
+        if (!parseInterval(text, usec, days, months))
+            return textValue(text);
+        writeBigEndian(buffer, usec);
+        writeBigEndian(buffer + 8, days);
+        writeBigEndian(buffer + 12, months);
+        return asSqlValue(oid, buffer, 16, type);
+    }
+    case UUIDOID:
+        if (!uuidFromChars(text, buffer))
+            return textValue(text);
+        return asSqlValue(oid, buffer, 16, type);
+    case BYTEAOID: {
+        // Поддерживается шестнадцатеричный формат bytea_output = hex
+        if (text.size() < 2 || text[0] != '\\' || text[1] != 'x')
+            return textValue(text);
+        std::vector<char> bytes((text.size() - 2) / 2);
+        if (!hexDecode(text.data() + 2, text.size() - 2, bytes.data()))
+            return textValue(text);
+        return makeSqlValue<SqlType::Bytea>(std::move(bytes));
+    }
+    case JSONBOID:
+        // Текстовое значение jsonb не содержит байта версии формата
+        return makeSqlValue<SqlType::Jsonb>(std::string(text));
+    case CHAROID:
+    case NAMEOID:
+    case JSONOID:
+    case XMLOID:
+    case VARCHAROID:
+    case TEXTOID:
+        return asSqlValue(oid, data, length, type);
+    default:
+        break;
+    }
+    return textValue(text);
+}
+
+}
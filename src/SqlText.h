@@ -0,0 +1,23 @@
+﻿#pragma once
+
+#include "global.h"
+
+#include "SqlValue.h"
+
+namespace AsyncPg {
+
+/// Конвертирует значение PostgreSql в текстовом формате в значение поля строки результата Sql запроса
+///
+/// Текстовый формат используется для результатов простого протокола запросов.
+/// Даты и время разбираются в формате ISO (DateStyle = ISO), интервалы - в формате
+/// postgres (IntervalStyle = postgres). Значения остальных типов возвращаются как текст.
+/// @param oid Тип PostgreSql
+/// @param data Значение PostgreSql в текстовом формате (nullptr - NULL)
+/// @param length Длина значения PostgreSql
+/// @param type Желаемый тип поля строки результата Sql запроса
+///             (SqlType::None - тип по умолчанию для oid)
+/// @return Значение поля строки результата Sql запроса
+ASYNCPGLIB SqlValue asSqlValueText(
+    unsigned int oid, const char *data, int length, SqlType type = SqlType::None);
+
+}
@@ -0,0 +1,29 @@
+﻿#include "SqlTransaction.h"
+
+namespace AsyncPg {
+
+std::string beginCommand(const SqlTransactionOptions &options)
+{
+    std::string command = "BEGIN";
+    switch (options.isolation) {
+    case SqlIsolation::ReadCommitted:
+        command += " ISOLATION LEVEL READ COMMITTED";
+        break;
+    case SqlIsolation::RepeatableRead:
+        command += " ISOLATION LEVEL REPEATABLE READ";
+        break;
+    case SqlIsolation::Serializable:
+        command += " ISOLATION LEVEL SERIALIZABLE";
+        break;
+    case SqlIsolation::Default:
+        break;
+    }
+
+    if (options.readOnly)
+        command += " READ ONLY";
+    if (options.deferrable)
+        command += " DEFERRABLE";
+    return command;
+}
+
+}
@@ -0,0 +1,41 @@
+﻿#pragma once
+
+#include "global.h"
+
+#include "SqlValue.h"
+
+#include <string>
+#include <vector>
+
+namespace AsyncPg {
+
+/// Уровень изоляции транзакции
+enum class SqlIsolation
+{
+    Default,        ///< Уровень изоляции сервера по умолчанию
+    ReadCommitted,  ///< READ COMMITTED
+    RepeatableRead, ///< REPEATABLE READ
+    Serializable    ///< SERIALIZABLE
+};
+
+/// Параметры транзакции
+struct ASYNCPGLIB SqlTransactionOptions
+{
+    SqlIsolation isolation  = SqlIsolation::Default; ///< Уровень изоляции
+    bool         readOnly   = false;                 ///< Транзакция только для чтения
+    bool         deferrable = false;                 ///< Отложенная транзакция (SERIALIZABLE READ ONLY)
+};
+
+/// Запрос транзакции
+struct ASYNCPGLIB SqlStatement
+{
+    std::string           sql;     ///< Запрос к базе данных
+    std::vector<SqlValue> params;  ///< Параметры запроса
+};
+
+/// Возвращает команду начала транзакции
+/// @param options Параметры транзакции
+/// @return Команда начала транзакции
+ASYNCPGLIB std::string beginCommand(const SqlTransactionOptions &options);
+
+}
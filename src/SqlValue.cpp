@@ -1,16 +1,20 @@
 ﻿#include "SqlValue.h"
+#include "SqlHex.h"
+#include "SqlOid.h"
 
 #include <libpq-fe.h>
 
 #include <cstddef>
 #include <cstdint>
-#include <deque>
 #include <iostream>
 #include <charconv>
+#include <cstring>
 #include <algorithm>
 #include <iterator>
+#include <limits>
 #include <memory>
 #include <tuple>
+#include <type_traits>
 #include <variant>
 
 #if (defined(_WIN16) || defined(_WIN32) || defined(_WIN64)) && !defined(__WINDOWS__)
@@ -90,30 +94,6 @@
 
 namespace AsyncPg {
 
-#define BOOLOID 16
-#define CHAROID 18
-#define NAMEOID 19
-#define JSONOID 114
-#define XMLOID 142
-#define VARCHAROID 1043
-#define TEXTOID 25
-#define INT8OID 20
-#define INT2OID 21
-#define INT4OID 23
-#define NUMERICOID 1700
-#define FLOAT4OID 700
-#define FLOAT8OID 701
-#define DATEOID 1082
-#define TIMEOID 1083
-#define TIMETZOID 1266
-#define TIMESTAMPOID 1114
-#define TIMESTAMPTZOID 1184
-#define BYTEAOID 17
-#define UUIDOID 2950
-
-#define POSTGRES_EPOCH_USEC 946684800000000
-#define POSTGRES_DAY_USEC 86400000000
-
 template <typename T>
 constexpr T htonT (T value) noexcept
 {
@@ -140,83 +120,97 @@ constexpr static T& swap_endian(T& pX)
 }
 #endif
 
-static const char *asChar(PGresult* pgresult, int row, int col)
+template <typename T>
+static T readT(const char *data)
 {
-    return PQgetvalue(pgresult, row, col);
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return htonT(value);
 }
 
-static bool asBool(PGresult* pgresult, int row, int col)
+static bool asBool(const char *data, int /*length*/)
 {
-    return *asChar(pgresult, row, col) != 0;
+    return *data != 0;
 }
 
-static int8_t asInt8(PGresult* pgresult, int row, int col)
+static int16_t asInt16(const char *data, int /*length*/)
 {
-    void *ptr = PQgetvalue(pgresult, row, col);
-    return *static_cast<int8_t*>(ptr);
+    return readT<int16_t>(data);
 }
 
-static int16_t asInt16(PGresult* pgresult, int row, int col)
+static int32_t asInt32(const char *data, int /*length*/)
 {
-    void *ptr = PQgetvalue(pgresult, row, col);
-    return htonT(*static_cast<int16_t*>(ptr));
+    return readT<int32_t>(data);
 }
 
-static int32_t asInt32(PGresult* pgresult, int row, int col)
+static int64_t asInt64(const char *data, int /*length*/)
 {
-    void *ptr = PQgetvalue(pgresult, row, col);
-    return htonT(*static_cast<int32_t*>(ptr));
+    return readT<int64_t>(data);
 }
 
-static int64_t asInt64(PGresult* pgresult, int row, int col)
+static std::time_t asTimeStamp(const char *data, int length)
 {
-    void *ptr = PQgetvalue(pgresult, row, col);
-    return htonT(*static_cast<int64_t*>(ptr));
+    return (asInt64(data, length) + POSTGRES_EPOCH_USEC) / 1000000;
 }
 
-static std::time_t asTimeStamp(PGresult* pgresult, int row, int col)
+static std::time_t asTimeStampTz(const char *data, int length)
 {
-    return (asInt64(pgresult, row, col) + POSTGRES_EPOCH_USEC) / 1000000;
+    return (asInt64(data, length) + POSTGRES_EPOCH_USEC) / 1000000;
 }
 
-static std::time_t asTimeStampTz(PGresult* pgresult, int row, int col)
+static std::time_t asTime(const char *data, int length)
 {
-    return (asInt64(pgresult, row, col) + POSTGRES_EPOCH_USEC) / 1000000;
+    return asInt64(data, length) / 1000000;
 }
 
-static std::time_t asTime(PGresult* pgresult, int row, int col)
+static std::time_t asTimeTz(const char *data, int length)
 {
-    return asInt64(pgresult, row, col) / 1000000;
+    return asInt64(data, length) / 1000000;
 }
 
-static std::time_t asTimeTz(PGresult* pgresult, int row, int col)
+static std::time_t asDate(const char *data, int length)
 {
-    return asInt64(pgresult, row, col) / 1000000;
+    return (asInt32(data, length) * POSTGRES_DAY_USEC + POSTGRES_EPOCH_USEC) / 1000000;
 }
 
-static std::time_t asDate(PGresult* pgresult, int row, int col)
+static SqlTimePoint asTimePoint(const char *data, int length)
 {
-    return (asInt32(pgresult, row, col) * POSTGRES_DAY_USEC + POSTGRES_EPOCH_USEC) / 1000000;
+    // Бесконечности PostgreSql соответствуют граничные значения
+    const auto usec = asInt64(data, length);
+    if (usec == std::numeric_limits<int64_t>::max())
+        return SqlTimePoint::max();
+    if (usec == std::numeric_limits<int64_t>::min())
+        return SqlTimePoint::min();
+    return SqlTimePoint(std::chrono::microseconds(usec + POSTGRES_EPOCH_USEC));
 }
 
-static std::vector<char> asVector(PGresult* pgresult, int row, int col)
+static std::chrono::microseconds asTimeUs(const char *data, int length)
 {
-    const auto len = PQgetlength(pgresult, row, col);
-    auto ptr = PQgetvalue(pgresult, row, col);
-    std::vector<char> result;
-    result.reserve(len);
-    result.assign(ptr, ptr + len);
-    return result;
+    return std::chrono::microseconds(asInt64(data, length));
 }
 
-static std::vector<char> asBytea(PGresult* pgresult, int row, int col)
+static SqlDatePoint asDatePoint(const char *data, int length)
 {
-    const auto len = PQgetlength(pgresult, row, col);
-    auto ptr = PQgetvalue(pgresult, row, col);
-    std::vector<char> result;
-    result.reserve(len);
-    result.assign(ptr, ptr + len);
-    return result;
+    const auto days = asInt32(data, length);
+    if (days == std::numeric_limits<int32_t>::max())
+        return SqlDatePoint::max();
+    if (days == std::numeric_limits<int32_t>::min())
+        return SqlDatePoint::min();
+    return SqlDatePoint(SqlDays(days + POSTGRES_EPOCH_USEC / POSTGRES_DAY_USEC));
+}
+
+static SqlInterval asInterval(const char *data, int length)
+{
+    SqlInterval interval;
+    interval.time = std::chrono::microseconds(asInt64(data, length));
+    interval.days = asInt32(data + 8, length);
+    interval.months = asInt32(data + 12, length);
+    return interval;
+}
+
+static std::vector<char> asBytea(const char *data, int length)
+{
+    return std::vector<char>(data, data + length);
 }
 
 template<class T, std::size_t N, std::size_t... I>
@@ -232,148 +226,174 @@ constexpr std::array<std::remove_cv_t<T>, N> to_array(T *a)
     return to_array_impl<T, N>(a, std::make_index_sequence<N>{});
 }
 
-static std::array<char, 16> asUuid(PGresult* pgresult, int row, int col)
+static std::array<char, 16> asUuid(const char *data, int /*length*/)
 {
-    auto *ptr = PQgetvalue(pgresult, row, col);
-    return to_array<char, 16>(ptr);
+    return to_array<const char, 16>(data);
 }
 
-static std::string asString(PGresult* pgresult, int row, int col)
+static std::string asString(const char *data, int length)
 {
-    const auto len = PQgetlength(pgresult, row, col);
-    auto ptr = PQgetvalue(pgresult, row, col);
-    return std::string(ptr, len);
+    return std::string(data, length);
 }
 
-static double asDouble(PGresult* pgresult, int row, int col)
+static std::string asJsonb(const char *data, int length)
 {
-    double ptr = *reinterpret_cast<double*>(PQgetvalue(pgresult, row, col));
-    return htonT(ptr);
+    // Значение jsonb начинается с байта версии формата
+    return (length > 0) ? std::string(data + 1, length - 1) : std::string();
 }
 
-static float asFloat(PGresult* pgresult, int row, int col)
+static double asDouble(const char *data, int /*length*/)
+{
+    return readT<double>(data);
+}
+
+static float asFloat(const char *data, int length)
 {
     union {
         int32_t value;
         float   retval;
     } castunion{};
 
-    castunion.value = asInt32(pgresult, row, col);
+    castunion.value = asInt32(data, length);
     return castunion.retval;
 }
 
-static std::string asDecimal(PGresult* pgresult, int row, int col)
+static std::string asDecimal(const char *data, int length)
 {
-    std::string str;
-    auto *decimal = reinterpret_cast<int16_t *>(PQgetvalue(pgresult, row, col));
-    auto ndigits  = htonT(decimal[0]);
-    auto width    = htonT(decimal[1]);
-    auto sign     = htonT(decimal[2]);
-    auto dscale   = htonT(decimal[3]);
-    if (sign != 0)
-        str += "-";
-
-    if (width < 0) {
-        str += "0.";
-        ++width;
-        while (width++ < 0)
-            str += "0000";
-        width = -1;
-    }
-
-    for (int n = 0; n < ndigits; ++n) {
-        std::string digit = std::to_string(htonT(decimal[4 + n]));
-        if (!str.empty())
-            str += std::string(4 - digit.size(), '0');
-        str += digit;
-
-        if (width == 0 && ndigits - 1 != n)
-            str += ".";
-
-        if (dscale > 0 && width < 0)
-            dscale -= 4;
+    std::string str(numericTextSize(data, length), '\0');
+    str.resize(static_cast<std::size_t>(numericToChars(data, length, str.data()) - str.data()));
+    return str;
+}
 
-        if (width >= 0)
-            --width;
-    }
+static SqlDecimal asNumeric(const char *data, int length)
+{
+    return SqlDecimal::fromPg(data, length);
+}
 
-    while (width-- >= 0)
-        str += "0000";
+static SqlArray asArray(const char *data, int length)
+{
+    return SqlArray::fromPg(data, length);
+}
 
-    return (dscale < 0) ? str.substr(0, str.size() + dscale) : str;
+template<std::size_t I, class F>
+static void emplaceValue(SqlValue &result, const char *data, int length, F func)
+{
+    if (data)
+        result.emplace<I>(func(data, length));
+    else
+        result.emplace<I>();
 }
 
-SqlValue asSqlValue(PGresult *pgresult, int row, int col)
+SqlValue asSqlValue(unsigned int oid, const char *data, int length, SqlType type)
 {
     SqlValue result;
 
-    if (!pgresult)
-        return result;
-
-    auto oid = PQftype(pgresult, col);
     switch (oid) {
     case BOOLOID:
-        result.emplace<SqlType::Boolean>(asBool(pgresult, row, col));
+        emplaceValue<SqlType::Boolean>(result, data, length, asBool);
         break;
     case INT2OID:
-        result.emplace<SqlType::SmallInt>(asInt16(pgresult, row, col));
+        emplaceValue<SqlType::SmallInt>(result, data, length, asInt16);
         break;
     case INT4OID:
-        result.emplace<SqlType::Integer>(asInt32(pgresult, row, col));
+        emplaceValue<SqlType::Integer>(result, data, length, asInt32);
         break;
     case INT8OID:
-        result.emplace<SqlType::BigInt>(asInt64(pgresult, row, col));
+        emplaceValue<SqlType::BigInt>(result, data, length, asInt64);
         break;
     case FLOAT4OID:
-        result.emplace<SqlType::Real>(asFloat(pgresult, row, col));
+        emplaceValue<SqlType::Real>(result, data, length, asFloat);
         break;
     case FLOAT8OID:
-        result.emplace<SqlType::Double>(asDouble(pgresult, row, col));
+        emplaceValue<SqlType::Double>(result, data, length, asDouble);
         break;
     case NUMERICOID:
-        result.emplace<SqlType::Decimal>(asDecimal(pgresult, row, col));
+        if (type == SqlType::Numeric)
+            emplaceValue<SqlType::Numeric>(result, data, length, asNumeric);
+        else
+            emplaceValue<SqlType::Decimal>(result, data, length, asDecimal);
         break;
     case TIMESTAMPOID:
-        result.emplace<SqlType::TimeStamp>(asTimeStamp(pgresult, row, col));
+        if (type == SqlType::TimeStampUs)
+            emplaceValue<SqlType::TimeStampUs>(result, data, length, asTimePoint);
+        else
+            emplaceValue<SqlType::TimeStamp>(result, data, length, asTimeStamp);
         break;
     case TIMESTAMPTZOID:
-        result.emplace<SqlType::TimeStampTz>(asTimeStampTz(pgresult, row, col));
+        if (type == SqlType::TimeStampTzUs)
+            emplaceValue<SqlType::TimeStampTzUs>(result, data, length, asTimePoint);
+        else
+            emplaceValue<SqlType::TimeStampTz>(result, data, length, asTimeStampTz);
         break;
     case TIMEOID:
-        result.emplace<SqlType::Time>(asTime(pgresult, row, col));
+        if (type == SqlType::TimeUs)
+            emplaceValue<SqlType::TimeUs>(result, data, length, asTimeUs);
+        else
+            emplaceValue<SqlType::Time>(result, data, length, asTime);
         break;
     case TIMETZOID:
-        result.emplace<SqlType::TimeTz>(asTimeTz(pgresult, row, col));
+        if (type == SqlType::TimeUs)
+            emplaceValue<SqlType::TimeUs>(result, data, length, asTimeUs);
+        else
+            emplaceValue<SqlType::TimeTz>(result, data, length, asTimeTz);
+        break;
+    case INTERVALOID:
+        emplaceValue<SqlType::Interval>(result, data, length, asInterval);
         break;
     case BYTEAOID:
-        result.emplace<SqlType::Bytea>(asBytea(pgresult, row, col));
+        emplaceValue<SqlType::Bytea>(result, data, length, asBytea);
         break;
     case DATEOID:
-        result.emplace<SqlType::Date>(asDate(pgresult, row, col));
+        if (type == SqlType::DateDays)
+            emplaceValue<SqlType::DateDays>(result, data, length, asDatePoint);
+        else
+            emplaceValue<SqlType::Date>(result, data, length, asDate);
         break;
     case UUIDOID:
-        result.emplace<SqlType::Uuid>(asUuid(pgresult, row, col));
+        emplaceValue<SqlType::Uuid>(result, data, length, asUuid);
         break;
     case CHAROID:
-        result.emplace<SqlType::Char>(asString(pgresult, row, col));
+        emplaceValue<SqlType::Char>(result, data, length, asString);
+        break;
     case NAMEOID:
-        result.emplace<SqlType::Name>(asString(pgresult, row, col));
+        emplaceValue<SqlType::Name>(result, data, length, asString);
+        break;
     case JSONOID:
-        result.emplace<SqlType::Json>(asString(pgresult, row, col));
+        emplaceValue<SqlType::Json>(result, data, length, asString);
+        break;
     case XMLOID:
-        result.emplace<SqlType::Xml>(asString(pgresult, row, col));
+        emplaceValue<SqlType::Xml>(result, data, length, asString);
+        break;
     case VARCHAROID:
-        result.emplace<SqlType::VarChar>(asString(pgresult, row, col));
+        emplaceValue<SqlType::VarChar>(result, data, length, asString);
+        break;
     case TEXTOID:
-        result.emplace<SqlType::Text>(asString(pgresult, row, col));
+        emplaceValue<SqlType::Text>(result, data, length, asString);
+        break;
+    case JSONBOID:
+        emplaceValue<SqlType::Jsonb>(result, data, length, asJsonb);
         break;
     default:
+        if (toPgElementType(oid) != 0)
+            emplaceValue<SqlType::Array>(result, data, length, asArray);
         break;
     }
 
     return result;
 }
 
+SqlValue asSqlValue(PGresult *pgresult, int row, int col)
+{
+    if (!pgresult)
+        return SqlValue();
+
+    const char *data = nullptr;
+    if (PQgetisnull(pgresult, row, col) == 0)
+        data = PQgetvalue(pgresult, row, col);
+
+    return asSqlValue(PQftype(pgresult, col), data, PQgetlength(pgresult, row, col));
+}
+
 static std::tuple<unsigned int, std::size_t, char *> fromBool(const std::optional<bool> &value)
 {
     if (!value)
@@ -448,80 +468,50 @@ static std::tuple<unsigned int, std::size_t, char *> fromDouble(const std::optio
 static std::tuple<unsigned int, std::size_t, char *> fromDecimal(
     const std::optional<std::string> &value)
 {
-    if (!value || value->empty())
+    if (!value)
         return std::make_tuple(NUMERICOID, 0, nullptr);
 
-    std::deque<int16_t> decimal;
-    int16_t ndigits  = 0;
-    int16_t width    = -1;
-    int16_t sign     = value->substr(0, 1) == "-" ? 1 : 0;
-    int16_t dscale   = 0;
-
-    auto pos = value->find('.');
-    bool existIntPart  = (
-        value->substr(sign, (pos == std::string::npos ? value->length() - sign : pos)) != "0");
-    bool existFracPart = (pos != std::string::npos || pos + 1 > value->length());
-
-    if (existIntPart) {
-        int beg = (sign != 0) ? 1 : 0;
-        int end = static_cast<int>(pos == std::string::npos ? value->length() : pos) - 1;
-
-        std::size_t count   = 0;
-        std::size_t notZeroPos = end;
-        for (auto i = end; i >= beg; --i) {
-            if (value->at(i) != '0')
-                notZeroPos = i;
-
-            if (++count == 4 || i == beg) {
-                auto zeroCount = notZeroPos - i;
-                int16_t digit = static_cast<int16_t>(
-                    std::stoi(value->substr(i + zeroCount, count - zeroCount)));
-                count = 0;
-                ++width;
-
-                if (!existFracPart && digit == 0 && !decimal.empty())
-                    continue;
-
-                decimal.emplace_front(htonT(digit));
-            }
-        }
-    }
-
-    if (existFracPart) {
-        std::size_t count = 0;
-        for (auto i = pos + 1, e = value->length(); i < e; ++i) {
-            if (++count == 4 || i + 1 == e) {
-                std::string sdigit = value->substr(i - count + 1, count);
-                if (count < 4)
-                    sdigit += std::string(4 - count, '0');
-                auto digit = static_cast<int16_t>(std::stoi(sdigit));
-                dscale = static_cast<int16_t>(dscale + count);
-                count = 0;
-
-                if (!existIntPart && digit == 0 && decimal.empty()) {
-                    --width;
-                    continue;
-                }
-
-                decimal.emplace_back(htonT(digit));
-            }
-        }
-    }
+    // Некорректная строка отличается от NULL наличием значения, см. isNullValue()
+    auto size = numericPgSize(*value);
+    if (size == 0)
+        return std::make_tuple(NUMERICOID, 0, nullptr);
 
-    ndigits = static_cast<int16_t>(decimal.size());
-    std::size_t size = 8 + ndigits * 2;
     auto *v = new char[size];
-    auto *vv = reinterpret_cast<int16_t *>(v);
+    numericToPg(*value, v);
+    return std::make_tuple(NUMERICOID, size, v);
+}
 
-    std::size_t it = 0;
-    vv[it++] = htonT(ndigits);
-    vv[it++] = htonT(width);
-    vv[it++] = htonT(sign);
-    vv[it++] = htonT(dscale);
+static std::tuple<unsigned int, std::size_t, char *> fromArray(const std::optional<SqlArray> &value)
+{
+    if (!value)
+        return std::make_tuple(0, 0, nullptr);
+
+    auto bytes = value->bytes();
+    char *v = new char[bytes.size()];
+    std::memcpy(v, bytes.data(), bytes.size());
+    return std::make_tuple(value->arrayType(), bytes.size(), v);
+}
+
+static std::tuple<unsigned int, std::size_t, char *> fromCustom(const std::optional<SqlCustom> &value)
+{
+    // Тип PostgreSql определяется соединением по наименованию типа
+    if (!value)
+        return std::make_tuple(0, 0, nullptr);
 
-    for (int16_t digit : decimal)
-        vv[it++] = digit;
+    char *v = new char[value->bytes.size()];
+    std::memcpy(v, value->bytes.data(), value->bytes.size());
+    return std::make_tuple(0, value->bytes.size(), v);
+}
+
+static std::tuple<unsigned int, std::size_t, char *> fromNumeric(
+    const std::optional<SqlDecimal> &value)
+{
+    if (!value)
+        return std::make_tuple(NUMERICOID, 0, nullptr);
 
+    auto size = value->pgSize();
+    auto *v = new char[size];
+    value->toPg(v);
     return std::make_tuple(NUMERICOID, size, v);
 }
 
@@ -561,6 +551,69 @@ static std::tuple<unsigned int, std::size_t, char *> fromDate(const std::optiona
     return std::make_tuple(DATEOID, 4, v);
 }
 
+static std::tuple<unsigned int, std::size_t, char *> fromTimePoint(
+    unsigned int oid, const std::optional<SqlTimePoint> &value)
+{
+    if (!value)
+        return std::make_tuple(oid, 0, nullptr);
+
+    int64_t usec = value->time_since_epoch().count() - POSTGRES_EPOCH_USEC;
+    if (*value == SqlTimePoint::max())
+        usec = std::numeric_limits<int64_t>::max();
+    else if (*value == SqlTimePoint::min())
+        usec = std::numeric_limits<int64_t>::min();
+
+    char *v = new char[8];
+    *reinterpret_cast<int64_t *>(v) = htonT(usec);
+
+    return std::make_tuple(oid, 8, v);
+}
+
+static std::tuple<unsigned int, std::size_t, char *> fromTimeUs(
+    const std::optional<std::chrono::microseconds> &value)
+{
+    if (!value)
+        return std::make_tuple(TIMEOID, 0, nullptr);
+
+    char *v = new char[8];
+    *reinterpret_cast<int64_t *>(v) = htonT(static_cast<int64_t>(value->count()));
+
+    return std::make_tuple(TIMEOID, 8, v);
+}
+
+static std::tuple<unsigned int, std::size_t, char *> fromDatePoint(
+    const std::optional<SqlDatePoint> &value)
+{
+    if (!value)
+        return std::make_tuple(DATEOID, 0, nullptr);
+
+    auto days = static_cast<int32_t>(
+        value->time_since_epoch().count() - POSTGRES_EPOCH_USEC / POSTGRES_DAY_USEC);
+    if (*value == SqlDatePoint::max())
+        days = std::numeric_limits<int32_t>::max();
+    else if (*value == SqlDatePoint::min())
+        days = std::numeric_limits<int32_t>::min();
+
+    char *v = new char[4];
+    *reinterpret_cast<int32_t *>(v) = htonT(days);
+
+    return std::make_tuple(DATEOID, 4, v);
+}
+
+static std::tuple<unsigned int, std::size_t, char *> fromInterval(
+    const std::optional<SqlInterval> &value)
+{
+    if (!value)
+        return std::make_tuple(INTERVALOID, 0, nullptr);
+
+    char *v = new char[16];
+    *reinterpret_cast<int64_t *>(v) = htonT(static_cast<int64_t>(value->time.count()));
+    *reinterpret_cast<int32_t *>(v + 8) = htonT(value->days);
+    *reinterpret_cast<int32_t *>(v + 12) = htonT(value->months);
+
+    return std::make_tuple(INTERVALOID, 16, v);
+}
+
 static std::tuple<unsigned int, std::size_t, char *> fromString(
     unsigned int oid, const std::optional<std::string> &value)
 {
@@ -575,6 +628,20 @@ static std::tuple<unsigned int, std::size_t, char *> fromString(
     return std::make_tuple(oid, size, v);
 }
 
+static std::tuple<unsigned int, std::size_t, char *> fromJsonb(
+    const std::optional<std::string> &value)
+{
+    if (!value)
+        return std::make_tuple(JSONBOID, 0, nullptr);
+
+    auto size = value->size() + 1;
+    char *v = new char[size];
+    v[0] = JSONB_VERSION;
+    std::memcpy(v + 1, value->data(), value->size());
+
+    return std::make_tuple(JSONBOID, size, v);
+}
+
 static std::tuple<unsigned int, std::size_t, char *> fromUuid(
     const std::optional<std::array<char, 16>> &value)
 {
@@ -603,6 +670,16 @@ static std::tuple<unsigned int, std::size_t, char *> fromBytea(
     return std::make_tuple(BYTEAOID, size, v);
 }
 
+bool isNullValue(const SqlValue &value)
+{
+    return std::visit([](const auto &alternative) {
+        if constexpr (std::is_same_v<std::decay_t<decltype(alternative)>, std::monostate>)
+            return true;
+        else
+            return !alternative.has_value();
+    }, value);
+}
+
 std::tuple<unsigned int, std::size_t, char *> asPgValue(const SqlValue &value)
 {
     switch (value.index()) {
@@ -620,6 +697,10 @@ std::tuple<unsigned int, std::size_t, char *> asPgValue(const SqlValue &value)
         return fromDouble(std::get<SqlType::Double>(value));
     case SqlType::Decimal:
         return fromDecimal(std::get<SqlType::Decimal>(value));
+    case SqlType::Numeric:
+        return fromNumeric(std::get<SqlType::Numeric>(value));
+    case SqlType::Array:
+        return fromArray(std::get<SqlType::Array>(value));
     case SqlType::TimeStamp:
         return fromTimeStamp(TIMESTAMPOID, std::get<SqlType::TimeStamp>(value));
     case SqlType::TimeStampTz:
@@ -630,6 +711,16 @@ std::tuple<unsigned int, std::size_t, char *> asPgValue(const SqlValue &value)
         return fromTime(TIMETZOID, std::get<SqlType::TimeTz>(value));
     case SqlType::Date:
         return fromDate(std::get<SqlType::Date>(value));
+    case SqlType::TimeStampUs:
+        return fromTimePoint(TIMESTAMPOID, std::get<SqlType::TimeStampUs>(value));
+    case SqlType::TimeStampTzUs:
+        return fromTimePoint(TIMESTAMPTZOID, std::get<SqlType::TimeStampTzUs>(value));
+    case SqlType::TimeUs:
+        return fromTimeUs(std::get<SqlType::TimeUs>(value));
+    case SqlType::DateDays:
+        return fromDatePoint(std::get<SqlType::DateDays>(value));
+    case SqlType::Interval:
+        return fromInterval(std::get<SqlType::Interval>(value));
     case SqlType::Bytea:
         return fromBytea(std::get<SqlType::Bytea>(value));
     case SqlType::Uuid:
@@ -646,6 +737,10 @@ std::tuple<unsigned int, std::size_t, char *> asPgValue(const SqlValue &value)
         return fromString(XMLOID, std::get<SqlType::Xml>(value));
     case SqlType::Text:
         return fromString(TEXTOID, std::get<SqlType::Text>(value));
+    case SqlType::Jsonb:
+        return fromJsonb(std::get<SqlType::Jsonb>(value));
+    case SqlType::Custom:
+        return fromCustom(std::get<SqlType::Custom>(value));
     default:
         break;
     }
@@ -653,6 +748,81 @@ std::tuple<unsigned int, std::size_t, char *> asPgValue(const SqlValue &value)
     return std::make_tuple(0, 0, nullptr);
 }
 
+std::optional<SqlParam> asPgParam(const SqlValue &value)
+{
+    switch (value.index()) {
+    case SqlType::Char:
+    case SqlType::Json:
+    case SqlType::Name:
+    case SqlType::Text:
+    case SqlType::VarChar:
+    case SqlType::Xml:
+    case SqlType::Jsonb: {
+        const auto type = static_cast<SqlType>(value.index());
+        const auto *str = std::visit([](const auto &alternative) -> const std::string * {
+            using T = std::decay_t<decltype(alternative)>;
+            if constexpr (std::is_same_v<T, std::optional<std::string>>)
+                return alternative ? &*alternative : nullptr;
+            else
+                return nullptr;
+        }, value);
+
+        SqlParam param;
+        param.oid = toPgType(type);
+        if (type == SqlType::Jsonb)
+            param.format = 0;
+        if (str) {
+            param.data = str->c_str();
+            param.length = static_cast<int>(str->size());
+        }
+        return param;
+    }
+    case SqlType::Bytea: {
+        const auto &bytes = std::get<SqlType::Bytea>(value);
+        SqlParam param;
+        param.oid = BYTEAOID;
+        if (bytes) {
+            param.data = bytes->data();
+            param.length = static_cast<int>(bytes->size());
+        }
+        return param;
+    }
+    case SqlType::Custom: {
+        // Тип PostgreSql определяется соединением по наименованию типа
+        const auto &custom = std::get<SqlType::Custom>(value);
+        SqlParam param;
+        if (custom) {
+            param.data = custom->bytes.data();
+            param.length = static_cast<int>(custom->bytes.size());
+        }
+        return param;
+    }
+    default:
+        break;
+    }
+    return std::nullopt;
+}
+
+SqlParam jsonbParam(const char *json)
+{
+    SqlParam param;
+    param.oid = JSONBOID;
+    param.data = json;
+    param.length = json ? static_cast<int>(std::strlen(json)) : 0;
+    param.format = 0;
+    return param;
+}
+
+SqlParam jsonbParam(const std::string &json)
+{
+    SqlParam param;
+    param.oid = JSONBOID;
+    param.data = json.c_str();
+    param.length = static_cast<int>(json.size());
+    param.format = 0;
+    return param;
+}
+
 unsigned int toPgType(SqlType type)
 {
     switch (type) {
@@ -669,17 +839,24 @@ unsigned int toPgType(SqlType type)
     case SqlType::Double:
         return FLOAT8OID;
     case SqlType::Decimal:
+    case SqlType::Numeric:
         return NUMERICOID;
     case SqlType::TimeStamp:
+    case SqlType::TimeStampUs:
         return TIMESTAMPOID;
     case SqlType::TimeStampTz:
+    case SqlType::TimeStampTzUs:
         return TIMESTAMPTZOID;
     case SqlType::Time:
+    case SqlType::TimeUs:
         return TIMEOID;
     case SqlType::TimeTz:
         return TIMETZOID;
     case SqlType::Date:
+    case SqlType::DateDays:
         return DATEOID;
+    case SqlType::Interval:
+        return INTERVALOID;
     case SqlType::Bytea:
         return BYTEAOID;
     case SqlType::Uuid:
@@ -696,23 +873,73 @@ unsigned int toPgType(SqlType type)
         return XMLOID;
     case SqlType::Text:
         return TEXTOID;
+    case SqlType::Jsonb:
+        return JSONBOID;
     default:
         break;
     }
     return 0;
 }
 
-std::string fromByteUuid(const std::array<char, 16> &uuid)
+SqlType toSqlType(unsigned int oid)
 {
-    static const char* digits = "0123456789abcdef";
-    std::string result;
-    result.reserve(36);
-    for (std::size_t i = 0; i < 16; ++i) {
-        if (i == 4 || i == 6 || i == 8 || i == 10)
-            result += '-';
-        result += digits[(uuid[i] >> 4) & 0xF];
-        result += digits[uuid[i] & 0xF];
+    switch (oid) {
+    case BOOLOID:
+        return SqlType::Boolean;
+    case INT2OID:
+        return SqlType::SmallInt;
+    case INT4OID:
+        return SqlType::Integer;
+    case INT8OID:
+        return SqlType::BigInt;
+    case FLOAT4OID:
+        return SqlType::Real;
+    case FLOAT8OID:
+        return SqlType::Double;
+    case NUMERICOID:
+        return SqlType::Decimal;
+    case TIMESTAMPOID:
+        return SqlType::TimeStamp;
+    case TIMESTAMPTZOID:
+        return SqlType::TimeStampTz;
+    case TIMEOID:
+        return SqlType::Time;
+    case TIMETZOID:
+        return SqlType::TimeTz;
+    case DATEOID:
+        return SqlType::Date;
+    case INTERVALOID:
+        return SqlType::Interval;
+    case BYTEAOID:
+        return SqlType::Bytea;
+    case UUIDOID:
+        return SqlType::Uuid;
+    case CHAROID:
+        return SqlType::Char;
+    case VARCHAROID:
+        return SqlType::VarChar;
+    case NAMEOID:
+        return SqlType::Name;
+    case JSONOID:
+        return SqlType::Json;
+    case XMLOID:
+        return SqlType::Xml;
+    case TEXTOID:
+        return SqlType::Text;
+    case JSONBOID:
+        return SqlType::Jsonb;
+    default:
+        if (toPgElementType(oid) != 0)
+            return SqlType::Array;
+        break;
     }
+    return SqlType::None;
+}
+
+std::string fromByteUuid(const std::array<char, 16> &uuid)
+{
+    std::string result(UuidTextSize, '\0');
+    uuidToChars(uuid.data(), result.data());
     return result;
 }
 
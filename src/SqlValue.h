@@ -2,6 +2,9 @@
 
 #include "global.h"
 
+#include "SqlArray.h"
+#include "SqlDecimal.h"
+
 #include <optional>
 #include <variant>
 #include <cstdint>
@@ -9,11 +12,39 @@
 #include <string>
 #include <vector>
 #include <array>
+#include <tuple>
 
 using PGresult = struct pg_result;
 
 namespace AsyncPg {
 
+/// Значение пользовательского типа PostgreSql в двоичном формате
+struct SqlCustom
+{
+    std::string        typeName;  ///< Наименование типа (pg_type.typname)
+    std::vector<char>  bytes;     ///< Значение в двоичном формате PostgreSql
+};
+
+/// Момент времени с точностью до микросекунды
+using SqlTimePoint = std::chrono::time_point<std::chrono::system_clock, std::chrono::microseconds>;
+
+/// Продолжительность в сутках
+using SqlDays = std::chrono::duration<int32_t, std::ratio<86400>>;
+
+/// Дата с точностью до суток
+using SqlDatePoint = std::chrono::time_point<std::chrono::system_clock, SqlDays>;
+
+/// Интервал времени PostgreSql
+///
+/// Месяцы и дни хранятся отдельно от времени, так как их
+/// продолжительность зависит от даты, к которой применяется интервал.
+struct SqlInterval
+{
+    std::chrono::microseconds  time{0};    ///< Время
+    int32_t                    days = 0;   ///< Количество дней
+    int32_t                    months = 0; ///< Количество месяцев
+};
+
 /// Значение поля строки результата Sql запроса
 using SqlValue = std::variant<
     std::monostate,
@@ -36,7 +67,16 @@ using SqlValue = std::variant<
     std::optional<std::time_t>,
     std::optional<std::time_t>,
     std::optional<std::array<char, 16>>,
-    std::optional<std::vector<char>>>;
+    std::optional<std::vector<char>>,
+    std::optional<SqlDecimal>,
+    std::optional<SqlArray>,
+    std::optional<std::string>,
+    std::optional<SqlCustom>,
+    std::optional<SqlTimePoint>,
+    std::optional<SqlTimePoint>,
+    std::optional<std::chrono::microseconds>,
+    std::optional<SqlDatePoint>,
+    std::optional<SqlInterval>>;
 
 /// Тип поля строки результата Sql запроса
 enum SqlType : size_t {
@@ -61,6 +101,15 @@ enum SqlType : size_t {
     TimeStampTz,
     Uuid,
     Bytea,
+    Numeric,
+    Array,
+    Jsonb,
+    Custom,
+    TimeStampUs,
+    TimeStampTzUs,
+    TimeUs,
+    DateDays,
+    Interval,
 };
 
 /// Конвертирует результат PostgreSql в значение поля строки результата Sql запроса
@@ -70,6 +119,16 @@ enum SqlType : size_t {
 /// @return Значение поля строки результата Sql запроса
 ASYNCPGLIB SqlValue asSqlValue(PGresult* pgresult, int row, int col);
 
+/// Конвертирует значение PostgreSql в значение поля строки результата Sql запроса
+/// @param oid Тип PostgreSql
+/// @param data Значение PostgreSql в двоичном формате (nullptr - NULL)
+/// @param length Длина значения PostgreSql
+/// @param type Желаемый тип поля строки результата Sql запроса
+///             (SqlType::None - тип по умолчанию для oid)
+/// @return Значение поля строки результата Sql запроса
+ASYNCPGLIB SqlValue asSqlValue(
+    unsigned int oid, const char *data, int length, SqlType type = SqlType::None);
+
 /// Создаёт значение поля строки результата Sql запроса
 /// @param I Тип поля строки результата Sql запроса
 /// @param Args Типы значений
@@ -81,16 +140,56 @@ SqlValue makeSqlValue(Args&&... args) {
 }
 
 /// Конвертирует значение поля строки результата Sql запроса в значение PostgreSql
+///
+/// Для некорректного значения (например, строки SqlType::Decimal, не являющейся числом)
+/// возвращаются пустые данные, как для NULL, см. isNullValue().
 /// @param value Значение поля строки результата Sql запроса
 /// @return Значение PostgreSql
 ASYNCPGLIB std::tuple<unsigned int, std::size_t, char *> asPgValue(const SqlValue &value);
 
+/// Проверяет равно ли значение поля строки результата Sql запроса NULL
+/// @param value Значение поля строки результата Sql запроса
+/// @return Результат проверки
+ASYNCPGLIB bool isNullValue(const SqlValue &value);
+
+/// Параметр Sql запроса, ссылающийся на данные вызывающей стороны
+struct SqlParam
+{
+    unsigned int  oid = 0;          ///< Тип PostgreSql
+    const char   *data = nullptr;   ///< Данные параметра (nullptr - NULL)
+    int           length = 0;       ///< Длина данных параметра
+    int           format = 1;       ///< Формат данных (0 - текстовый, 1 - двоичный)
+};
+
+/// Возвращает параметр Sql запроса, ссылающийся на данные значения без копирования
+///
+/// Строки и массивы байт передаются в двоичном формате, jsonb - в текстовом.
+/// Параметр действителен, пока существует значение.
+/// @param value Значение поля строки результата Sql запроса
+/// @return Параметр Sql запроса или std::nullopt, если значение требует кодирования
+ASYNCPGLIB std::optional<SqlParam> asPgParam(const SqlValue &value);
+
+/// Создаёт параметр jsonb, ссылающийся на строку без копирования
+/// @param json Строка JSON, завершающаяся нулевым символом
+/// @return Параметр Sql запроса
+ASYNCPGLIB SqlParam jsonbParam(const char *json);
+
+/// Создаёт параметр jsonb, ссылающийся на строку без копирования
+/// @param json Строка JSON
+/// @return Параметр Sql запроса
+ASYNCPGLIB SqlParam jsonbParam(const std::string &json);
+
 
 /// Конвертирует тип поля строки результата Sql запроса в тип PostgreSql
 /// @param type Тип поля строки результата Sql запроса
 /// @return Тип PostgreSql
 ASYNCPGLIB unsigned int toPgType(SqlType type);
 
+/// Конвертирует тип PostgreSql в тип поля строки результата Sql запроса
+/// @param oid Тип PostgreSql
+/// @return Тип поля строки результата Sql запроса
+ASYNCPGLIB SqlType toSqlType(unsigned int oid);
+
 /// Конвертирует строку в глобальный идентификатор
 /// @param str Строка
 /// @return Глобальный идентификатор
@@ -0,0 +1,701 @@
+﻿#include "SqlWriter.h"
+#include "SqlArray.h"
+#include "SqlHex.h"
+#include "SqlOid.h"
+
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string_view>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define ASYNCPG_SSE2
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace AsyncPg {
+
+/// Формат записи значений
+enum class TextFormat { Csv, Json };
+
+template <typename T>
+static void appendNumber(std::string &buffer, T value)
+{
+    char digits[32];
+    auto [end, ec] = std::to_chars(digits, digits + sizeof(digits), value);
+    buffer.append(digits, end);
+}
+
+template <typename T>
+static void appendFloat(std::string &buffer, T value, TextFormat format)
+{
+    if (std::isfinite(value)) {
+        appendNumber(buffer, value);
+    } else if (format == TextFormat::Json) {
+        buffer += "null";
+    } else if (std::isnan(value)) {
+        buffer += "NaN";
+    } else {
+        buffer += (value < 0) ? "-Infinity" : "Infinity";
+    }
+}
+
+static void appendPadded(std::string &buffer, int64_t value, int width)
+{
+    char digits[24];
+    auto [end, ec] = std::to_chars(digits, digits + sizeof(digits), value);
+    for (auto size = end - digits; size < width; ++size)
+        buffer += '0';
+    buffer.append(digits, end);
+}
+
+/// Записывает дату по количеству дней от эпохи Unix
+///
+/// Годы до нашей эры записываются как на сервере: 0044-03-15 вместо -0043-03-15,
+/// признак BC записывает вызывающая сторона после значения.
+/// @return Признак даты до нашей эры
+static bool appendDate(std::string &buffer, int64_t days)
+{
+    days += 719468;
+    const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    const int64_t doe = days - era * 146097;
+    const int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const int64_t mp = (5 * doy + 2) / 153;
+    const int64_t day = doy - (153 * mp + 2) / 5 + 1;
+    const int64_t month = mp < 10 ? mp + 3 : mp - 9;
+    const int64_t year = yoe + era * 400 + (month <= 2 ? 1 : 0);
+
+    appendPadded(buffer, year > 0 ? year : 1 - year, 4);
+    buffer += '-';
+    appendPadded(buffer, month, 2);
+    buffer += '-';
+    appendPadded(buffer, day, 2);
+    return year <= 0;
+}
+
+/// Записывает дробную часть секунды без завершающих нулей
+static void appendFraction(std::string &buffer, int64_t usec)
+{
+    if (usec == 0)
+        return;
+
+    buffer += '.';
+    int width = 6;
+    while (usec % 10 == 0) {
+        usec /= 10;
+        --width;
+    }
+    appendPadded(buffer, usec, width);
+}
+
+/// Записывает время по количеству микросекунд от начала суток
+static void appendTime(std::string &buffer, int64_t usec)
+{
+    appendPadded(buffer, usec / 3600000000, 2);
+    buffer += ':';
+    appendPadded(buffer, usec / 60000000 % 60, 2);
+    buffer += ':';
+    appendPadded(buffer, usec / 1000000 % 60, 2);
+    appendFraction(buffer, usec % 1000000);
+}
+
+static void appendZone(std::string &buffer, int32_t seconds)
+{
+    buffer += seconds < 0 ? '-' : '+';
+    seconds = std::abs(seconds);
+    appendPadded(buffer, seconds / 3600, 2);
+    buffer += ':';
+    appendPadded(buffer, seconds / 60 % 60, 2);
+}
+
+/// Записывает интервал в формате ISO 8601
+static void appendInterval(std::string &buffer, const char *data)
+{
+    const auto usec = readBigEndian<int64_t>(data);
+    const auto days = readBigEndian<int32_t>(data + 8);
+    const auto months = readBigEndian<int32_t>(data + 12);
+
+    buffer += 'P';
+    if (months / 12 != 0) {
+        appendNumber(buffer, months / 12);
+        buffer += 'Y';
+    }
+    if (months % 12 != 0) {
+        appendNumber(buffer, months % 12);
+        buffer += 'M';
+    }
+    if (days != 0) {
+        appendNumber(buffer, days);
+        buffer += 'D';
+    }
+    if (usec == 0 && (months != 0 || days != 0))
+        return;
+
+    buffer += 'T';
+    const auto hours = usec / 3600000000;
+    const auto minutes = usec / 60000000 % 60;
+    const auto seconds = usec % 60000000;
+    if (hours != 0) {
+        appendNumber(buffer, hours);
+        buffer += 'H';
+    }
+    if (minutes != 0) {
+        appendNumber(buffer, minutes);
+        buffer += 'M';
+    }
+    if (seconds != 0 || usec == 0) {
+        if (seconds < 0)
+            buffer += '-';
+        appendNumber(buffer, std::abs(seconds) / 1000000);
+        appendFraction(buffer, std::abs(seconds) % 1000000);
+        buffer += 'S';
+    }
+}
+
+/// Записывает дату PostgreSql, infinity и -infinity записываются как на сервере
+static void appendPgDate(std::string &buffer, int32_t days)
+{
+    if (days == std::numeric_limits<int32_t>::max())
+        buffer += "infinity";
+    else if (days == std::numeric_limits<int32_t>::min())
+        buffer += "-infinity";
+    else if (appendDate(buffer, days + POSTGRES_EPOCH_DAYS))
+        buffer += " BC";
+}
+
+static void appendTimeStamp(std::string &buffer, int64_t usec, char separator, bool withZone)
+{
+    if (usec == std::numeric_limits<int64_t>::max()) {
+        buffer += "infinity";
+        return;
+    }
+    if (usec == std::numeric_limits<int64_t>::min()) {
+        buffer += "-infinity";
+        return;
+    }
+
+    usec += POSTGRES_EPOCH_USEC;
+    auto days = usec / POSTGRES_DAY_USEC;
+    auto time = usec % POSTGRES_DAY_USEC;
+    if (time < 0) {
+        time += POSTGRES_DAY_USEC;
+        --days;
+    }
+    const bool isBc = appendDate(buffer, days);
+    buffer += separator;
+    appendTime(buffer, time);
+    if (withZone)
+        appendZone(buffer, 0);
+    if (isBc)
+        buffer += " BC";
+}
+
+static void appendHex(std::string &buffer, const char *data, std::size_t size)
+{
+    auto pos = buffer.size();
+    buffer.resize(pos + size * 2);
+    hexEncode(data, size, buffer.data() + pos);
+}
+
+static void appendUuid(std::string &buffer, const char *data)
+{
+    auto pos = buffer.size();
+    buffer.resize(pos + UuidTextSize);
+    uuidToChars(data, buffer.data() + pos);
+}
+
+static bool isJsonSpecial(char c)
+{
+    return c == '"' || c == '\\' || static_cast<unsigned char>(c) < 0x20;
+}
+
+/// Ищет первый символ, требующий экранирования в JSON строке
+static std::size_t findJsonSpecial(const char *data, std::size_t pos, std::size_t size)
+{
+#ifdef ASYNCPG_SSE2
+    const auto quote = _mm_set1_epi8('"');
+    const auto backslash = _mm_set1_epi8('\\');
+    const auto control = _mm_set1_epi8(0x1F);
+    const auto zero = _mm_setzero_si128();
+    for (; pos + 16 <= size; pos += 16) {
+        auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + pos));
+        auto mask = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+            _mm_cmpeq_epi8(_mm_subs_epu8(chunk, control), zero));
+        auto bits = static_cast<unsigned int>(_mm_movemask_epi8(mask));
+        if (bits != 0) {
+#ifdef _MSC_VER
+            unsigned long index;
+            _BitScanForward(&index, bits);
+            return pos + index;
+#else
+            return pos + static_cast<std::size_t>(__builtin_ctz(bits));
+#endif
+        }
+    }
+#endif
+    for (; pos < size; ++pos) {
+        if (isJsonSpecial(data[pos]))
+            return pos;
+    }
+    return size;
+}
+
+static void appendJsonString(std::string &buffer, const char *data, std::size_t size)
+{
+    static const char *digits = "0123456789abcdef";
+
+    buffer += '"';
+    std::size_t pos = 0;
+    while (pos < size) {
+        auto next = findJsonSpecial(data, pos, size);
+        buffer.append(data + pos, next - pos);
+        if (next == size)
+            break;
+
+        switch (data[next]) {
+        case '"':
+            buffer += "\\\"";
+            break;
+        case '\\':
+            buffer += "\\\\";
+            break;
+        case '\n':
+            buffer += "\\n";
+            break;
+        case '\r':
+            buffer += "\\r";
+            break;
+        case '\t':
+            buffer += "\\t";
+            break;
+        case '\b':
+            buffer += "\\b";
+            break;
+        case '\f':
+            buffer += "\\f";
+            break;
+        default:
+            buffer += "\\u00";
+            buffer += digits[(data[next] >> 4) & 0xF];
+            buffer += digits[data[next] & 0xF];
+            break;
+        }
+        pos = next + 1;
+    }
+    buffer += '"';
+}
+
+static void appendCsvString(std::string &buffer, const char *data, std::size_t size)
+{
+    bool quoted = (size == 0);
+    for (std::size_t i = 0; i < size && !quoted; ++i)
+        quoted = (data[i] == ',' || data[i] == '"' || data[i] == '\n' || data[i] == '\r');
+
+    if (!quoted) {
+        buffer.append(data, size);
+        return;
+    }
+
+    buffer += '"';
+    for (std::size_t i = 0; i < size; ++i) {
+        if (data[i] == '"')
+            buffer += '"';
+        buffer += data[i];
+    }
+    buffer += '"';
+}
+
+static void appendString(std::string &buffer, const char *data, std::size_t size, TextFormat format)
+{
+    if (format == TextFormat::Json)
+        appendJsonString(buffer, data, size);
+    else
+        appendCsvString(buffer, data, size);
+}
+
+/// Записывает значение, сформированное во временном буфере, в виде строки
+template <typename F>
+static void appendQuoted(std::string &buffer, TextFormat format, F func)
+{
+    if (format == TextFormat::Json)
+        buffer += '"';
+    func();
+    if (format == TextFormat::Json)
+        buffer += '"';
+}
+
+/// Записывает значение, полученное в текстовом формате PostgreSql
+static void appendTextValue(
+    std::string &buffer, unsigned int oid, const char *data, std::size_t size, TextFormat format)
+{
+    switch (oid) {
+    case BOOLOID:
+        if (format == TextFormat::Json)
+            buffer += (size > 0 && *data == 't') ? "true" : "false";
+        else
+            buffer.append(data, size);
+        break;
+    case INT2OID:
+    case INT4OID:
+    case INT8OID:
+    case FLOAT4OID:
+    case FLOAT8OID:
+    case NUMERICOID:
+        // NaN и Infinity не являются числами JSON
+        if (format == TextFormat::Json && (size == 0 || data[size - 1] < '0' || data[size - 1] > '9'))
+            buffer += "null";
+        else
+            buffer.append(data, size);
+        break;
+    case JSONOID:
+    case JSONBOID:
+        if (format == TextFormat::Json)
+            buffer.append(data, size);
+        else
+            appendCsvString(buffer, data, size);
+        break;
+    default:
+        appendString(buffer, data, size, format);
+        break;
+    }
+}
+
+static void appendBinaryValue(
+    std::string &buffer, unsigned int oid, const char *data, std::size_t length, TextFormat format);
+
+/// Записывает текст элемента массива, заключая его в кавычки как на сервере
+static void appendArrayElement(std::string &buffer, std::string_view text)
+{
+    bool quoted = text.empty();
+    if (text.size() == 4) {
+        // Строка NULL в любом регистре отличается от значения NULL кавычками
+        quoted = true;
+        for (std::size_t i = 0; i < 4 && quoted; ++i)
+            quoted = std::toupper(static_cast<unsigned char>(text[i])) == "NULL"[i];
+    }
+    for (std::size_t i = 0; i < text.size() && !quoted; ++i) {
+        const auto c = text[i];
+        quoted = c == '{' || c == '}' || c == ',' || c == '"' || c == '\\' || c == ' '
+            || (c >= '\t' && c <= '\r');
+    }
+
+    if (!quoted) {
+        buffer += text;
+        return;
+    }
+
+    buffer += '"';
+    for (auto c : text) {
+        if (c == '"' || c == '\\')
+            buffer += '\\';
+        buffer += c;
+    }
+    buffer += '"';
+}
+
+/// Записывает текстовое представление элемента массива в формате CSV без экранирования строк
+static void appendElementText(
+    std::string &buffer, unsigned int oid, const char *data, std::size_t length)
+{
+    switch (oid) {
+    case CHAROID:
+    case NAMEOID:
+    case XMLOID:
+    case VARCHAROID:
+    case TEXTOID:
+    case JSONOID:
+        buffer.append(data, length);
+        break;
+    case JSONBOID:
+        // Значение jsonb начинается с байта версии формата
+        if (length > 0)
+            buffer.append(data + 1, length - 1);
+        break;
+    default:
+        appendBinaryValue(buffer, oid, data, length, TextFormat::Csv);
+        break;
+    }
+}
+
+/// Записывает измерение массива: JSON массив или литерал массива PostgreSql
+/// @return Результат операции (false - данные массива повреждены)
+static bool appendArrayDim(std::string &buffer, unsigned int elementType, const int32_t *dims,
+                           int ndim, const char *&pos, const char *end, TextFormat format)
+{
+    const bool isJson = format == TextFormat::Json;
+    buffer += isJson ? '[' : '{';
+    for (int32_t i = 0; i < dims[0]; ++i) {
+        if (i != 0)
+            buffer += ',';
+        if (ndim > 1) {
+            if (!appendArrayDim(buffer, elementType, dims + 1, ndim - 1, pos, end, format))
+                return false;
+            continue;
+        }
+
+        if (end - pos < 4)
+            return false;
+        const auto length = readBigEndian<int32_t>(pos);
+        pos += 4;
+        if (length < 0) {
+            buffer += isJson ? "null" : "NULL";
+            continue;
+        }
+        if (end - pos < length)
+            return false;
+
+        if (isJson) {
+            appendBinaryValue(buffer, elementType, pos, static_cast<std::size_t>(length), format);
+        } else {
+            std::string text;
+            appendElementText(text, elementType, pos, static_cast<std::size_t>(length));
+            appendArrayElement(buffer, text);
+        }
+        pos += length;
+    }
+    buffer += isJson ? ']' : '}';
+    return true;
+}
+
+/// Записывает массив PostgreSql в двоичном формате
+/// @return Результат операции (false - данные массива повреждены)
+static bool appendArray(std::string &buffer, const char *data, std::size_t length, TextFormat format)
+{
+    // Количество измерений ограничено сервером (MAXDIM)
+    constexpr int MaxDims = 6;
+    if (length < 12)
+        return false;
+    const auto ndim = readBigEndian<int32_t>(data);
+    const auto elementType = readBigEndian<uint32_t>(data + 8);
+    if (ndim < 0 || ndim > MaxDims || length < 12 + static_cast<std::size_t>(ndim) * 8)
+        return false;
+
+    int32_t dims[MaxDims] = {};
+    for (int i = 0; i < ndim; ++i) {
+        dims[i] = readBigEndian<int32_t>(data + 12 + i * 8);
+        if (dims[i] < 0)
+            return false;
+    }
+
+    const char *pos = data + 12 + ndim * 8;
+    const char *end = data + length;
+    if (format == TextFormat::Json) {
+        if (ndim == 0) {
+            buffer += "[]";
+            return true;
+        }
+        return appendArrayDim(buffer, elementType, dims, ndim, pos, end, format);
+    }
+
+    std::string text;
+    if (ndim == 0)
+        text = "{}";
+    else if (!appendArrayDim(text, elementType, dims, ndim, pos, end, format))
+        return false;
+    appendCsvString(buffer, text.data(), text.size());
+    return true;
+}
+
+/// Записывает значение в двоичном формате PostgreSql
+static void appendBinaryValue(
+    std::string &buffer, unsigned int oid, const char *data, std::size_t length, TextFormat format)
+{
+    switch (oid) {
+    case BOOLOID:
+        if (format == TextFormat::Json)
+            buffer += (*data != 0) ? "true" : "false";
+        else
+            buffer += (*data != 0) ? 't' : 'f';
+        break;
+    case INT2OID:
+        appendNumber(buffer, readBigEndian<int16_t>(data));
+        break;
+    case INT4OID:
+        appendNumber(buffer, readBigEndian<int32_t>(data));
+        break;
+    case INT8OID:
+        appendNumber(buffer, readBigEndian<int64_t>(data));
+        break;
+    case FLOAT4OID: {
+        float value;
+        auto bits = readBigEndian<int32_t>(data);
+        std::memcpy(&value, &bits, sizeof(value));
+        appendFloat(buffer, value, format);
+    } break;
+    case FLOAT8OID: {
+        double value;
+        auto bits = readBigEndian<int64_t>(data);
+        std::memcpy(&value, &bits, sizeof(value));
+        appendFloat(buffer, value, format);
+    } break;
+    case NUMERICOID: {
+        const auto pos = buffer.size();
+        const auto size = static_cast<int>(length);
+        buffer.resize(pos + numericTextSize(data, size));
+        auto *end = numericToChars(data, size, buffer.data() + pos);
+        buffer.resize(static_cast<std::size_t>(end - buffer.data()));
+        if (format == TextFormat::Json && buffer.back() > '9') {
+            buffer.resize(pos);
+            buffer += "null";
+        }
+    } break;
+    case DATEOID:
+        appendQuoted(buffer, format, [&]() {
+            appendPgDate(buffer, readBigEndian<int32_t>(data));
+        });
+        break;
+    case TIMEOID:
+        appendQuoted(buffer, format, [&]() { appendTime(buffer, readBigEndian<int64_t>(data)); });
+        break;
+    case TIMETZOID:
+        appendQuoted(buffer, format, [&]() {
+            appendTime(buffer, readBigEndian<int64_t>(data));
+            appendZone(buffer, -readBigEndian<int32_t>(data + 8));
+        });
+        break;
+    case TIMESTAMPOID:
+        appendQuoted(buffer, format, [&]() {
+            appendTimeStamp(buffer, readBigEndian<int64_t>(data),
+                            format == TextFormat::Json ? 'T' : ' ', false);
+        });
+        break;
+    case TIMESTAMPTZOID:
+        appendQuoted(buffer, format, [&]() {
+            appendTimeStamp(buffer, readBigEndian<int64_t>(data),
+                            format == TextFormat::Json ? 'T' : ' ', true);
+        });
+        break;
+    case INTERVALOID:
+        appendQuoted(buffer, format, [&]() { appendInterval(buffer, data); });
+        break;
+    case UUIDOID:
+        appendQuoted(buffer, format, [&]() { appendUuid(buffer, data); });
+        break;
+    case BYTEAOID:
+        appendQuoted(buffer, format, [&]() {
+            buffer += (format == TextFormat::Json) ? "\\\\x" : "\\x";
+            appendHex(buffer, data, length);
+        });
+        break;
+    case JSONOID:
+        if (format == TextFormat::Json)
+            buffer.append(data, length);
+        else
+            appendCsvString(buffer, data, length);
+        break;
+    case JSONBOID: {
+        // Значение jsonb начинается с байта версии формата
+        const auto *json = (length > 0) ? data + 1 : data;
+        const auto size = (length > 0) ? length - 1 : 0;
+        if (format == TextFormat::Json)
+            buffer.append(json, size);
+        else
+            appendCsvString(buffer, json, size);
+    } break;
+    case CHAROID:
+    case NAMEOID:
+    case XMLOID:
+    case VARCHAROID:
+    case TEXTOID:
+        appendString(buffer, data, length, format);
+        break;
+    default: {
+        // Массивы записываются JSON массивом или литералом массива, значения
+        // пользовательских типов - шестнадцатеричным двоичным значением, как bytea
+        const auto pos = buffer.size();
+        if (toPgElementType(oid) != 0 && appendArray(buffer, data, length, format))
+            break;
+        buffer.resize(pos);
+        appendQuoted(buffer, format, [&]() {
+            buffer += (format == TextFormat::Json) ? "\\\\x" : "\\x";
+            appendHex(buffer, data, length);
+        });
+    } break;
+    }
+}
+
+static void appendValue(
+    std::string &buffer, const SqlResult &result, int row, int col, TextFormat format)
+{
+    if (result.isNull(row, col)) {
+        if (format == TextFormat::Json)
+            buffer += "null";
+        return;
+    }
+
+    const auto *data = result.data(row, col);
+    const auto length = static_cast<std::size_t>(result.length(row, col));
+    if (result.format(col) == 0)
+        appendTextValue(buffer, result.type(col), data, length, format);
+    else
+        appendBinaryValue(buffer, result.type(col), data, length, format);
+}
+
+static int rowCount(const SqlResult &result, int row, int count)
+{
+    if (row < 0 || row > result.rows())
+        return 0;
+    return (count < 0 || row + count > result.rows()) ? result.rows() - row : count;
+}
+
+void writeCsvHeader(const SqlResult &result, std::string &buffer)
+{
+    for (int col = 0, columns = result.columns(); col < columns; ++col) {
+        if (col != 0)
+            buffer += ',';
+        auto name = result.fieldName(col);
+        appendCsvString(buffer, name.data(), name.size());
+    }
+    buffer += '\n';
+}
+
+void writeCsv(const SqlResult &result, std::string &buffer, int row, int count)
+{
+    count = rowCount(result, row, count);
+    for (auto i = row, e = row + count; i < e; ++i) {
+        for (int col = 0, columns = result.columns(); col < columns; ++col) {
+            if (col != 0)
+                buffer += ',';
+            appendValue(buffer, result, i, col, TextFormat::Csv);
+        }
+        buffer += '\n';
+    }
+}
+
+void writeJson(const SqlResult &result, std::string &buffer, int row, int count)
+{
+    count = rowCount(result, row, count);
+
+    std::string names;
+    std::vector<std::size_t> offsets{0};
+    for (int col = 0, columns = result.columns(); col < columns; ++col) {
+        names += (col == 0) ? "{" : ",";
+        auto name = result.fieldName(col);
+        appendJsonString(names, name.data(), name.size());
+        names += ':';
+        offsets.push_back(names.size());
+    }
+
+    for (auto i = row, e = row + count; i < e; ++i) {
+        if (i != 0)
+            buffer += ',';
+        for (int col = 0, columns = result.columns(); col < columns; ++col) {
+            buffer.append(names, offsets[col], offsets[col + 1] - offsets[col]);
+            appendValue(buffer, result, i, col, TextFormat::Json);
+        }
+        buffer += (result.columns() == 0) ? "{}" : "}";
+    }
+}
+
+}
@@ -0,0 +1,38 @@
+﻿#pragma once
+
+#include "global.h"
+
+#include "SqlResult.h"
+
+#include <string>
+
+namespace AsyncPg {
+
+/// Записывает заголовок CSV с наименованиями колонок результата Sql запроса
+/// @param result Результат Sql запроса
+/// @param buffer Буфер, в конец которого производится запись
+ASYNCPGLIB void writeCsvHeader(const SqlResult &result, std::string &buffer);
+
+/// Записывает строки результата Sql запроса в формате CSV
+///
+/// Массивы записываются литералом массива PostgreSql, значения пользовательских
+/// типов - шестнадцатеричным двоичным значением, как bytea.
+/// @param result Результат Sql запроса
+/// @param buffer Буфер, в конец которого производится запись
+/// @param row Номер первой записываемой строки
+/// @param count Количество записываемых строк (-1 - до конца результата)
+ASYNCPGLIB void writeCsv(const SqlResult &result, std::string &buffer, int row = 0, int count = -1);
+
+/// Записывает строки результата Sql запроса в виде JSON объектов, разделённых запятыми
+///
+/// Если row больше нуля, то запятая ставится и перед первой строкой, поэтому
+/// последовательно записанные порции строк образуют тело JSON массива.
+/// Массивы записываются JSON массивами, значения пользовательских типов -
+/// шестнадцатеричным двоичным значением, как bytea.
+/// @param result Результат Sql запроса
+/// @param buffer Буфер, в конец которого производится запись
+/// @param row Номер первой записываемой строки
+/// @param count Количество записываемых строк (-1 - до конца результата)
+ASYNCPGLIB void writeJson(const SqlResult &result, std::string &buffer, int row = 0, int count = -1);
+
+}
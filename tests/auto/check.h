@@ -0,0 +1,30 @@
+﻿#pragma once
+
+#include <iostream>
+
+/// Возвращает количество непройденных проверок
+/// @return Количество непройденных проверок
+inline int &checkFailures()
+{
+    static int failures = 0;
+    return failures;
+}
+
+/// Проверяет условие и выводит место непройденной проверки
+#define CHECK(expr)                                                                  \
+    do {                                                                             \
+        if (!(expr)) {                                                               \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #expr ") failed"  \
+                      << std::endl;                                                  \
+            ++checkFailures();                                                       \
+        }                                                                            \
+    } while (false)
+
+/// Возвращает код завершения теста
+/// @return 0 - все проверки пройдены
+inline int checkResult()
+{
+    if (checkFailures() != 0)
+        std::cerr << checkFailures() << " check(s) failed" << std::endl;
+    return checkFailures() == 0 ? 0 : 1;
+}
@@ -0,0 +1,172 @@
+﻿#include "../check.h"
+
+#include <asyncpg/SqlArray.h>
+#include <asyncpg/SqlDecimal.h>
+
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using AsyncPg::SqlArray;
+using AsyncPg::SqlDecimal;
+
+/// Типы PostgreSql массивов
+static constexpr unsigned int BoolArray = 1000;
+static constexpr unsigned int Int2Array = 1005;
+static constexpr unsigned int Int4Array = 1007;
+static constexpr unsigned int TextArray = 1009;
+static constexpr unsigned int Int8Array = 1016;
+static constexpr unsigned int Float4Array = 1021;
+static constexpr unsigned int Float8Array = 1022;
+static constexpr unsigned int NumericArray = 1231;
+static constexpr unsigned int UuidArray = 2951;
+
+/// Создаёт массив, передаёт его через двоичное значение PostgreSql и возвращает значения элементов
+template<class T>
+static std::vector<T> roundTrip(const std::vector<T> &values, unsigned int arrayType, SqlArray &copy)
+{
+    const auto array = SqlArray::from(values);
+    CHECK(array.arrayType() == arrayType);
+    CHECK(AsyncPg::toPgElementType(arrayType) == array.elementType());
+    CHECK(array.size() == static_cast<int>(values.size()));
+    CHECK(!array.hasNulls());
+
+    const auto bytes = array.bytes();
+    copy = SqlArray::fromPg(bytes.data(), static_cast<int>(bytes.size()));
+    CHECK(copy.bytes() == bytes);
+    return copy.values<T>();
+}
+
+template<class T>
+static void checkRoundTrip(const std::vector<T> &values, unsigned int arrayType)
+{
+    SqlArray copy;
+    CHECK(roundTrip(values, arrayType, copy) == values);
+}
+
+static void testScalars()
+{
+    checkRoundTrip<bool>({true, false, true}, BoolArray);
+    checkRoundTrip<int16_t>({0, -1, std::numeric_limits<int16_t>::min(), std::numeric_limits<int16_t>::max()}, Int2Array);
+    checkRoundTrip<int32_t>({0, -1, std::numeric_limits<int32_t>::min(), std::numeric_limits<int32_t>::max()}, Int4Array);
+    checkRoundTrip<int64_t>({0, -1, std::numeric_limits<int64_t>::min(), std::numeric_limits<int64_t>::max()}, Int8Array);
+    checkRoundTrip<float>({0.0f, -1.5f, std::numeric_limits<float>::max(), std::numeric_limits<float>::infinity()}, Float4Array);
+    checkRoundTrip<double>({0.0, -1.5, std::numeric_limits<double>::min(), -std::numeric_limits<double>::infinity()},
+                           Float8Array);
+
+    SqlArray copy;
+    const auto nans = roundTrip<double>({std::nan("")}, Float8Array, copy);
+    CHECK(nans.size() == 1 && std::isnan(nans.front()));
+}
+
+static void testStrings()
+{
+    const std::vector<std::string> strings = {"", "abc", std::string("a\0b", 3), "строка", std::string(1000, 'x')};
+    checkRoundTrip(strings, TextArray);
+
+    const std::vector<std::string_view> views(strings.begin(), strings.end());
+    SqlArray copy;
+    const auto values = roundTrip(views, TextArray, copy);
+    CHECK(values == views);
+
+    // Значения std::string_view ссылаются на данные массива
+    const auto bytes = copy.bytes();
+    for (const auto &value : values)
+        CHECK(value.data() >= bytes.data() && value.data() + value.size() <= bytes.data() + bytes.size());
+}
+
+static void testUuids()
+{
+    std::array<char, 16> first{};
+    std::array<char, 16> second{};
+    for (std::size_t i = 0; i < second.size(); ++i)
+        second[i] = static_cast<char>(0xF0 + i);
+    checkRoundTrip<std::array<char, 16>>({first, second}, UuidArray);
+}
+
+static void testDecimals()
+{
+    std::vector<SqlDecimal> decimals;
+    for (const char *text : {"0", "-12.345", "340282366920938463463374607431768211456.5", "NaN", "Infinity", "-Infinity"})
+        decimals.push_back(*SqlDecimal::fromString(text));
+
+    SqlArray copy;
+    const auto values = roundTrip(decimals, NumericArray, copy);
+    CHECK(values.size() == decimals.size());
+    for (std::size_t i = 0; i < values.size() && i < decimals.size(); ++i)
+        CHECK(values[i].toString() == decimals[i].toString());
+}
+
+static void testEmpty()
+{
+    checkRoundTrip<bool>({}, BoolArray);
+    checkRoundTrip<int32_t>({}, Int4Array);
+    checkRoundTrip<std::string>({}, TextArray);
+    checkRoundTrip<std::array<char, 16>>({}, UuidArray);
+    SqlArray copy;
+    CHECK(roundTrip<SqlDecimal>({}, NumericArray, copy).empty());
+
+    const auto array = SqlArray::from<int64_t>(nullptr, 0);
+    CHECK(array.bytes().size() == 12);
+    CHECK(array.values<int64_t>().empty());
+
+    const SqlArray none;
+    CHECK(none.size() == 0 && none.elementType() == 0 && none.arrayType() == 0);
+    CHECK(none.values<int32_t>().empty());
+}
+
+static void testConversions()
+{
+    // Меньшие целочисленные типы расширяются, большие не сужаются
+    const auto array = SqlArray::from<int16_t>({-7, 7});
+    CHECK((array.values<int32_t>() == std::vector<int32_t>{-7, 7}));
+    CHECK((array.values<int64_t>() == std::vector<int64_t>{-7, 7}));
+    CHECK(SqlArray::from<int64_t>({1}).values<int32_t>().empty());
+    CHECK(SqlArray::from<int32_t>({1}).values<std::string>().empty());
+}
+
+static void testNulls()
+{
+    // int4[] {1, NULL, 3}
+    const unsigned char data[] = {0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 23, 0, 0, 0, 3, 0, 0, 0, 1,
+                                  0, 0, 0, 4, 0, 0, 0, 1, 0xFF, 0xFF, 0xFF, 0xFF, 0, 0, 0, 4, 0, 0, 0, 3};
+    const auto array = SqlArray::fromPg(reinterpret_cast<const char *>(data), static_cast<int>(sizeof(data)));
+    CHECK(array.hasNulls());
+    CHECK(array.size() == 3);
+    CHECK((array.values<int32_t>() == std::vector<int32_t>{1, 0, 3}));
+}
+
+static void testMalformed()
+{
+    // Количество измерений больше, чем умещается в данных массива, или отрицательное
+    for (const unsigned char ndim : {0x7F, 0xFF}) {
+        const unsigned char data[] = {ndim, 0xFF, 0xFF, 0xFF, 0, 0, 0, 0, 0, 0, 0, 23, 0, 0, 0, 1};
+        const auto array = SqlArray::fromPg(reinterpret_cast<const char *>(data), static_cast<int>(sizeof(data)));
+        CHECK(array.size() == 0);
+        CHECK(array.values<int32_t>().empty());
+    }
+
+    // int4[] из двух элементов, длина второго выходит за пределы данных
+    const unsigned char data[] = {0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 23, 0, 0, 0, 2, 0, 0, 0, 1,
+                                  0, 0, 0, 4, 0, 0, 0, 1, 0x7F, 0xFF, 0xFF, 0xFF, 0, 0, 0, 2};
+    const auto array = SqlArray::fromPg(reinterpret_cast<const char *>(data), static_cast<int>(sizeof(data)));
+    CHECK(array.size() == 2);
+    CHECK((array.values<int32_t>() == std::vector<int32_t>{1}));
+}
+
+int main(int /*argc*/, char * /*argv*/[])
+{
+    testScalars();
+    testStrings();
+    testUuids();
+    testDecimals();
+    testEmpty();
+    testConversions();
+    testNulls();
+    testMalformed();
+    return checkResult();
+}
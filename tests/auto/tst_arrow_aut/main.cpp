@@ -0,0 +1,255 @@
+﻿#include "../check.h"
+
+#include <asyncpg/SqlArrow.h>
+#include <asyncpg/SqlResult.h>
+
+#include <libpq-fe.h>
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace AsyncPg;
+
+/// Типы PostgreSql
+static constexpr unsigned int Int4Oid = 23;
+static constexpr unsigned int DateOid = 1082;
+static constexpr unsigned int TimeStampOid = 1114;
+static constexpr unsigned int TimeTzOid = 1266;
+static constexpr unsigned int NumericOid = 1700;
+
+/// Количество дней и микросекунд между эпохами Unix и PostgreSql
+static constexpr int32_t EpochDays = 10957;
+static constexpr int64_t EpochUsec = 946684800000000;
+
+/// Количество микросекунд в часе
+static constexpr int64_t HourUsec = 3600000000;
+
+/// Колонка результата Sql запроса в двоичном формате
+struct Column
+{
+    unsigned int                            oid;
+    const char                             *name;
+    std::vector<std::optional<std::string>> values;
+};
+
+static std::string bigEndian(uint64_t value, int size)
+{
+    std::string bytes;
+    for (int i = size - 1; i >= 0; --i)
+        bytes += static_cast<char>((value >> (i * 8)) & 0xFF);
+    return bytes;
+}
+
+/// Двоичное значение numeric из цифр по основанию 10000
+static std::string numeric(int16_t weight, bool negative, int16_t dscale, const std::vector<int16_t> &digits)
+{
+    auto bytes = bigEndian(digits.size(), 2) + bigEndian(static_cast<uint16_t>(weight), 2)
+               + bigEndian(negative ? 0x4000 : 0, 2) + bigEndian(static_cast<uint16_t>(dscale), 2);
+    for (auto digit : digits)
+        bytes += bigEndian(static_cast<uint16_t>(digit), 2);
+    return bytes;
+}
+
+/// Двоичное значение timetz: время в микросекундах и смещение в секундах к западу от UTC
+static std::string timeTz(int64_t usec, int32_t zone)
+{
+    return bigEndian(static_cast<uint64_t>(usec), 8) + bigEndian(static_cast<uint32_t>(zone), 4);
+}
+
+/// Создаёт результат Sql запроса из колонок с одинаковым количеством строк
+static SqlResult makeResult(const std::vector<Column> &columns)
+{
+    auto *pgresult = PQmakeEmptyPGresult(nullptr, PGRES_TUPLES_OK);
+    std::vector<PGresAttDesc> attributes(columns.size());
+    for (std::size_t col = 0; col < columns.size(); ++col) {
+        attributes[col].name = const_cast<char *>(columns[col].name);
+        attributes[col].typid = columns[col].oid;
+        attributes[col].format = 1;
+        attributes[col].typlen = -1;
+        attributes[col].atttypmod = -1;
+    }
+    PQsetResultAttrs(pgresult, static_cast<int>(attributes.size()), attributes.data());
+    for (std::size_t col = 0; col < columns.size(); ++col) {
+        for (std::size_t row = 0; row < columns[col].values.size(); ++row) {
+            const auto &value = columns[col].values[row];
+            PQsetvalue(pgresult, static_cast<int>(row), static_cast<int>(col),
+                       value ? const_cast<char *>(value->data()) : nullptr,
+                       value ? static_cast<int>(value->size()) : -1);
+        }
+    }
+    return SqlResult(pgresult);
+}
+
+template<class T>
+static T fixedValue(const ArrowArray *array, int64_t index)
+{
+    T value;
+    std::memcpy(&value, static_cast<const char *>(array->buffers[1]) + index * sizeof(T), sizeof(T));
+    return value;
+}
+
+static bool isValid(const ArrowArray *array, int64_t index)
+{
+    const auto *validity = static_cast<const uint8_t *>(array->buffers[0]);
+    return !validity || (validity[index / 8] & (1 << (index % 8))) != 0;
+}
+
+static std::string stringValue(const ArrowArray *array, int64_t index)
+{
+    const auto *offsets = static_cast<const int32_t *>(array->buffers[1]);
+    const auto *values = static_cast<const char *>(array->buffers[2]);
+    return std::string(values + offsets[index], static_cast<std::size_t>(offsets[index + 1] - offsets[index]));
+}
+
+static SqlResult makeSample()
+{
+    constexpr auto Int32Max = std::numeric_limits<int32_t>::max();
+    constexpr auto Int32Min = std::numeric_limits<int32_t>::min();
+    constexpr auto Int64Max = std::numeric_limits<int64_t>::max();
+    constexpr auto Int64Min = std::numeric_limits<int64_t>::min();
+
+    return makeResult({
+        {Int4Oid, "i", {bigEndian(7, 4), std::nullopt, bigEndian(static_cast<uint32_t>(-1), 4)}},
+        // 123.45, NULL, -0.5
+        {NumericOid, "n", {numeric(0, false, 2, {123, 4500}), std::nullopt, numeric(-1, true, 1, {5000})}},
+        // 10:00+03, 01:00+03, 23:00-02
+        {TimeTzOid, "tz", {timeTz(10 * HourUsec, -3 * 3600), timeTz(1 * HourUsec, -3 * 3600),
+                           timeTz(23 * HourUsec, 2 * 3600)}},
+        // 2000-01-01, infinity, -infinity
+        {DateOid, "d", {bigEndian(0, 4), bigEndian(static_cast<uint32_t>(Int32Max), 4),
+                        bigEndian(static_cast<uint32_t>(Int32Min), 4)}},
+        {TimeStampOid, "ts", {bigEndian(0, 8), bigEndian(static_cast<uint64_t>(Int64Max), 8),
+                              bigEndian(static_cast<uint64_t>(Int64Min), 8)}},
+    });
+}
+
+static void testSchema()
+{
+    const auto result = makeSample();
+    ArrowSchema schema;
+    ArrowArray array;
+    CHECK(exportArrow(result, &schema, &array));
+
+    CHECK(std::string(schema.format) == "+s");
+    CHECK(schema.n_children == 5);
+    const char *formats[] = {"i", "u", "ttu", "tdD", "tsu:"};
+    const char *names[] = {"i", "n", "tz", "d", "ts"};
+    for (int col = 0; col < 5 && col < schema.n_children; ++col) {
+        CHECK(std::string(schema.children[col]->format) == formats[col]);
+        CHECK(std::string(schema.children[col]->name) == names[col]);
+        CHECK(schema.children[col]->flags == ARROW_FLAG_NULLABLE);
+    }
+    CHECK(array.length == 3 && array.n_children == 5);
+
+    schema.release(&schema);
+    array.release(&array);
+    CHECK(!schema.release && !array.release);
+}
+
+static void testNulls()
+{
+    const auto result = makeSample();
+    ArrowSchema schema;
+    ArrowArray array;
+    CHECK(exportArrow(result, &schema, &array));
+
+    const auto *ints = array.children[0];
+    CHECK(ints->null_count == 1 && ints->buffers[0]);
+    CHECK(isValid(ints, 0) && !isValid(ints, 1) && isValid(ints, 2));
+    CHECK(fixedValue<int32_t>(ints, 0) == 7 && fixedValue<int32_t>(ints, 2) == -1);
+
+    // Колонки без NULL не передают битовую маску
+    CHECK(array.children[2]->null_count == 0 && !array.children[2]->buffers[0]);
+
+    schema.release(&schema);
+    array.release(&array);
+}
+
+static void testNumeric()
+{
+    const auto result = makeSample();
+    ArrowSchema schema;
+    ArrowArray array;
+    CHECK(exportArrow(result, &schema, &array));
+
+    const auto *numerics = array.children[1];
+    CHECK(numerics->n_buffers == 3 && numerics->null_count == 1);
+    CHECK(stringValue(numerics, 0) == "123.45");
+    CHECK(!isValid(numerics, 1) && stringValue(numerics, 1).empty());
+    CHECK(stringValue(numerics, 2) == "-0.5");
+
+    schema.release(&schema);
+    array.release(&array);
+}
+
+static void testTimeTz()
+{
+    const auto result = makeSample();
+    ArrowSchema schema;
+    ArrowArray array;
+    CHECK(exportArrow(result, &schema, &array));
+
+    // Время приводится к UTC и остаётся в пределах суток
+    const auto *times = array.children[2];
+    CHECK(fixedValue<int64_t>(times, 0) == 7 * HourUsec);
+    CHECK(fixedValue<int64_t>(times, 1) == 22 * HourUsec);
+    CHECK(fixedValue<int64_t>(times, 2) == 1 * HourUsec);
+
+    schema.release(&schema);
+    array.release(&array);
+}
+
+static void testInfinities()
+{
+    const auto result = makeSample();
+    ArrowSchema schema;
+    ArrowArray array;
+    CHECK(exportArrow(result, &schema, &array));
+
+    const auto *dates = array.children[3];
+    CHECK(fixedValue<int32_t>(dates, 0) == EpochDays);
+    CHECK(fixedValue<int32_t>(dates, 1) == std::numeric_limits<int32_t>::max());
+    CHECK(fixedValue<int32_t>(dates, 2) == std::numeric_limits<int32_t>::min());
+
+    const auto *timeStamps = array.children[4];
+    CHECK(fixedValue<int64_t>(timeStamps, 0) == EpochUsec);
+    CHECK(fixedValue<int64_t>(timeStamps, 1) == std::numeric_limits<int64_t>::max());
+    CHECK(fixedValue<int64_t>(timeStamps, 2) == std::numeric_limits<int64_t>::min());
+
+    schema.release(&schema);
+    array.release(&array);
+}
+
+static void testRange()
+{
+    const auto result = makeSample();
+    ArrowSchema schema;
+    ArrowArray array;
+    CHECK(exportArrow(result, &schema, &array, 1));
+
+    CHECK(array.length == 2);
+    const auto *ints = array.children[0];
+    CHECK(ints->length == 2 && ints->null_count == 1);
+    CHECK(!isValid(ints, 0) && isValid(ints, 1));
+    CHECK(stringValue(array.children[1], 1) == "-0.5");
+
+    schema.release(&schema);
+    array.release(&array);
+
+    CHECK(!exportArrow(result, &schema, &array, 4));
+}
+
+int main(int /*argc*/, char * /*argv*/[])
+{
+    testSchema();
+    testNulls();
+    testNumeric();
+    testTimeTz();
+    testInfinities();
+    testRange();
+    return checkResult();
+}
@@ -0,0 +1,150 @@
+﻿#include "../check.h"
+
+#include <asyncpg/SqlCache.h>
+
+#include <memory>
+#include <thread>
+
+using namespace AsyncPg;
+using std::chrono::milliseconds;
+
+static SqlValue text(const std::string &value)
+{
+    return makeSqlValue<SqlType::Text>(value);
+}
+
+static SqlValue custom(const std::string &typeName, std::vector<char> bytes)
+{
+    return makeSqlValue<SqlType::Custom>(SqlCustom{typeName, std::move(bytes)});
+}
+
+static SqlSharedResult makeResult()
+{
+    return std::make_shared<const SqlResult>();
+}
+
+static void testQueryKey()
+{
+    const auto key = sqlQueryKey("SELECT $1", {text("a")});
+    CHECK(key == sqlQueryKey("SELECT $1", {text("a")}));
+    CHECK(key != sqlQueryKey("SELECT $1 ", {text("a")}));
+    CHECK(key != sqlQueryKey("SELECT $1", {text("b")}));
+    CHECK(key != sqlQueryKey("SELECT $1", {makeSqlValue<SqlType::VarChar>(std::string("a"))}));
+    CHECK(key != sqlQueryKey("SELECT $1", {SqlValue(std::in_place_index<SqlType::Text>)}));
+    CHECK(sqlQueryKey("SELECT $1", {text("")}) != sqlQueryKey("SELECT $1", {SqlValue(std::in_place_index<SqlType::Text>)}));
+
+    // Границы параметров и тип значения входят в ключ
+    CHECK(sqlQueryKey("SELECT $1, $2", {text("ab"), text("c")})
+          != sqlQueryKey("SELECT $1, $2", {text("a"), text("bc")}));
+    CHECK(sqlQueryKey("SELECT $1", {makeSqlValue<SqlType::Integer>(int32_t(1))})
+          != sqlQueryKey("SELECT $1", {makeSqlValue<SqlType::BigInt>(int64_t(1))}));
+    CHECK(sqlQueryKey("SELECT $1", {makeSqlValue<SqlType::Integer>(int32_t(1))})
+          == sqlQueryKey("SELECT $1", {makeSqlValue<SqlType::Integer>(int32_t(1))}));
+
+    // Пользовательские типы с одинаковым значением различаются наименованием
+    CHECK(sqlQueryKey("SELECT $1", {custom("point", {1, 2})}) == sqlQueryKey("SELECT $1", {custom("point", {1, 2})}));
+    CHECK(sqlQueryKey("SELECT $1", {custom("point", {1, 2})}) != sqlQueryKey("SELECT $1", {custom("box", {1, 2})}));
+    CHECK(sqlQueryKey("SELECT $1, $2", {custom("a", {}), custom("b", {})})
+          != sqlQueryKey("SELECT $1, $2", {custom("ab", {}), custom("", {})}));
+}
+
+static void testFindInsert()
+{
+    SqlCache cache;
+    CHECK(!cache.find("SELECT 1", {}));
+    CHECK(cache.misses() == 1 && cache.hits() == 0);
+
+    const auto result = makeResult();
+    cache.insert("SELECT 1", {}, result, {"a"});
+    CHECK(cache.size() == 1 && cache.bytes() > 0);
+    CHECK(cache.find("SELECT 1", {}) == result);
+    CHECK(cache.hits() == 1);
+    CHECK(!cache.find("SELECT 1", {text("x")}));
+
+    // Повторная вставка заменяет результат
+    const auto replaced = makeResult();
+    cache.insert("SELECT 1", {}, replaced, {"b"});
+    CHECK(cache.size() == 1);
+    CHECK(cache.find("SELECT 1", {}) == replaced);
+    cache.invalidate("a");
+    CHECK(cache.size() == 1);
+
+    cache.insert("SELECT 1", {}, nullptr, {});
+    CHECK(cache.find("SELECT 1", {}) == replaced);
+
+    cache.clear();
+    CHECK(cache.size() == 0 && cache.bytes() == 0);
+    CHECK(!cache.find("SELECT 1", {}));
+}
+
+static void testInvalidate()
+{
+    SqlCache cache;
+    cache.insert("SELECT 1", {}, makeResult(), {"users"});
+    cache.insert("SELECT 2", {}, makeResult(), {"users", "orders"});
+    cache.insert("SELECT 3", {}, makeResult(), {"orders"});
+    cache.insert("SELECT 4", {}, makeResult(), {});
+
+    cache.invalidate("users");
+    CHECK(cache.size() == 2);
+    CHECK(!cache.find("SELECT 1", {}) && !cache.find("SELECT 2", {}));
+    CHECK(cache.find("SELECT 3", {}) && cache.find("SELECT 4", {}));
+
+    cache.invalidate("missing");
+    CHECK(cache.size() == 2);
+    cache.invalidate("orders");
+    CHECK(cache.size() == 1 && cache.find("SELECT 4", {}));
+}
+
+static void testEviction()
+{
+    // Размер результата без строк равен размеру ключа
+    const auto entry = sqlQueryKey("SELECT 1", {}).size();
+    SqlCacheOptions options;
+    options.maxBytes = entry * 2;
+    SqlCache cache(options);
+
+    cache.insert("SELECT 1", {}, makeResult(), {"a"});
+    cache.insert("SELECT 2", {}, makeResult(), {"a"});
+    CHECK(cache.size() == 2 && cache.bytes() == entry * 2);
+
+    // Давно не использованный результат удаляется первым
+    CHECK(cache.find("SELECT 1", {}));
+    cache.insert("SELECT 3", {}, makeResult(), {"a"});
+    CHECK(cache.size() == 2);
+    CHECK(cache.find("SELECT 1", {}) && !cache.find("SELECT 2", {}) && cache.find("SELECT 3", {}));
+
+    // Результат больше кэша не сохраняется
+    const std::string large(entry * 2, ' ');
+    cache.insert(large, {}, makeResult(), {});
+    CHECK(!cache.find(large, {}) && cache.size() == 2);
+
+    cache.invalidate("a");
+    CHECK(cache.size() == 0 && cache.bytes() == 0);
+}
+
+static void testTtl()
+{
+    SqlCacheOptions options;
+    options.ttl = milliseconds(10000);
+    SqlCache cache(options);
+
+    cache.insert("SELECT 1", {}, makeResult(), {}, milliseconds(1));
+    cache.insert("SELECT 2", {}, makeResult(), {});
+    std::this_thread::sleep_for(milliseconds(5));
+
+    const auto misses = cache.misses();
+    CHECK(!cache.find("SELECT 1", {}));
+    CHECK(cache.misses() == misses + 1);
+    CHECK(cache.size() == 1 && cache.find("SELECT 2", {}));
+}
+
+int main(int /*argc*/, char * /*argv*/[])
+{
+    testQueryKey();
+    testFindInsert();
+    testInvalidate();
+    testEviction();
+    testTtl();
+    return checkResult();
+}
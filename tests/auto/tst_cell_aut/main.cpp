@@ -0,0 +1,168 @@
+﻿#include "../check.h"
+
+#include <asyncpg/SqlCell.h>
+#include <asyncpg/SqlCodec.h>
+#include <asyncpg/SqlResult.h>
+
+#include <libpq-fe.h>
+
+#include <memory>
+#include <memory_resource>
+#include <utility>
+
+using namespace AsyncPg;
+
+template<class T>
+static bool same(const T &first, const T &second)
+{
+    return first == second;
+}
+
+static bool same(const SqlDecimal &first, const SqlDecimal &second)
+{
+    return first.toString() == second.toString();
+}
+
+static bool same(const SqlArray &first, const SqlArray &second)
+{
+    return first.bytes() == second.bytes();
+}
+
+static bool same(const SqlCustom &first, const SqlCustom &second)
+{
+    return first.typeName == second.typeName && first.bytes == second.bytes;
+}
+
+static bool same(const SqlInterval &first, const SqlInterval &second)
+{
+    return first.time == second.time && first.days == second.days && first.months == second.months;
+}
+
+template<std::size_t I>
+static bool sameAt(const SqlValue &first, const SqlValue &second)
+{
+    if constexpr (I == 0) {
+        return true;
+    } else {
+        const auto &value = std::get<I>(first);
+        const auto &other = std::get<I>(second);
+        if (value.has_value() != other.has_value())
+            return false;
+        return !value || same(*value, *other);
+    }
+}
+
+template<std::size_t... I>
+static bool sameAt(const SqlValue &first, const SqlValue &second, std::index_sequence<I...>)
+{
+    bool result = false;
+    ((first.index() == I && (result = sameAt<I>(first, second), true)) || ...);
+    return result;
+}
+
+/// Сравнивает значения полей строки результата Sql запроса
+static bool same(const SqlValue &first, const SqlValue &second)
+{
+    return first.index() == second.index()
+        && sameAt(first, second, std::make_index_sequence<std::variant_size_v<SqlValue>>());
+}
+
+/// Проверяет что значение сохраняется компактным значением без изменений
+static void checkRoundTrip(const SqlValue &value, std::pmr::memory_resource *resource = nullptr)
+{
+    const SqlCell cell(value, resource);
+    CHECK(cell.type() == static_cast<SqlType>(value.index()));
+    CHECK(cell.isNull() == isNullValue(value));
+    CHECK(same(cell.value(), value));
+
+    const SqlCell copy(cell);
+    CHECK(same(copy.value(), value));
+}
+
+template<std::size_t... I>
+static void checkNulls(std::index_sequence<I...>)
+{
+    (checkRoundTrip(SqlValue(std::in_place_index<I + 1>)), ...);
+}
+
+static void testValues()
+{
+    checkRoundTrip(SqlValue());
+    checkNulls(std::make_index_sequence<std::variant_size_v<SqlValue> - 1>());
+
+    const std::string longText(100, 'x');
+    std::pmr::monotonic_buffer_resource pool;
+    for (auto *resource : {static_cast<std::pmr::memory_resource *>(nullptr),
+                           static_cast<std::pmr::memory_resource *>(&pool)}) {
+        checkRoundTrip(makeSqlValue<SqlType::Boolean>(true), resource);
+        checkRoundTrip(makeSqlValue<SqlType::SmallInt>(int16_t(-2)), resource);
+        checkRoundTrip(makeSqlValue<SqlType::Integer>(int32_t(-3)), resource);
+        checkRoundTrip(makeSqlValue<SqlType::BigInt>(int64_t(-4)), resource);
+        checkRoundTrip(makeSqlValue<SqlType::Real>(1.5f), resource);
+        checkRoundTrip(makeSqlValue<SqlType::Double>(-2.5), resource);
+        checkRoundTrip(makeSqlValue<SqlType::Decimal>(std::string("12.50")), resource);
+        checkRoundTrip(makeSqlValue<SqlType::Char>(std::string("c")), resource);
+        checkRoundTrip(makeSqlValue<SqlType::Json>(std::string("{\"a\": 1}")), resource);
+        checkRoundTrip(makeSqlValue<SqlType::Name>(std::string("name")), resource);
+        checkRoundTrip(makeSqlValue<SqlType::Text>(std::string()), resource);
+        checkRoundTrip(makeSqlValue<SqlType::Text>(longText), resource);
+        checkRoundTrip(makeSqlValue<SqlType::VarChar>(std::string("varchar")), resource);
+        checkRoundTrip(makeSqlValue<SqlType::Xml>(std::string("<a/>")), resource);
+        checkRoundTrip(makeSqlValue<SqlType::Date>(std::time_t(946684800)), resource);
+        checkRoundTrip(makeSqlValue<SqlType::Time>(std::time_t(3600)), resource);
+        checkRoundTrip(makeSqlValue<SqlType::TimeTz>(std::time_t(7200)), resource);
+        checkRoundTrip(makeSqlValue<SqlType::TimeStamp>(std::time_t(-1)), resource);
+        checkRoundTrip(makeSqlValue<SqlType::TimeStampTz>(std::time_t(1700000000)), resource);
+        checkRoundTrip(makeSqlValue<SqlType::Uuid>(std::array<char, 16>{1, 2, 3}), resource);
+        checkRoundTrip(makeSqlValue<SqlType::Bytea>(std::vector<char>{0, 1, 2}), resource);
+        checkRoundTrip(makeSqlValue<SqlType::Bytea>(std::vector<char>(longText.begin(), longText.end())),
+                       resource);
+        checkRoundTrip(makeSqlValue<SqlType::Numeric>(*SqlDecimal::fromString("-1.25")), resource);
+        checkRoundTrip(makeSqlValue<SqlType::Array>(SqlArray::from<int32_t>({1, 2, 3})), resource);
+        checkRoundTrip(makeSqlValue<SqlType::Jsonb>(std::string("[]")), resource);
+        checkRoundTrip(makeSqlValue<SqlType::Custom>(SqlCustom{"point", {1, 0, 2}}), resource);
+        checkRoundTrip(makeSqlValue<SqlType::Custom>(SqlCustom{"empty", {}}), resource);
+        checkRoundTrip(makeSqlValue<SqlType::Custom>(SqlCustom{longText, std::vector<char>(64, '\0')}),
+                       resource);
+        checkRoundTrip(makeSqlValue<SqlType::TimeStampUs>(SqlTimePoint(std::chrono::microseconds(1))),
+                       resource);
+        checkRoundTrip(makeSqlValue<SqlType::TimeStampTzUs>(SqlTimePoint::max()), resource);
+        checkRoundTrip(makeSqlValue<SqlType::TimeUs>(std::chrono::microseconds(5)), resource);
+        checkRoundTrip(makeSqlValue<SqlType::DateDays>(SqlDatePoint(SqlDays(-1))), resource);
+        checkRoundTrip(makeSqlValue<SqlType::Interval>(SqlInterval{std::chrono::microseconds(1), 2, 3}),
+                       resource);
+    }
+}
+
+static void testCustomColumn()
+{
+    // Колонка пользовательского типа без декодера возвращается как SqlCustom
+    constexpr unsigned int PointOid = 600000;
+    auto *pgresult = PQmakeEmptyPGresult(nullptr, PGRES_TUPLES_OK);
+    PGresAttDesc attribute{};
+    attribute.name = const_cast<char *>("value");
+    attribute.typid = PointOid;
+    attribute.format = 1;
+    attribute.typlen = -1;
+    attribute.atttypmod = -1;
+    CHECK(PQsetResultAttrs(pgresult, 1, &attribute) != 0);
+    CHECK(PQsetvalue(pgresult, 0, 0, const_cast<char *>("\x01\x00\x02"), 3) != 0);
+    CHECK(PQsetvalue(pgresult, 1, 0, nullptr, -1) != 0);
+
+    SqlResult result(pgresult);
+    result.setTypes(std::make_shared<SqlTypeMap>(std::vector<SqlCodec>{SqlCodec{"point", {}, {}}},
+                                                 std::vector<std::pair<unsigned int, std::string>>{
+                                                     {PointOid, "point"}}));
+
+    const auto cell = result.cell(0, 0);
+    CHECK(cell.type() == SqlType::Custom && !cell.isNull());
+    CHECK(same(cell.value(), makeSqlValue<SqlType::Custom>(SqlCustom{"point", {1, 0, 2}})));
+    CHECK(same(result.cell(1, 0).value(), SqlValue(std::in_place_index<SqlType::Custom>)));
+}
+
+int main(int /*argc*/, char * /*argv*/[])
+{
+    testValues();
+    testCustomColumn();
+    return checkResult();
+}
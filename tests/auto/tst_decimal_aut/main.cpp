@@ -0,0 +1,127 @@
+﻿#include "../check.h"
+
+#include <asyncpg/SqlDecimal.h>
+
+#include <limits>
+#include <string>
+#include <vector>
+
+using AsyncPg::SqlDecimal;
+
+/// Кодирует десятичное число в двоичное значение NUMERIC
+static std::vector<char> toPg(const SqlDecimal &value)
+{
+    std::vector<char> data(value.pgSize());
+    value.toPg(data.data());
+    return data;
+}
+
+/// Проверяет разбор строки и возврат через двоичное значение NUMERIC
+static void checkRoundTrip(const std::string &text, const std::string &expected)
+{
+    auto value = SqlDecimal::fromString(text);
+    CHECK(value.has_value());
+    if (!value)
+        return;
+    CHECK(value->toString() == expected);
+
+    const auto data = toPg(*value);
+    CHECK(data.size() == AsyncPg::numericPgSize(text));
+    CHECK(SqlDecimal::fromPg(data.data(), static_cast<int>(data.size())).toString() == expected);
+
+    std::string chars(AsyncPg::numericTextSize(data.data(), static_cast<int>(data.size())), '\0');
+    auto *end = AsyncPg::numericToChars(data.data(), static_cast<int>(data.size()), chars.data());
+    chars.resize(static_cast<std::size_t>(end - chars.data()));
+    CHECK(chars == expected);
+}
+
+static void testFixed()
+{
+    checkRoundTrip("0", "0");
+    checkRoundTrip("1", "1");
+    checkRoundTrip("-1", "-1");
+    checkRoundTrip("123.4500", "123.4500");
+    checkRoundTrip("-0.001", "-0.001");
+    checkRoundTrip("10000", "10000");
+    checkRoundTrip("9999.9999", "9999.9999");
+    checkRoundTrip(".5", "0.5");
+    checkRoundTrip("+7", "7");
+    checkRoundTrip("007.10", "7.10");
+    checkRoundTrip("170141183460469231731687303715884105727",
+                   "170141183460469231731687303715884105727");
+
+    auto value = SqlDecimal::fromString("-12.345");
+    int64_t unscaled = 0;
+    CHECK(value && value->isFixed() && value->isNegative());
+    CHECK(value && value->toUnscaled(unscaled) && unscaled == -12345 && value->scale() == 3);
+    CHECK(SqlDecimal(-12345, 3).toString() == "-12.345");
+
+    // Отрицательный масштаб умножает коэффициент
+    CHECK(SqlDecimal(5, -2).toString() == "500");
+    CHECK(SqlDecimal(-5, -2).toString() == "-500");
+    CHECK(SqlDecimal(0, -3).toString() == "0");
+    CHECK(SqlDecimal(5, -2).scale() == 0);
+    const std::string wide = "9223372036854775807" + std::string(30, '0');
+    const SqlDecimal large(std::numeric_limits<int64_t>::max(), -30);
+    CHECK(!large.isFixed() && large.toString() == wide);
+    CHECK(SqlDecimal::fromPg(toPg(large).data(), static_cast<int>(toPg(large).size())).toString() == wide);
+    CHECK(SqlDecimal(std::numeric_limits<int64_t>::min(), -19).toString()
+          == "-9223372036854775808" + std::string(19, '0'));
+}
+
+static void testWide()
+{
+    // Числа больше 128 бит хранятся в текстовом виде
+    const std::string wide = "340282366920938463463374607431768211456";
+    checkRoundTrip(wide, wide);
+    checkRoundTrip("-" + wide + ".000001", "-" + wide + ".000001");
+
+    auto value = SqlDecimal::fromString(wide);
+    int64_t unscaled = 0;
+    CHECK(value && !value->isFixed() && !value->toUnscaled(unscaled));
+
+    const std::string digits(1000, '9');
+    checkRoundTrip(digits + "." + digits, digits + "." + digits);
+}
+
+static void testSpecial()
+{
+    checkRoundTrip("NaN", "NaN");
+    checkRoundTrip("Infinity", "Infinity");
+    checkRoundTrip("-Infinity", "-Infinity");
+    checkRoundTrip("inf", "Infinity");
+    checkRoundTrip("-INF", "-Infinity");
+
+    auto nan = SqlDecimal::fromString("nan");
+    CHECK(nan && nan->isNaN() && !nan->isInfinity());
+    auto inf = SqlDecimal::fromString("-Infinity");
+    CHECK(inf && inf->isInfinity() && inf->isNegative());
+}
+
+static void testExponent()
+{
+    checkRoundTrip("1e5", "100000");
+    checkRoundTrip("1.5e-2", "0.015");
+    checkRoundTrip("1.50e1", "15.0");
+    checkRoundTrip("-2.5E+3", "-2500");
+    checkRoundTrip("0.000e3", "0");
+    checkRoundTrip(" 1.5\t", "1.5");
+}
+
+static void testInvalid()
+{
+    for (const char *text : {"", " ", "abc", "1e", "1e1001", "1.2.3", "--1", "1 2", ".", "0x10"}) {
+        CHECK(!SqlDecimal::fromString(text));
+        CHECK(AsyncPg::numericPgSize(text) == 0);
+    }
+}
+
+int main(int /*argc*/, char * /*argv*/[])
+{
+    testFixed();
+    testWide();
+    testSpecial();
+    testExponent();
+    testInvalid();
+    return checkResult();
+}
@@ -0,0 +1,125 @@
+﻿#include "../check.h"
+
+#include <asyncpg/SqlHex.h>
+
+#include <cctype>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/// Скалярная реализация hexEncode для сравнения с векторной
+static std::string referenceEncode(const std::string &data)
+{
+    constexpr char digits[] = "0123456789abcdef";
+    std::string text;
+    for (unsigned char byte : data) {
+        text += digits[byte >> 4];
+        text += digits[byte & 0xF];
+    }
+    return text;
+}
+
+/// Возвращает байты длиной size, перебирающие все значения байта
+static std::string makeBytes(std::size_t size, unsigned int seed)
+{
+    std::string data(size, '\0');
+    for (std::size_t i = 0; i < size; ++i)
+        data[i] = static_cast<char>((i * 73 + seed * 151) & 0xFF);
+    return data;
+}
+
+static std::string encode(const std::string &data)
+{
+    std::string text(data.size() * 2, '\0');
+    const auto *end = AsyncPg::hexEncode(data.data(), data.size(), text.data());
+    CHECK(end == text.data() + text.size());
+    return text;
+}
+
+static bool decode(const std::string &text, std::string &data)
+{
+    data.assign(text.size() / 2, '\0');
+    return AsyncPg::hexDecode(text.data(), text.size(), data.data());
+}
+
+static void testHex()
+{
+    // Длины покрывают векторные блоки по 16 байт и скалярный остаток
+    for (std::size_t size = 0; size <= 70; ++size) {
+        for (unsigned int seed = 0; seed < 4; ++seed) {
+            const auto data = makeBytes(size, seed);
+            const auto text = encode(data);
+            CHECK(text == referenceEncode(data));
+
+            std::string decoded;
+            CHECK(decode(text, decoded) && decoded == data);
+
+            auto upper = text;
+            for (std::size_t i = seed % 2; i < upper.size(); i += 2)
+                upper[i] = static_cast<char>(std::toupper(static_cast<unsigned char>(upper[i])));
+            CHECK(decode(upper, decoded) && decoded == data);
+        }
+    }
+}
+
+static void testInvalidHex()
+{
+    std::string data;
+    CHECK(!AsyncPg::hexDecode("abc", 3, nullptr));
+
+    // Недопустимые символы вблизи границ диапазонов цифр в каждой позиции блока и остатка
+    const std::string text = referenceEncode(makeBytes(40, 1));
+    for (char bad : {'/', ':', '@', 'G', '`', 'g', ' ', '\0', '\x80', '\xFF'}) {
+        for (std::size_t pos = 0; pos < text.size(); ++pos) {
+            auto invalid = text;
+            invalid[pos] = bad;
+            CHECK(!decode(invalid, data));
+        }
+    }
+}
+
+static void testUuid()
+{
+    const std::string canonical = "a0eebc99-9c0b-4ef8-bb6d-6bb9bd380a11";
+    const std::string expected = "\xa0\xee\xbc\x99\x9c\x0b\x4e\xf8\xbb\x6d\x6b\xb9\xbd\x38\x0a\x11";
+
+    for (const std::string &text : {canonical, std::string("A0EEBC99-9C0B-4EF8-BB6D-6BB9BD380A11"),
+                                     std::string("a0eebc999c0b4ef8bb6d6bb9bd380a11"), "{" + canonical + "}",
+                                     std::string("{a0eebc999c0b4ef8bb6d6bb9bd380a11}")}) {
+        char uuid[16] = {};
+        CHECK(AsyncPg::uuidFromChars(text, uuid));
+        CHECK(std::string(uuid, 16) == expected);
+    }
+
+    char chars[AsyncPg::UuidTextSize];
+    CHECK(AsyncPg::uuidToChars(expected.data(), chars) == chars + AsyncPg::UuidTextSize);
+    CHECK(std::string(chars, AsyncPg::UuidTextSize) == canonical);
+
+    for (const std::string &text : {std::string(), canonical.substr(1), canonical + "0", "{" + canonical,
+                                     canonical + "}", "(" + canonical + ")",
+                                     std::string("a0eebc99-9c0b-4ef8-bb6d-6bb9bd380a1g"),
+                                     std::string("a0eebc99x9c0b-4ef8-bb6d-6bb9bd380a11"),
+                                     std::string("a0eebc999-c0b-4ef8-bb6d-6bb9bd380a11"),
+                                     std::string("a0eebc999c0b4ef8bb6d6bb9bd380a1z")}) {
+        char uuid[16] = {};
+        CHECK(!AsyncPg::uuidFromChars(text, uuid));
+    }
+
+    const std::string_view texts[] = {canonical, "invalid"};
+    char uuids[32];
+    CHECK(AsyncPg::uuidsFromChars(texts, 2, uuids) == 1);
+    CHECK(std::string(uuids, 16) == expected && std::string(uuids + 16, 16) == std::string(16, '\0'));
+
+    char many[AsyncPg::UuidTextSize * 2];
+    std::string pair = expected + expected;
+    CHECK(AsyncPg::uuidsToChars(pair.data(), 2, many) == many + sizeof(many));
+    CHECK(std::string(many, sizeof(many)) == canonical + canonical);
+}
+
+int main(int /*argc*/, char * /*argv*/[])
+{
+    testHex();
+    testInvalidHex();
+    testUuid();
+    return checkResult();
+}
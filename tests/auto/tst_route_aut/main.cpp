@@ -0,0 +1,154 @@
+﻿#include "../check.h"
+
+#include <asyncpg/SqlRouter.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+
+using namespace AsyncPg;
+
+static bool isRead(std::string_view sql)
+{
+    return sqlRoute(sql) == SqlRoute::Read;
+}
+
+static void testCommands()
+{
+    CHECK(isRead("SELECT 1"));
+    CHECK(isRead("  select * from users where id = $1"));
+    CHECK(isRead("VALUES (1), (2)"));
+    CHECK(isRead("TABLE users"));
+    CHECK(isRead("SHOW search_path"));
+    CHECK(isRead("EXPLAIN SELECT 1"));
+    CHECK(isRead("(SELECT 1) UNION (SELECT 2)"));
+
+    CHECK(!isRead(""));
+    CHECK(!isRead("  -- comment only\n"));
+    CHECK(!isRead("INSERT INTO users VALUES (1)"));
+    CHECK(!isRead("update users set name = 'a'"));
+    CHECK(!isRead("DELETE FROM users"));
+    CHECK(!isRead("BEGIN"));
+    CHECK(!isRead("SET search_path = public"));
+    CHECK(!isRead("CREATE TABLE t (id int)"));
+    CHECK(!isRead("EXPLAIN ANALYZE DELETE FROM users"));
+}
+
+static void testQuotes()
+{
+    // Слова в строках, идентификаторах и комментариях не учитываются
+    CHECK(isRead("SELECT 'insert into t' AS text"));
+    CHECK(isRead("SELECT E'it\\'s delete' AS text"));
+    CHECK(isRead("SELECT 'it''s update'"));
+    CHECK(isRead("SELECT \"update\" FROM \"delete\""));
+    CHECK(isRead("SELECT 1 -- delete from users\n"));
+    CHECK(isRead("SELECT /* outer /* insert */ update */ 1"));
+    CHECK(isRead("/* DELETE */ SELECT 1"));
+    CHECK(isRead("-- update\nSELECT 1"));
+    CHECK(!isRead("SELECT 'a' FROM t; DELETE FROM t"));
+}
+
+static void testDollarQuotes()
+{
+    CHECK(isRead("SELECT $$delete from users$$"));
+    CHECK(isRead("SELECT $tag$ insert $$ update $tag$"));
+    CHECK(isRead("SELECT $1, $2 FROM users WHERE name = $3"));
+    CHECK(!isRead("SELECT $tag$ text $tag$; UPDATE users SET a = 1"));
+}
+
+static void testLocksAndSequences()
+{
+    CHECK(!isRead("SELECT * FROM users FOR UPDATE"));
+    CHECK(!isRead("SELECT * FROM users FOR NO KEY UPDATE"));
+    CHECK(!isRead("SELECT * FROM users FOR SHARE"));
+    CHECK(!isRead("select * from users for key share"));
+    CHECK(isRead("SELECT share FROM stocks"));
+    CHECK(!isRead("SELECT nextval('users_id_seq')"));
+    CHECK(!isRead("SELECT setval('users_id_seq', 10)"));
+    CHECK(isRead("SELECT currval('users_id_seq')"));
+}
+
+static void testIntoAndCte()
+{
+    CHECK(!isRead("SELECT * INTO backup FROM users"));
+    CHECK(!isRead("WITH moved AS (DELETE FROM a RETURNING *) INSERT INTO b SELECT * FROM moved"));
+    CHECK(!isRead("WITH t AS (UPDATE users SET a = 1 RETURNING id) SELECT * FROM t"));
+    CHECK(!isRead("WITH t AS (INSERT INTO users DEFAULT VALUES RETURNING id) SELECT id FROM t"));
+    CHECK(isRead("WITH t AS (SELECT 1 AS id) SELECT id FROM t"));
+    CHECK(isRead("WITH RECURSIVE t(n) AS (VALUES (1) UNION ALL SELECT n + 1 FROM t) SELECT n FROM t"));
+    CHECK(!isRead("MERGE INTO t USING s ON t.id = s.id WHEN MATCHED THEN DELETE"));
+}
+
+/// Открывает локальный сокет, который принимает соединения, но не отвечает на них
+/// @param port Номер порта сокета
+/// @return Дескриптор сокета
+static int listenLocal(int &port)
+{
+    const int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t size = sizeof(address);
+    if (fd < 0 || bind(fd, reinterpret_cast<sockaddr *>(&address), size) != 0 || listen(fd, 4) != 0
+        || getsockname(fd, reinterpret_cast<sockaddr *>(&address), &size) != 0) {
+        port = 0;
+        return fd;
+    }
+    port = ntohs(address.sin_port);
+    return fd;
+}
+
+static void testTransactions()
+{
+    // Соединения ожидают ответа сервера, поэтому реплика доступна балансировщику
+    int port = 0;
+    const int fd = listenLocal(port);
+    CHECK(port != 0);
+    const auto info = "host=127.0.0.1 connect_timeout=10 port=" + std::to_string(port);
+    SqlRouter router(info, {info});
+    const auto ignore = [](SqlConnect *) {};
+    CHECK(!router.isTransaction());
+    CHECK(&router.connection("SELECT 1") == &router.replica(0));
+
+    router.execute("BEGIN", ignore);
+    CHECK(router.isTransaction());
+    CHECK(&router.connection("SELECT 1") == &router.primary());
+    CHECK(&router.connection("SELECT 1", SqlRoute::Read) == &router.primary());
+
+    router.execute("SELECT 1", ignore);
+    router.execute("ROLLBACK TO SAVEPOINT a", ignore);
+    CHECK(router.isTransaction());
+    router.execute("COMMIT", ignore);
+    CHECK(!router.isTransaction());
+    CHECK(&router.connection("SELECT 1") == &router.replica(0));
+
+    router.execute("start transaction isolation level serializable", ignore);
+    CHECK(router.isTransaction());
+    router.execute("SELECT 'COMMIT'; -- END\n", ignore);
+    CHECK(router.isTransaction());
+    router.execute("rollback", ignore);
+    CHECK(!router.isTransaction());
+
+    router.execute("BEGIN; UPDATE users SET a = 1; COMMIT", ignore);
+    CHECK(!router.isTransaction());
+    router.execute("BEGIN; PREPARE TRANSACTION 'a'", ignore);
+    CHECK(!router.isTransaction());
+    router.execute("DO $$ BEGIN PERFORM 1; END $$", ignore);
+    CHECK(!router.isTransaction());
+
+    close(fd);
+}
+
+int main(int /*argc*/, char * /*argv*/[])
+{
+    testCommands();
+    testQuotes();
+    testDollarQuotes();
+    testLocksAndSequences();
+    testIntoAndCte();
+    testTransactions();
+    return checkResult();
+}
@@ -0,0 +1,160 @@
+﻿#include "../check.h"
+
+#include <asyncpg/SqlText.h>
+
+#include <chrono>
+#include <string>
+
+using namespace AsyncPg;
+using std::chrono::microseconds;
+
+/// Типы PostgreSql
+static constexpr unsigned int DateOid = 1082;
+static constexpr unsigned int TimeOid = 1083;
+static constexpr unsigned int TimeStampOid = 1114;
+static constexpr unsigned int TimeStampTzOid = 1184;
+static constexpr unsigned int IntervalOid = 1186;
+static constexpr unsigned int TimeTzOid = 1266;
+
+static SqlValue fromText(unsigned int oid, const std::string &text, SqlType type)
+{
+    return asSqlValueText(oid, text.data(), static_cast<int>(text.size()), type);
+}
+
+/// Разбирает дату и возвращает количество дней от эпохи Unix
+static bool dateDays(const std::string &text, int64_t &days)
+{
+    const auto value = fromText(DateOid, text, SqlType::DateDays);
+    if (value.index() != SqlType::DateDays || !std::get<SqlType::DateDays>(value))
+        return false;
+    days = std::get<SqlType::DateDays>(value)->time_since_epoch().count();
+    return true;
+}
+
+/// Разбирает момент времени и возвращает количество микросекунд от эпохи Unix
+static bool timeStampUsec(unsigned int oid, const std::string &text, int64_t &usec)
+{
+    const auto type = (oid == TimeStampTzOid) ? SqlType::TimeStampTzUs : SqlType::TimeStampUs;
+    const auto value = fromText(oid, text, type);
+    if (value.index() != type)
+        return false;
+    const auto &point = (type == SqlType::TimeStampTzUs) ? std::get<SqlType::TimeStampTzUs>(value)
+                                                           : std::get<SqlType::TimeStampUs>(value);
+    if (!point)
+        return false;
+    usec = point->time_since_epoch().count();
+    return true;
+}
+
+static void testDates()
+{
+    int64_t days = -1;
+    CHECK(dateDays("1970-01-01", days) && days == 0);
+    CHECK(dateDays("2000-01-01", days) && days == 10957);
+    CHECK(dateDays("2024-02-29", days) && days == 19782);
+    CHECK(dateDays("1969-12-31", days) && days == -1);
+
+    // Год 1 до нашей эры - нулевой год григорианского календаря
+    CHECK(dateDays("0001-01-01", days) && days == -719162);
+    CHECK(dateDays("0001-12-31 BC", days) && days == -719163);
+    CHECK(dateDays("0001-01-01 BC", days) && days == -719528);
+
+    const auto date = fromText(DateOid, "2000-01-02", SqlType::None);
+    CHECK(date.index() == SqlType::Date && std::get<SqlType::Date>(date) == 946771200);
+}
+
+static void testTimeStamps()
+{
+    int64_t usec = -1;
+    CHECK(timeStampUsec(TimeStampOid, "1970-01-01 00:00:00", usec) && usec == 0);
+    CHECK(timeStampUsec(TimeStampOid, "2000-01-01 00:00:00.5", usec) && usec == 946684800500000);
+    CHECK(timeStampUsec(TimeStampOid, "2000-01-01 00:00:00.1234567", usec) && usec == 946684800123456);
+    CHECK(timeStampUsec(TimeStampOid, "0001-12-31 23:59:59 BC", usec) && usec == -719163LL * 86400000000 + 86399000000);
+
+    // Смещение часового пояса вычитается из локального времени
+    CHECK(timeStampUsec(TimeStampTzOid, "2024-02-29 12:34:56.789+03", usec) && usec == 1709199296789000);
+    CHECK(timeStampUsec(TimeStampTzOid, "1999-12-31 23:59:59-09:30", usec) && usec == 946718999000000);
+    CHECK(timeStampUsec(TimeStampTzOid, "1970-01-01 00:00:00+00:00:30", usec) && usec == -30000000);
+    CHECK(timeStampUsec(TimeStampTzOid, "1970-01-01 00:00:00+00", usec) && usec == 0);
+
+    const auto seconds = fromText(TimeStampTzOid, "1970-01-01 01:00:00+01", SqlType::None);
+    CHECK(seconds.index() == SqlType::TimeStampTz && std::get<SqlType::TimeStampTz>(seconds) == 0);
+}
+
+static void testTimes()
+{
+    const auto time = fromText(TimeOid, "12:34:56.5", SqlType::TimeUs);
+    CHECK(time.index() == SqlType::TimeUs && std::get<SqlType::TimeUs>(time) == microseconds(45296500000));
+
+    const auto timetz = fromText(TimeTzOid, "12:00:00+05:30", SqlType::TimeUs);
+    CHECK(timetz.index() == SqlType::TimeUs && std::get<SqlType::TimeUs>(timetz) == microseconds(43200000000));
+
+    const auto seconds = fromText(TimeOid, "00:01:02", SqlType::None);
+    CHECK(seconds.index() == SqlType::Time && std::get<SqlType::Time>(seconds) == 62);
+}
+
+static void checkInterval(const std::string &text, int64_t usec, int32_t days, int32_t months)
+{
+    const auto value = fromText(IntervalOid, text, SqlType::None);
+    CHECK(value.index() == SqlType::Interval && std::get<SqlType::Interval>(value));
+    if (value.index() != SqlType::Interval || !std::get<SqlType::Interval>(value))
+        return;
+    const auto &interval = *std::get<SqlType::Interval>(value);
+    CHECK(interval.time == microseconds(usec));
+    CHECK(interval.days == days);
+    CHECK(interval.months == months);
+}
+
+static void testIntervals()
+{
+    checkInterval("00:00:00", 0, 0, 0);
+    checkInterval("1 year 2 mons 3 days 04:05:06.5", 14706500000, 3, 14);
+    checkInterval("-1 years -1 mons", 0, 0, -13);
+    checkInterval("1 day -00:00:01", -1000000, 1, 0);
+    checkInterval("-2 days +01:00:00", 3600000000, -2, 0);
+    checkInterval("10 mons", 0, 0, 10);
+    checkInterval("100:00:00", 360000000000, 0, 0);
+}
+
+static void testInfinity()
+{
+    const auto last = fromText(TimeStampOid, "infinity", SqlType::TimeStampUs);
+    CHECK(last.index() == SqlType::TimeStampUs && std::get<SqlType::TimeStampUs>(last) == SqlTimePoint::max());
+
+    const auto first = fromText(TimeStampTzOid, "-infinity", SqlType::TimeStampTzUs);
+    CHECK(first.index() == SqlType::TimeStampTzUs && std::get<SqlType::TimeStampTzUs>(first) == SqlTimePoint::min());
+
+    const auto date = fromText(DateOid, "infinity", SqlType::DateDays);
+    CHECK(date.index() == SqlType::DateDays && std::get<SqlType::DateDays>(date) == SqlDatePoint::max());
+
+    const auto pastDate = fromText(DateOid, "-infinity", SqlType::DateDays);
+    CHECK(pastDate.index() == SqlType::DateDays && std::get<SqlType::DateDays>(pastDate) == SqlDatePoint::min());
+}
+
+static void testFallback()
+{
+    // Значения в неподдерживаемом формате возвращаются как текст, NULL - как пустое значение
+    for (const auto &[oid, text] : {std::pair<unsigned int, std::string>{DateOid, "01/02/2000"},
+                                    {DateOid, "2000-13-01"},
+                                    {TimeStampOid, "2000-01-01T00:00:00"},
+                                    {TimeStampTzOid, "2000-01-01 00:00:00"},
+                                    {IntervalOid, "P1Y2M"},
+                                    {IntervalOid, "1 week"}}) {
+        const auto value = fromText(oid, text, SqlType::None);
+        CHECK(value.index() == SqlType::Text && std::get<SqlType::Text>(value) == text);
+    }
+
+    const auto null = asSqlValueText(DateOid, nullptr, 0, SqlType::DateDays);
+    CHECK(null.index() == SqlType::DateDays && !std::get<SqlType::DateDays>(null));
+}
+
+int main(int /*argc*/, char * /*argv*/[])
+{
+    testDates();
+    testTimeStamps();
+    testTimes();
+    testIntervals();
+    testInfinity();
+    testFallback();
+    return checkResult();
+}
@@ -0,0 +1,138 @@
+﻿#include "../check.h"
+
+#include <asyncpg/SqlArray.h>
+#include <asyncpg/SqlResult.h>
+#include <asyncpg/SqlWriter.h>
+
+#include <libpq-fe.h>
+
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace AsyncPg;
+
+/// Типы PostgreSql
+static constexpr unsigned int Int4Oid = 23;
+static constexpr unsigned int Int4ArrayOid = 1007;
+static constexpr unsigned int TextArrayOid = 1009;
+static constexpr unsigned int DateOid = 1082;
+static constexpr unsigned int TimeStampTzOid = 1184;
+static constexpr unsigned int CustomOid = 600000;
+
+/// Количество дней между эпохами Unix и PostgreSql
+static constexpr int32_t EpochDays = 10957;
+
+static std::string bigEndian(uint64_t value, int size)
+{
+    std::string bytes;
+    for (int i = size - 1; i >= 0; --i)
+        bytes += static_cast<char>((value >> (i * 8)) & 0xFF);
+    return bytes;
+}
+
+/// Создаёт результат Sql запроса из одной колонки в двоичном формате
+static SqlResult makeResult(unsigned int oid, const std::vector<std::optional<std::string>> &values)
+{
+    auto *pgresult = PQmakeEmptyPGresult(nullptr, PGRES_TUPLES_OK);
+    PGresAttDesc attribute{};
+    attribute.name = const_cast<char *>("v");
+    attribute.typid = oid;
+    attribute.format = 1;
+    attribute.typlen = -1;
+    attribute.atttypmod = -1;
+    PQsetResultAttrs(pgresult, 1, &attribute);
+    for (int row = 0; row < static_cast<int>(values.size()); ++row) {
+        const auto &value = values[static_cast<std::size_t>(row)];
+        PQsetvalue(pgresult, row, 0, value ? const_cast<char *>(value->data()) : nullptr,
+                   value ? static_cast<int>(value->size()) : -1);
+    }
+    return SqlResult(pgresult);
+}
+
+static std::string csv(const SqlResult &result)
+{
+    std::string buffer;
+    writeCsv(result, buffer);
+    return buffer;
+}
+
+static std::string json(const SqlResult &result)
+{
+    std::string buffer;
+    writeJson(result, buffer);
+    return buffer;
+}
+
+static std::string arrayBytes(const SqlArray &array)
+{
+    return std::string(array.bytes());
+}
+
+static void testDates()
+{
+    const auto dates = makeResult(DateOid, {
+        bigEndian(static_cast<uint32_t>(0), 4),
+        bigEndian(static_cast<uint32_t>(-719163 - EpochDays), 4),
+        bigEndian(static_cast<uint32_t>(-735160 - EpochDays), 4),
+        bigEndian(static_cast<uint32_t>(std::numeric_limits<int32_t>::max()), 4),
+        bigEndian(static_cast<uint32_t>(std::numeric_limits<int32_t>::min()), 4)});
+    CHECK(csv(dates) == "2000-01-01\n0001-12-31 BC\n0044-03-15 BC\ninfinity\n-infinity\n");
+
+    const int64_t bc = (-719163LL - EpochDays) * 86400000000LL + 86399000000LL;
+    const auto stamps = makeResult(TimeStampTzOid, {
+        bigEndian(static_cast<uint64_t>(bc), 8),
+        bigEndian(static_cast<uint64_t>(std::numeric_limits<int64_t>::max()), 8)});
+    CHECK(csv(stamps) == "0001-12-31 23:59:59+00:00 BC\ninfinity\n");
+    CHECK(json(stamps) == "{\"v\":\"0001-12-31T23:59:59+00:00 BC\"},{\"v\":\"infinity\"}");
+}
+
+static void testArrays()
+{
+    const auto ints = makeResult(Int4ArrayOid, {arrayBytes(SqlArray::from<int32_t>({1, -2, 3})),
+                                                arrayBytes(SqlArray::from<int32_t>({})), std::nullopt});
+    CHECK(csv(ints) == "\"{1,-2,3}\"\n{}\n\n");
+    CHECK(json(ints) == "{\"v\":[1,-2,3]},{\"v\":[]},{\"v\":null}");
+
+    const auto texts = makeResult(TextArrayOid, {arrayBytes(SqlArray::from<std::string>(
+        {"plain", "a b", "", "null", "x\"y", "back\\slash", "{}"}))});
+    CHECK(csv(texts) == "\"{plain,\"\"a b\"\",\"\"\"\",\"\"null\"\",\"\"x\\\"\"y\"\","
+                        "\"\"back\\\\slash\"\",\"\"{}\"\"}\"\n");
+    CHECK(json(texts) == "{\"v\":[\"plain\",\"a b\",\"\",\"null\",\"x\\\"y\",\"back\\\\slash\",\"{}\"]}");
+
+    // Двумерный массив {{1,NULL},{3,4}}
+    std::string matrix = bigEndian(2, 4) + bigEndian(1, 4) + bigEndian(Int4Oid, 4)
+        + bigEndian(2, 4) + bigEndian(1, 4) + bigEndian(2, 4) + bigEndian(1, 4);
+    for (auto value : {1, -1, 3, 4}) {
+        if (value < 0) {
+            matrix += bigEndian(static_cast<uint32_t>(-1), 4);
+        } else {
+            matrix += bigEndian(4, 4);
+            matrix += bigEndian(static_cast<uint32_t>(value), 4);
+        }
+    }
+    const auto matrices = makeResult(Int4ArrayOid, {matrix});
+    CHECK(csv(matrices) == "\"{{1,NULL},{3,4}}\"\n");
+    CHECK(json(matrices) == "{\"v\":[[1,null],[3,4]]}");
+
+    // Повреждённый массив записывается шестнадцатеричным значением
+    const auto broken = makeResult(Int4ArrayOid, {matrix.substr(0, 30)});
+    CHECK(csv(broken).compare(0, 2, "\\x") == 0);
+}
+
+static void testCustom()
+{
+    const auto custom = makeResult(CustomOid, {std::string("\x01\xff", 2), std::string()});
+    CHECK(csv(custom) == "\\x01ff\n\\x\n");
+    CHECK(json(custom) == "{\"v\":\"\\\\x01ff\"},{\"v\":\"\\\\x\"}");
+}
+
+int main(int /*argc*/, char * /*argv*/[])
+{
+    testDates();
+    testArrays();
+    testCustom();
+    return checkResult();
+}